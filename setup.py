@@ -35,6 +35,7 @@ setup(
     ext_modules=[module],
     packages=find_packages(),
     setup_requires=["pybind11"],
+    install_requires=["numpy"],
     test_suite='tests',
     zip_safe=False,
 )
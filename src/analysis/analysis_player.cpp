@@ -34,6 +34,11 @@ AnalysisPlayer::error(std::string error) {
     analysed_player->error(error);
 }
 
+void
+AnalysisPlayer::reseed(int seed) {
+    analysed_player->reseed(seed);
+}
+
 
 std::string
 AnalysisPlayer::player_type() const {
@@ -22,6 +22,7 @@ public:
     Action play(const State& state) override;
 
     void error(std::string error) override;
+    void reseed(int seed) override;
 
     std::string player_type() const override;
 
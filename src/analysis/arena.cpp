@@ -2,27 +2,256 @@
 
 #include "arena_room.hpp"
 #include "groups_utils.hpp"
+#include "utils/bits.hpp"
+#include <algorithm>
 #include <cmath>
+#include <iostream>
+#include <sstream>
 #include <stdio.h>
 
 /*** Private ***/
 
 void
-Arena::add_results_container(
-    std::vector<std::vector<int>>& _results,
-    const std::vector<int>& ids,
-    const std::vector<int>& new_wins,
-    const std::vector<int>& new_scores,
-    const std::vector<int>& new_squared_scores) {
-    const std::lock_guard<std::mutex> lock(results_mutex);
-    add_results(_results, ids, new_wins, new_scores, new_squared_scores);
-    processed_groups++;
-    print_current();
+Arena::prepare() {
+    int player_count = players.size();
+    // Check
+    if (!ready()) {
+        throw std::runtime_error("Arena not ready: missing player(s)");
+    }
+    if (thread_limit <= 0) {
+        throw std::runtime_error("Thread_limit should be strictly positive");
+    }
+    if (duplicate && count % rules->player_count != 0) {
+        throw std::runtime_error("With duplicate deals, count should be a multiple of the player count");
+    }
+    // Setup all game groups
+    while (!groups.empty()) {
+        groups.pop();
+    }
+    generate_groups(players.size(), rules->player_count);
+    group_ids.clear();
+    while (!groups.empty()) {
+        group_ids.push_back(std::move(groups.front()));
+        groups.pop();
+    }
+    if (resuming) {
+        if (restored.group_ids != group_ids || int(restored.moves.size()) != player_count) {
+            throw std::runtime_error("Checkpoint was saved by an arena with other players or mode");
+        }
+        seed = restored.seed;
+        count = restored.count;
+        // Checkpoints of version 2 and before have no settings
+        if (restored.settings.empty()) {
+            std::cerr << "Checkpoint has no settings, so they are not checked" << std::endl;
+        } else if (restored.settings != checkpoint_settings()) {
+            throw std::runtime_error("Checkpoint was saved with the settings '" + restored.settings + "', not '" + checkpoint_settings() + "'");
+        }
+    }
+    // Clear results
+    process_time = 0;
+    progress.reset(new Progress[thread_limit]);
+    total_groups = group_ids.size();
+    total_games = total_groups * count;
+    results = std::vector<std::vector<int>>(player_count, std::vector<int>(column_count(), 0));
+    for (auto& player : players) {
+        player->time = 0;
+        player->move_counter = 0;
+        player->analysis = detailed_player_analysis;
+    }
+    if (!resuming) {
+        restored = ArenaCheckpoint(seed, count, task_size(), group_ids, player_count);
+        restored.settings = checkpoint_settings();
+    }
+    // Finished games count in the progress, and groups may already be stopped
+    tested = restored.results;
+    tested_games.clear();
+    stopped.reset(new std::atomic<bool>[total_groups]);
+    for (int group = 0; group < total_groups; group++) {
+        int games = restored.finished_games(group);
+        tested_games.push_back(games);
+        stopped[group] = games < count && stopping.decided(group_ids[group], tested[group], games, stopping_checks());
+        progress[0].games += games;
+        progress[0].groups += games == count || stopped[group];
+    }
+}
+
+int
+Arena::task_size() const {
+    int size = chunk_size;
+    if (size <= 0) {
+        // About 8 tasks per thread, without splitting batches
+        int tasks_per_thread = 8;
+        size = (total_games + tasks_per_thread * thread_limit - 1) / (tasks_per_thread * thread_limit);
+        size = std::max(size, batch_size);
+    }
+    // Deals are not split between tasks
+    int deal = duplicate ? rules->player_count : 1;
+    size = (size + deal - 1) / deal * deal;
+    return std::max(deal, std::min(size, count));
+}
+
+// The stopping rule decides which games of a checkpoint were played, so it is kept with them
+std::string
+Arena::checkpoint_settings() const {
+    std::ostringstream out;
+    out << settings() << " stopping " << stopping.test << " " << stopping.margin << " " << stopping.error << " " << stopping.min_games;
+    return out.str();
+}
+
+// The stopping rule is checked once per task of a group
+int
+Arena::stopping_checks() const {
+    return (count + restored.chunk - 1) / restored.chunk;
+}
+
+int
+Arena::game_seed(int group, int game, int stream) const {
+    uint64_t key = mix64(mix64(uint32_t(seed)) ^ (uint64_t(group) << 32 | uint32_t(game)));
+    return int(mix64(key ^ uint32_t(stream)));
+}
+
+std::vector<ArenaTask>
+Arena::pending_tasks() const {
+    std::vector<ArenaTask> pending;
+    for (const ArenaTask& task : restored.remaining_tasks()) {
+        if (!stopped[task.group]) {
+            pending.push_back(task);
+        }
+    }
+    return pending;
 }
 
 bool
-Arena::is_sequential() const {
-    return thread_limit <= 1;
+Arena::test_group(ArenaTask task, const GroupResults& results) {
+    if (stopping.test == StoppingRule::NONE) {
+        return false;
+    }
+    const std::lock_guard<std::mutex> lock(stopping_mutex);
+    tested[task.group] += results;
+    tested_games[task.group] += task.count;
+    if (stopped[task.group] || tested_games[task.group] >= count) {
+        return false;
+    }
+    if (!stopping.decided(group_ids[task.group], tested[task.group], tested_games[task.group], stopping_checks())) {
+        return false;
+    }
+    stopped[task.group] = true;
+    return true;
+}
+
+int
+Arena::deal_seed(int deal) const {
+    return game_seed(-1, deal);
+}
+
+void
+Arena::report() {
+    auto last_checkpoint = std::chrono::steady_clock::now();
+    int interval = report_interval > 0 ? report_interval : 1000;
+    std::unique_lock<std::mutex> lock(report_mutex);
+    while (reporting) {
+        if (report_interval > 0) {
+            print_current();
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (!checkpoint_path.empty() && now - last_checkpoint >= std::chrono::seconds(checkpoint_interval)) {
+            save_checkpoint(snapshot());
+            last_checkpoint = now;
+        }
+        report_signal.wait_for(lock, std::chrono::milliseconds(interval), [this] { return !reporting; });
+    }
+}
+
+// Tasks finished before this run and by the rooms so far
+ArenaCheckpoint
+Arena::snapshot() const {
+    ArenaCheckpoint checkpoint = restored;
+    for (ArenaRoom* room : rooms) {
+        const std::lock_guard<std::mutex> lock(room->mutex);
+        checkpoint.merge(room->finished);
+    }
+    return checkpoint;
+}
+
+void
+Arena::save_checkpoint(const ArenaCheckpoint& checkpoint) const {
+    if (!checkpoint_path.empty()) {
+        checkpoint.write(checkpoint_path);
+    }
+}
+
+void
+Arena::set_results(const ArenaCheckpoint& finished) {
+    group_games.clear();
+    group_results = finished.results;
+    for (int group = 0; group < total_groups; group++) {
+        group_games.push_back(finished.finished_games(group));
+        const GroupResults& group_results = finished.results[group];
+        add_results(results, group_ids[group], group_results.wins, group_results.scores, group_results.squared_scores);
+    }
+    for (size_t player = 0; player < players.size(); player++) {
+        players[player]->move_counter = finished.moves[player];
+        players[player]->time = finished.times[player];
+    }
+    process_time = finished.process_time;
+}
+
+void
+Arena::play() {
+    auto begin_instant = std::chrono::system_clock::now();
+    std::cout << "Mode: " << mode_name() << "\n";
+    prepare();
+    // Split the remaining games in tasks
+    std::vector<ArenaTask> pending = pending_tasks();
+    tasks.reset(new TaskPool(thread_limit));
+    tasks->deal(pending);
+    if (!record_path.empty()) {
+        records = std::make_shared<GameRecordWriter>(record_path, rules, resuming);
+    }
+    remaining_tasks.reset(new std::atomic<int>[total_groups]);
+    for (int group = 0; group < total_groups; group++) {
+        remaining_tasks[group] = 0;
+    }
+    for (const ArenaTask& task : pending) {
+        remaining_tasks[task.group]++;
+    }
+    // Run games
+    std::vector<std::unique_ptr<ArenaRoom>> owned_rooms;
+    for (int i = 0; i < thread_limit; i++) {
+        owned_rooms.emplace_back(new ArenaRoom(this, i));
+        rooms.push_back(owned_rooms.back().get());
+    }
+    std::vector<std::thread> threads;
+    for (ArenaRoom* room : rooms) {
+        threads.push_back(std::thread(&ArenaRoom::run, room));
+    }
+    std::thread reporter;
+    if (report_interval > 0 || !checkpoint_path.empty()) {
+        reporting = true;
+        reporter = std::thread(&Arena::report, this);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (reporter.joinable()) {
+        {
+            const std::lock_guard<std::mutex> lock(report_mutex);
+            reporting = false;
+        }
+        report_signal.notify_one();
+        reporter.join();
+    }
+    if (report_interval > 0) {
+        print_current();
+    }
+    ArenaCheckpoint finished = snapshot();
+    rooms.clear();
+    records.reset();
+    save_checkpoint(finished);
+    set_results(finished);
+    auto end_instant = std::chrono::system_clock::now();
+    real_time = std::chrono::duration_cast<std::chrono::microseconds>(end_instant - begin_instant).count();
+    std::cout << std::endl;
 }
 
 /*** Protected ***/
@@ -34,7 +263,13 @@ Arena::add_group(std::vector<int> group) {
 
 void
 Arena::print_current() {
-    std::cout << "Played " << processed_groups << "/" << total_groups << " (" << processed_games << "/" << total_games << ")    \r" << std::flush;
+    int games = 0;
+    int groups_done = 0;
+    for (int room = 0; room < thread_limit; room++) {
+        games += progress[room].games.load(std::memory_order_relaxed);
+        groups_done += progress[room].groups.load(std::memory_order_relaxed);
+    }
+    std::cout << "Played " << groups_done << "/" << total_groups << " (" << games << "/" << total_games << ")    \r" << std::flush;
 }
 
 
@@ -75,10 +310,19 @@ Arena::print_results(std::vector<std::vector<int>> results) {
         max_player_length = std::max(max_player_length, int(players[line]->analysed_player->player_type().size()));
     }
     int games_per_player = results[0][0] * count;
+    // Games actually played by each player, and by all
+    std::vector<int> player_games(player_count, 0);
+    int played = 0;
+    for (size_t group = 0; group < group_games.size(); group++) {
+        for (int id : group_ids[group]) {
+            player_games[id] += group_games[group];
+        }
+        played += group_games[group];
+    }
 
     printf("Games per group:  %d\nGames per player: %d\n", count, games_per_player);
 
-    double game_time = process_time / total_games;
+    double game_time = process_time / played;
     if (detailed_player_analysis) {
         double state_change_time = process_time;
         int total_moves = 0;
@@ -91,7 +335,7 @@ Arena::print_results(std::vector<std::vector<int>> results) {
             game_time,
             (double)process_time / total_moves,
             state_change_time / total_moves,
-            (double)total_moves / total_games);
+            (double)total_moves / played);
     } else {
         printf("Average time per game: %.4e µs\n\n", game_time);
     }
@@ -103,12 +347,12 @@ Arena::print_results(std::vector<std::vector<int>> results) {
     }
     printf("-+---------+-------+-------%s\n", detailed_player_analysis ? "+-----------+-----" : "");
     for (int line = 0; line < player_count; line++) {
-        double winrate = 100. * results[line][1] / games_per_player;
-        double avg_score = double(results[line][2]) / games_per_player;
-        double score_var = std::sqrt(double(results[line][3]) / games_per_player - avg_score * avg_score);
+        double winrate = 100. * results[line][1] / player_games[line];
+        double avg_score = double(results[line][2]) / player_games[line];
+        double score_var = std::sqrt(double(results[line][3]) / player_games[line] - avg_score * avg_score);
         if (detailed_player_analysis) {
             double time_per_move = players[line]->time * 1.0 / players[line]->move_counter;
-            double moves = (double)players[line]->move_counter / games_per_player;
+            double moves = (double)players[line]->move_counter / player_games[line];
             printf("%*.*s | %6.2f%% | %5.1f | %5.1f | %.3e |% 3.1f\n",
                 max_player_length,
                 max_player_length,
@@ -132,6 +376,56 @@ Arena::print_results(std::vector<std::vector<int>> results) {
 }
 
 
+// Mean score difference per seat between the two players of each group, and its
+// standard error, from the paired differences of duplicate deals and as if games
+// were independent
+void
+Arena::print_differences() {
+    int seats = rules->player_count;
+    printf("\nScore differences on duplicate deals:\n");
+    for (size_t group = 0; group < group_results.size(); group++) {
+        const std::vector<int>& ids = group_ids[group];
+        const GroupResults& group_result = group_results[group];
+        int first = std::count(ids.begin(), ids.end(), ids.front());
+        int second = ids.back();
+        if (first == seats || std::count(ids.begin(), ids.end(), second) != seats - first || group_games[group] == 0) {
+            continue;
+        }
+        double deals = group_games[group] / seats;
+        double scale = double(first) * (seats - first) * seats;
+        double mean = group_result.differences / deals;
+        double variance = std::max(0., group_result.squared_differences / deals - mean * mean);
+        double paired_error = std::sqrt(variance / deals) / scale;
+        // Unpaired: each seat is a sample of the score of its player
+        double unpaired_variance = 0;
+        for (int side = 0; side < 2; side++) {
+            double sum = 0;
+            double squares = 0;
+            int positions = 0;
+            for (int position = 0; position < seats; position++) {
+                if ((ids[position] == ids.front()) == (side == 0)) {
+                    sum += group_result.scores[position];
+                    squares += group_result.squared_scores[position];
+                    positions++;
+                }
+            }
+            double samples = double(group_games[group]) * positions;
+            double average = sum / samples;
+            unpaired_variance += std::max(0., squares / samples - average * average) / samples;
+        }
+        printf("%s vs %s (%dvs%d): %+.2f ± %.2f (unpaired ± %.2f), %d deals\n",
+            players[ids.front()]->analysed_player->player_type().c_str(),
+            players[second]->analysed_player->player_type().c_str(),
+            first,
+            seats - first,
+            mean / scale,
+            paired_error,
+            std::sqrt(unpaired_variance),
+            int(deals));
+    }
+}
+
+
 /*** Public ***/
 
 Arena::Arena()
@@ -175,6 +469,20 @@ Arena::mode_name() const {
     return "Subsets";
 }
 
+std::string
+Arena::settings() const {
+    std::ostringstream out;
+    out << mode_name() << " games " << count << " duplicate " << duplicate << " batch " << batch_size
+        << " rules " << rules->player_count << " " << rules->tile_count << " " << rules->tile_types << " " << rules->factory_tiles
+        << " " << rules->line_bonus << " " << rules->column_bonus << " " << rules->type_bonus
+        << " " << rules->overflow_count << " " << rules->overflow_penalty
+        << " groups " << group_ids.size() << " players " << players.size();
+    for (const auto& player : players) {
+        out << " [" << player->player_type() << "]";
+    }
+    return out.str();
+}
+
 bool
 Arena::ready() const {
     return players.size() >= rules->player_count;
@@ -182,50 +490,41 @@ Arena::ready() const {
 
 void
 Arena::run() {
-    auto begin_instant = std::chrono::system_clock::now();
-    int player_count = players.size();
-    // Check
-    if (!ready()) {
-        throw std::runtime_error("Arena not ready: missing player(s)");
-    }
-    if (thread_limit <= 0) {
-        throw std::runtime_error("Thread_limit should be strictly positive");
-    }
-    std::cout << "Mode: " << mode_name() << "\n";
-    // Setup all game groups
-    while (!groups.empty()) {
-        groups.pop();
-    }
-    generate_groups(players.size(), rules->player_count);
-    // Clear results
-    process_time = 0;
-    processed_groups = 0;
-    processed_games = 0;
-    total_groups = groups.size();
-    total_games = total_groups * count;
-    results = std::vector<std::vector<int>>(player_count, std::vector<int>(column_count(), 0));
-    for (auto& player : players) {
-        player->time = 0;
-        player->move_counter = 0;
-        player->analysis = detailed_player_analysis;
-    }
-    // Run games
-    std::vector<std::thread> rooms = std::vector<std::thread>();
-    print_current();
-    for (int i = 0; i < thread_limit; i++) {
-        rooms.push_back(std::thread(&ArenaRoom::run, ArenaRoom(this)));
+    resuming = false;
+    play();
+}
+
+void
+Arena::resume() {
+    if (checkpoint_path.empty()) {
+        throw std::runtime_error("No checkpoint to resume from");
     }
-    for (auto& room : rooms) {
-        room.join();
+    restored = ArenaCheckpoint::read(checkpoint_path);
+    resuming = true;
+    play();
+    resuming = false;
+}
+
+int
+Arena::games_saved() const {
+    int played = 0;
+    for (int games : group_games) {
+        played += games;
     }
-    auto end_instant = std::chrono::system_clock::now();
-    real_time = std::chrono::duration_cast<std::chrono::microseconds>(end_instant - begin_instant).count();
-    std::cout << std::endl;
+    return int(group_games.size()) * count - played;
 }
 
 void
 Arena::print() {
     print_results(results);
+    if (stopping.test != StoppingRule::NONE) {
+        int saved = games_saved();
+        printf("Games saved by the stopping rule: %d/%d (%.1f%%)\n", saved, total_games, 100. * saved / total_games);
+    }
+    if (duplicate) {
+        print_differences();
+    }
+    std::cout << std::flush;
 }
 
 void
@@ -1,41 +1,91 @@
 #ifndef ARENA_HPP
 #define ARENA_HPP
 
+#include <atomic>
+#include <condition_variable>
 #include <iostream>
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <string>
 #include <thread>
 #include <vector>
 
 #include "analysis_player.hpp"
+#include "arena_checkpoint.hpp"
+#include "stopping_rule.hpp"
+#include "task_pool.hpp"
 #include "game/game.hpp"
+#include "game/game_record.hpp"
 #include "game/player.hpp"
 #include "rules/rules.hpp"
+#include "utils/random.hpp"
 
+class ArenaRoom;
 class Arena {
     friend class ArenaRoom;
+    friend class ArenaCoordinator;
+    friend class ArenaWorker;
 
 protected:
     std::queue<std::vector<int>> groups = {};
 
 private:
-    std::mutex results_mutex = {};
-    std::mutex queue_mutex = {};
-
-    std::atomic<int> processed_games{ 0 };
-    std::atomic<int> processed_groups{ 0 };
+    // Progress of each room, only written by its thread and read by the reporter.
+    // Slots are 128 bytes long, so the counters of two rooms are more than a 64-byte
+    // cache line apart, without relying on the alignment of the array
+    struct Progress {
+        std::atomic<int> games{ 0 };
+        std::atomic<int> groups{ 0 };
+        char padding[128 - 2 * sizeof(std::atomic<int>)];
+    };
+
+    std::unique_ptr<Progress[]> progress;
     int total_groups;
     int total_games;
 
-    void add_results_container(
-        std::vector<std::vector<int>>& results,
-        const std::vector<int>& ids,
-        const std::vector<int>& new_wins,
-        const std::vector<int>& new_scores,
-        const std::vector<int>& new_squared_scores);
-
-    bool is_sequential() const;
+    // Number of unfinished tasks of each group
+    std::unique_ptr<std::atomic<int>[]> remaining_tasks;
+    std::unique_ptr<TaskPool> tasks;
+
+    // Tasks finished before this run, read by resume, and the rooms of this run
+    ArenaCheckpoint restored;
+    bool resuming = false;
+    std::vector<ArenaRoom*> rooms;
+    // Writer of the records of the games of this run
+    std::shared_ptr<GameRecordWriter> records;
+
+    // Results of each group for the stopping rule, and groups it stopped
+    std::mutex stopping_mutex;
+    std::vector<GroupResults> tested;
+    std::vector<int> tested_games;
+    std::unique_ptr<std::atomic<bool>[]> stopped;
+
+    // Reporter thread, printing the progress every "report_interval", and saving
+    // a checkpoint every "checkpoint_interval", until the rooms are done
+    std::mutex report_mutex;
+    std::condition_variable report_signal;
+    bool reporting = false;
+
+    // Checks the arena, generates the groups and clears the results,
+    // or restores them if resuming
+    void prepare();
+    int task_size() const;
+    int stopping_checks() const;
+    std::string checkpoint_settings() const;
+    // Tasks missing from the checkpoint, for groups not stopped yet
+    std::vector<ArenaTask> pending_tasks() const;
+    // Adds the results of a finished task to its group, returns true if the group is stopped by it
+    bool test_group(ArenaTask task, const GroupResults& results);
+    // Seed of the game "game" of "group", or of the player at "position" + 1 in it
+    int game_seed(int group, int game, int stream = 0) const;
+    // Seed of the tile draws of a duplicate deal, the same in all groups
+    int deal_seed(int deal) const;
+    void report();
+    ArenaCheckpoint snapshot() const;
+    void save_checkpoint(const ArenaCheckpoint& checkpoint) const;
+    void set_results(const ArenaCheckpoint& finished);
+    void play();
 
 protected:
     std::vector<std::shared_ptr<AnalysisPlayer>> players;
@@ -43,10 +93,16 @@ protected:
 
     long long process_time = 0LL;
     long long real_time = 0LL;
+    // Groups of the last run by index, with the games they played,
+    // fewer than "count" if they were stopped
+    std::vector<std::vector<int>> group_ids;
+    std::vector<int> group_games;
+    std::vector<GroupResults> group_results;
 
     void add_group(std::vector<int> group);
 
     void print_current();
+    void print_differences();
 
     void virtual add_results(
         std::vector<std::vector<int>>& results,
@@ -63,6 +119,30 @@ public:
     int count = 1000;
     int thread_limit = 8;
     bool detailed_player_analysis = true;
+    // If positive, groups of random and first legal players play this many games at once, see BatchGame.
+    // Ignored for duplicate or recorded runs
+    int batch_size = 0;
+    // Games per task, groups being split in tasks shared by threads. If 0, it
+    // is chosen so that each thread gets several tasks
+    int chunk_size = 0;
+    // Milliseconds between two progress lines, no progress is printed if 0
+    int report_interval = 200;
+    // Seed of all games: the k-th game of a group is seeded
+    // from it, whichever thread or worker plays it
+    int seed = random_seed();
+    // If not empty, progress is saved there every "checkpoint_interval" seconds and at the end
+    std::string checkpoint_path;
+    int checkpoint_interval = 60;
+    // Duplicate deals: the tiles of the k-th deal are drawn from the same seed in all
+    // groups, and each deal is played once per rotation of the seats, so that
+    // players are compared on the same draws. "count" should be a multiple of the
+    // player count of the rules
+    bool duplicate = false;
+    // If not empty, games are written there as game records, see GameRecordWriter.
+    // Records of resumed runs are appended. Games are then played one at a time, whatever batch_size is
+    std::string record_path;
+    // Stops groups of two players once one is known to be better
+    StoppingRule stopping;
     std::shared_ptr<Rules> rules;
 
     Arena();
@@ -74,9 +154,17 @@ public:
     void remove_player(std::shared_ptr<Player> player);
 
     virtual std::string mode_name() const;
+    // Mode, options, rules and player types, which resumed runs and workers of
+    // the arena should share. Groups should be generated, see prepare
+    std::string settings() const;
 
     virtual bool ready() const;
     void run();
+    // Plays the games missing from the checkpoint at "checkpoint_path", whose seed,
+    // count and tasks replace the ones of the arena. Its other settings should be the same
+    void resume();
+    // Games of the last run not played thanks to the stopping rule
+    int games_saved() const;
     void print();
     void run_print();
 };
@@ -0,0 +1,267 @@
+#include "arena_checkpoint.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+const char MAGIC[8] = { 'C', 'R', 'M', 'A', 'R', 'E', 'N', 'A' };
+const int32_t VERSION = 3;
+
+// Integers are stored in the byte order of the machine
+template<class T>
+void
+write_value(std::ofstream& out, T value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template<class T>
+T
+read_value(std::ifstream& in) {
+    T value;
+    if (!in.read(reinterpret_cast<char*>(&value), sizeof(value))) {
+        throw std::runtime_error("Checkpoint is truncated");
+    }
+    return value;
+}
+
+void
+write_ints(std::ofstream& out, const std::vector<int>& values) {
+    write_value<int32_t>(out, values.size());
+    for (int value : values) {
+        write_value<int32_t>(out, value);
+    }
+}
+
+std::vector<int>
+read_ints(std::ifstream& in) {
+    int32_t size = read_value<int32_t>(in);
+    if (size < 0) {
+        throw std::runtime_error("Checkpoint is corrupted");
+    }
+    std::vector<int> values;
+    for (int32_t i = 0; i < size; i++) {
+        values.push_back(read_value<int32_t>(in));
+    }
+    return values;
+}
+
+void
+write_string(std::ofstream& out, const std::string& value) {
+    write_value<int32_t>(out, value.size());
+    out.write(value.data(), value.size());
+}
+
+std::string
+read_string(std::ifstream& in) {
+    int32_t size = read_value<int32_t>(in);
+    if (size < 0) {
+        throw std::runtime_error("Checkpoint is corrupted");
+    }
+    std::string value(size, ' ');
+    if (!in.read(&value[0], size)) {
+        throw std::runtime_error("Checkpoint is truncated");
+    }
+    return value;
+}
+
+} // namespace
+
+
+// GroupResults
+
+GroupResults::GroupResults(int positions)
+  : wins(positions, 0)
+  , scores(positions, 0)
+  , squared_scores(positions, 0) {}
+
+GroupResults&
+GroupResults::operator+=(const GroupResults& other) {
+    for (std::size_t position = 0; position < wins.size(); position++) {
+        wins[position] += other.wins[position];
+        scores[position] += other.scores[position];
+        squared_scores[position] += other.squared_scores[position];
+    }
+    differences += other.differences;
+    squared_differences += other.squared_differences;
+    return *this;
+}
+
+
+// ArenaCheckpoint
+
+ArenaCheckpoint::ArenaCheckpoint(int seed, int count, int chunk, std::vector<std::vector<int>> group_ids, int player_count)
+  : seed(seed)
+  , count(count)
+  , chunk(chunk)
+  , group_ids(std::move(group_ids))
+  , done()
+  , results()
+  , moves(player_count, 0)
+  , times(player_count, 0)
+  , process_time(0) {
+    for (const std::vector<int>& ids : this->group_ids) {
+        results.emplace_back(ids.size());
+    }
+}
+
+void
+ArenaCheckpoint::add_task(ArenaTask task, const GroupResults& task_results) {
+    done.push_back(task);
+    results[task.group] += task_results;
+}
+
+void
+ArenaCheckpoint::merge(const ArenaCheckpoint& other) {
+    done.insert(done.end(), other.done.begin(), other.done.end());
+    for (std::size_t group = 0; group < results.size(); group++) {
+        results[group] += other.results[group];
+    }
+    for (std::size_t player = 0; player < moves.size(); player++) {
+        moves[player] += other.moves[player];
+        times[player] += other.times[player];
+    }
+    process_time += other.process_time;
+}
+
+std::vector<ArenaTask>
+ArenaCheckpoint::remaining_tasks() const {
+    std::set<std::pair<int, int>> finished;
+    for (const ArenaTask& task : done) {
+        finished.insert({ task.group, task.first });
+    }
+    std::vector<ArenaTask> tasks;
+    for (int group = 0; group < int(group_ids.size()); group++) {
+        for (int first = 0; first < count; first += chunk) {
+            if (finished.count({ group, first }) == 0) {
+                tasks.push_back(ArenaTask{ .group = group, .first = first, .count = std::min(chunk, count - first) });
+            }
+        }
+    }
+    return tasks;
+}
+
+int
+ArenaCheckpoint::finished_games(int group) const {
+    int games = 0;
+    for (const ArenaTask& task : done) {
+        games += task.group == group ? task.count : 0;
+    }
+    return games;
+}
+
+
+void
+ArenaCheckpoint::write(const std::string& path) const {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Could not write checkpoint " + temporary);
+        }
+        out.write(MAGIC, sizeof(MAGIC));
+        write_value<int32_t>(out, VERSION);
+        write_value<int32_t>(out, seed);
+        write_value<int32_t>(out, count);
+        write_value<int32_t>(out, chunk);
+        write_string(out, settings);
+        write_value<int32_t>(out, group_ids.size());
+        for (const std::vector<int>& ids : group_ids) {
+            write_ints(out, ids);
+        }
+        write_value<int32_t>(out, moves.size());
+        for (std::size_t player = 0; player < moves.size(); player++) {
+            write_value<int64_t>(out, moves[player]);
+            write_value<int64_t>(out, times[player]);
+        }
+        write_value<int64_t>(out, process_time);
+        write_value<int32_t>(out, done.size());
+        for (const ArenaTask& task : done) {
+            write_value<int32_t>(out, task.group);
+            write_value<int32_t>(out, task.first);
+            write_value<int32_t>(out, task.count);
+        }
+        for (const GroupResults& group : results) {
+            write_ints(out, group.wins);
+            write_ints(out, group.scores);
+            write_ints(out, group.squared_scores);
+            write_value<int64_t>(out, group.differences);
+            write_value<int64_t>(out, group.squared_differences);
+        }
+        if (!out.flush()) {
+            throw std::runtime_error("Could not write checkpoint " + temporary);
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Could not replace checkpoint " + path);
+    }
+}
+
+ArenaCheckpoint
+ArenaCheckpoint::read(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Could not read checkpoint " + path);
+    }
+    char magic[sizeof(MAGIC)];
+    if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), MAGIC)) {
+        throw std::runtime_error(path + " is not an arena checkpoint");
+    }
+    // Version 1 had no score differences, and versions 1 and 2 had no settings
+    int32_t version = read_value<int32_t>(in);
+    if (version < 1 || version > VERSION) {
+        throw std::runtime_error("Unsupported checkpoint version in " + path);
+    }
+    ArenaCheckpoint checkpoint;
+    checkpoint.seed = read_value<int32_t>(in);
+    checkpoint.count = read_value<int32_t>(in);
+    checkpoint.chunk = read_value<int32_t>(in);
+    if (version >= 3) {
+        checkpoint.settings = read_string(in);
+    }
+    int32_t group_count = read_value<int32_t>(in);
+    if (checkpoint.count < 0 || checkpoint.chunk <= 0 || group_count < 0) {
+        throw std::runtime_error("Checkpoint is corrupted");
+    }
+    for (int32_t group = 0; group < group_count; group++) {
+        checkpoint.group_ids.push_back(read_ints(in));
+    }
+    int32_t player_count = read_value<int32_t>(in);
+    for (int32_t player = 0; player < player_count; player++) {
+        checkpoint.moves.push_back(read_value<int64_t>(in));
+        checkpoint.times.push_back(read_value<int64_t>(in));
+    }
+    checkpoint.process_time = read_value<int64_t>(in);
+    int32_t task_count = read_value<int32_t>(in);
+    for (int32_t i = 0; i < task_count; i++) {
+        ArenaTask task;
+        task.group = read_value<int32_t>(in);
+        task.first = read_value<int32_t>(in);
+        task.count = read_value<int32_t>(in);
+        if (task.group < 0 || task.group >= group_count) {
+            throw std::runtime_error("Checkpoint is corrupted");
+        }
+        checkpoint.done.push_back(task);
+    }
+    for (int32_t group = 0; group < group_count; group++) {
+        GroupResults results;
+        results.wins = read_ints(in);
+        results.scores = read_ints(in);
+        results.squared_scores = read_ints(in);
+        if (version >= 2) {
+            results.differences = read_value<int64_t>(in);
+            results.squared_differences = read_value<int64_t>(in);
+        }
+        std::size_t positions = checkpoint.group_ids[group].size();
+        if (results.wins.size() != positions || results.scores.size() != positions || results.squared_scores.size() != positions) {
+            throw std::runtime_error("Checkpoint is corrupted");
+        }
+        checkpoint.results.push_back(results);
+    }
+    return checkpoint;
+}
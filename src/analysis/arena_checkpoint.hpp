@@ -0,0 +1,58 @@
+#ifndef ARENA_CHECKPOINT_HPP
+#define ARENA_CHECKPOINT_HPP
+
+#include <string>
+#include <vector>
+
+#include "task_pool.hpp"
+
+// Sums of the results of some games of a group, for each position
+struct GroupResults {
+    std::vector<int> wins;
+    std::vector<int> scores;
+    std::vector<int> squared_scores;
+    // With duplicate deals, sums over deals of the score difference between the first
+    // player and the others, see ArenaRoom::run_games
+    long long differences = 0;
+    long long squared_differences = 0;
+
+    GroupResults(int positions = 0);
+
+    GroupResults& operator+=(const GroupResults& other);
+};
+
+// Finished tasks of an arena run, with their results, which is all that is needed
+// to play the remaining tasks later. Games are seeded by their group and index,
+// so a resumed run ends with the same results as an uninterrupted one
+struct ArenaCheckpoint {
+    int seed = 0;
+    int count = 0;
+    int chunk = 1;
+    // Arena::checkpoint_settings of the run, which resumed runs should share
+    std::string settings;
+    std::vector<std::vector<int>> group_ids;
+    std::vector<ArenaTask> done;
+    // Per group
+    std::vector<GroupResults> results;
+    // Per player of the arena
+    std::vector<long long> moves;
+    std::vector<long long> times;
+    long long process_time = 0;
+
+    ArenaCheckpoint() = default;
+    ArenaCheckpoint(int seed, int count, int chunk, std::vector<std::vector<int>> group_ids, int player_count);
+
+    void add_task(ArenaTask task, const GroupResults& task_results);
+    // Adds the tasks, results and counters of "other", from the same run
+    void merge(const ArenaCheckpoint& other);
+    // Tasks of "chunk" games not done yet, group by group
+    std::vector<ArenaTask> remaining_tasks() const;
+    int finished_games(int group) const;
+
+    // Written to a temporary file first, then renamed, so
+    // that an interrupted write keeps the previous checkpoint
+    void write(const std::string& path) const;
+    static ArenaCheckpoint read(const std::string& path);
+};
+
+#endif //ARENA_CHECKPOINT_HPP
@@ -0,0 +1,568 @@
+#include "arena_network.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <netdb.h>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+const std::string UNIX_PREFIX = "unix:";
+
+bool
+is_unix(const std::string& address) {
+    return address.compare(0, UNIX_PREFIX.size(), UNIX_PREFIX) == 0;
+}
+
+// Socket listening on "address", or connected to it. Connecting
+// returns -1 on failure, so that workers can retry
+int
+open_socket(const std::string& address, bool listening) {
+    if (is_unix(address)) {
+        std::string path = address.substr(UNIX_PREFIX.size());
+        sockaddr_un name{};
+        if (path.empty() || path.size() >= sizeof(name.sun_path)) {
+            throw std::invalid_argument("Invalid socket path: " + path);
+        }
+        name.sun_family = AF_UNIX;
+        std::strncpy(name.sun_path, path.c_str(), sizeof(name.sun_path) - 1);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            throw std::runtime_error("Could not create socket: " + std::string(std::strerror(errno)));
+        }
+        if (listening) {
+            unlink(path.c_str());
+            if (bind(fd, (sockaddr*)&name, sizeof(name)) < 0 || listen(fd, SOMAXCONN) < 0) {
+                close(fd);
+                throw std::runtime_error("Could not listen to " + address + ": " + std::strerror(errno));
+            }
+        } else if (connect(fd, (sockaddr*)&name, sizeof(name)) < 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    std::size_t colon = address.rfind(':');
+    if (colon == std::string::npos) {
+        throw std::invalid_argument("Address should be 'unix:<path>' or '<host>:<port>': " + address);
+    }
+    std::string host = address.substr(0, colon);
+    std::string port = address.substr(colon + 1);
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listening ? AI_PASSIVE : 0;
+    addrinfo* infos = nullptr;
+    int error = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &infos);
+    if (error != 0) {
+        throw std::invalid_argument("Invalid address " + address + ": " + gai_strerror(error));
+    }
+    int fd = -1;
+    for (addrinfo* info = infos; info != nullptr && fd < 0; info = info->ai_next) {
+        fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        bool opened;
+        if (listening) {
+            int reuse = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+            opened = bind(fd, info->ai_addr, info->ai_addrlen) == 0 && listen(fd, SOMAXCONN) == 0;
+        } else {
+            opened = connect(fd, info->ai_addr, info->ai_addrlen) == 0;
+        }
+        if (!opened) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(infos);
+    if (fd < 0 && listening) {
+        throw std::runtime_error("Could not listen to " + address);
+    }
+    return fd;
+}
+
+} // namespace
+
+
+// LineSocket
+
+LineSocket::LineSocket(int fd)
+  : fd(fd)
+  , buffer() {}
+
+int
+LineSocket::get_fd() const {
+    return fd;
+}
+
+bool
+LineSocket::receive() {
+    char chunk[4096];
+    ssize_t size = recv(fd, chunk, sizeof(chunk), 0);
+    if (size < 0 && errno == EINTR) {
+        return true;
+    }
+    if (size <= 0) {
+        return false;
+    }
+    buffer.append(chunk, size);
+    return true;
+}
+
+bool
+LineSocket::next_line(std::string& line) {
+    std::size_t end = buffer.find('\n');
+    if (end == std::string::npos) {
+        return false;
+    }
+    line = buffer.substr(0, end);
+    buffer.erase(0, end + 1);
+    return true;
+}
+
+bool
+LineSocket::read_line(std::string& line) {
+    while (!next_line(line)) {
+        if (!receive()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+LineSocket::write_line(const std::string& line) {
+    std::string data = line + '\n';
+    std::size_t sent = 0;
+    while (sent < data.size()) {
+        // A closed peer is reported as an error instead of SIGPIPE
+        ssize_t size = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (size < 0 && errno == EINTR) {
+            continue;
+        }
+        if (size <= 0) {
+            return false;
+        }
+        sent += size;
+    }
+    return true;
+}
+
+void
+LineSocket::close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+
+// ArenaCoordinator
+
+ArenaCoordinator::ArenaCoordinator(Arena& arena, std::string address)
+  : arena(arena)
+  , address(address)
+  , finished_shards(0) {}
+
+// Workers are forked before any thread is started, and only keep the arena
+void
+ArenaCoordinator::spawn_local_workers(int count, int listener) {
+    std::cout << std::flush;
+    for (int i = 0; i < count; i++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            throw std::runtime_error("Could not fork a local worker: " + std::string(std::strerror(errno)));
+        }
+        if (pid == 0) {
+            close(listener);
+            // Each local worker writes its own records
+            if (!arena.record_path.empty()) {
+                arena.record_path += "." + std::to_string(i);
+            }
+            int code = 0;
+            try {
+                ArenaWorker(arena, address).run();
+            } catch (const std::exception& e) {
+                std::cerr << "Local worker: " << e.what() << std::endl;
+                code = 1;
+            }
+            _exit(code);
+        }
+        local_workers.push_back(pid);
+    }
+}
+
+bool
+ArenaCoordinator::local_workers_running() {
+    auto it = local_workers.begin();
+    while (it != local_workers.end()) {
+        if (waitpid(*it, nullptr, WNOHANG) != 0) {
+            it = local_workers.erase(it);
+        } else {
+            it++;
+        }
+    }
+    return !local_workers.empty();
+}
+
+void
+ArenaCoordinator::accept_peer(int listener) {
+    int fd = accept(listener, nullptr, nullptr);
+    if (fd >= 0) {
+        peers.push_back(Peer{ LineSocket(fd), false, false, ArenaTask(), std::chrono::steady_clock::now() });
+    }
+}
+
+std::string
+ArenaCoordinator::settings(const Arena& arena) {
+    return arena.settings();
+}
+
+// Returns false if the peer sent an invalid message, and should be dropped
+bool
+ArenaCoordinator::handle_line(Peer& peer, const std::string& line) {
+    std::istringstream in(line);
+    std::string kind;
+    in >> kind;
+    if (kind == "hello" && !peer.ready) {
+        std::string seed;
+        in >> seed;
+        std::string worker_settings;
+        std::getline(in, worker_settings);
+        std::string expected = settings(arena);
+        std::string rejected;
+        if (worker_settings != " " + expected) {
+            std::cerr << "Rejected a worker with settings '" << worker_settings.substr(worker_settings.empty() ? 0 : 1) << "' instead of '" << expected << "'" << std::endl;
+            rejected = "settings " + expected;
+        } else if (seed != "-" && seed != std::to_string(arena.seed)) {
+            std::cerr << "Rejected a worker with seed " << seed << " instead of " << arena.seed << std::endl;
+            rejected = "seed " + std::to_string(arena.seed);
+        }
+        if (!rejected.empty()) {
+            peer.socket.write_line("rejected " + rejected);
+            return false;
+        }
+        peer.ready = true;
+        // Games are seeded from the seed of the coordinator, wherever they are played
+        if (!peer.socket.write_line("seed " + std::to_string(arena.seed))) {
+            return false;
+        }
+        send_shard(peer);
+        return true;
+    }
+    if (kind == "alive") {
+        return peer.ready;
+    }
+    if (kind != "result" || !peer.busy) {
+        return false;
+    }
+    ArenaTask shard;
+    long long execution_time;
+    in >> shard.group >> shard.first >> shard.count >> execution_time;
+    if (!in || shard.group != peer.shard.group || shard.first != peer.shard.first || shard.count != peer.shard.count) {
+        return false;
+    }
+    // Results are only added once complete, so a shard is never counted twice
+    GroupResults results(arena.group_ids[shard.group].size());
+    for (std::vector<int>* values : { &results.wins, &results.scores, &results.squared_scores }) {
+        for (int& value : *values) {
+            in >> value;
+        }
+    }
+    in >> results.differences >> results.squared_differences;
+    std::vector<long long> counters(2 * arena.players.size());
+    for (long long& counter : counters) {
+        in >> counter;
+    }
+    if (!in) {
+        return false;
+    }
+    ArenaCheckpoint& finished = arena.restored;
+    finished.add_task(shard, results);
+    for (std::size_t player = 0; player < arena.players.size(); player++) {
+        finished.moves[player] += counters[player];
+        finished.times[player] += counters[arena.players.size() + player];
+    }
+    finished.process_time += execution_time;
+    arena.progress[0].games += shard.count;
+    remaining_games[shard.group] -= shard.count;
+    if (arena.test_group(shard, results)) {
+        drop_shards(shard.group);
+    }
+    if (remaining_games[shard.group] == 0) {
+        arena.progress[0].groups++;
+    }
+    finished_shards++;
+    peer.busy = false;
+    send_shard(peer);
+    return true;
+}
+
+// Queued shards of a stopped group are dropped, and count as finished
+void
+ArenaCoordinator::drop_shards(int group) {
+    std::deque<ArenaTask> kept;
+    for (const ArenaTask& shard : shards) {
+        if (shard.group == group) {
+            remaining_games[group] -= shard.count;
+            finished_shards++;
+        } else {
+            kept.push_back(shard);
+        }
+    }
+    shards.swap(kept);
+}
+
+void
+ArenaCoordinator::send_shard(Peer& peer) {
+    if (shards.empty() || peer.busy || !peer.ready) {
+        return;
+    }
+    ArenaTask shard = shards.front();
+    shards.pop_front();
+    std::string message = "shard " + std::to_string(shard.group) + " " + std::to_string(shard.first) + " " + std::to_string(shard.count);
+    if (!peer.socket.write_line(message)) {
+        shards.push_front(shard);
+        return;
+    }
+    peer.shard = shard;
+    peer.busy = true;
+}
+
+// The shard of the peer goes back to the front of the queue
+void
+ArenaCoordinator::disconnect(Peer& peer) {
+    if (peer.busy) {
+        shards.push_front(peer.shard);
+        peer.busy = false;
+        if (arena.stopped[peer.shard.group]) {
+            drop_shards(peer.shard.group);
+            arena.progress[0].groups += remaining_games[peer.shard.group] == 0;
+        }
+    }
+    peer.socket.close();
+}
+
+void
+ArenaCoordinator::run(int local_worker_count, bool resume) {
+    auto begin_instant = std::chrono::system_clock::now();
+    std::cout << "Mode: " << arena.mode_name() << " (coordinator on " << address << ")\n";
+    if (resume) {
+        arena.restored = ArenaCheckpoint::read(arena.checkpoint_path);
+    }
+    arena.resuming = resume;
+    arena.prepare();
+    arena.resuming = false;
+    std::vector<ArenaTask> pending = arena.pending_tasks();
+    shards.assign(pending.begin(), pending.end());
+    remaining_games.assign(arena.total_groups, 0);
+    for (const ArenaTask& shard : pending) {
+        remaining_games[shard.group] += shard.count;
+    }
+    std::size_t total_shards = shards.size();
+    finished_shards = 0;
+
+    int listener = open_socket(address, true);
+    spawn_local_workers(local_worker_count, listener);
+    auto last_report = std::chrono::steady_clock::now();
+    auto last_checkpoint = last_report;
+    while (finished_shards < total_shards) {
+        std::vector<pollfd> fds;
+        fds.push_back(pollfd{ listener, POLLIN, 0 });
+        for (const Peer& peer : peers) {
+            fds.push_back(pollfd{ peer.socket.get_fd(), POLLIN, 0 });
+        }
+        if (poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR) {
+            throw std::runtime_error("Coordinator could not poll its workers: " + std::string(std::strerror(errno)));
+        }
+        // Backwards, so that dropping a peer keeps the indices of the next ones
+        for (std::size_t i = peers.size(); i-- > 0;) {
+            if (!(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            Peer& peer = peers[i];
+            bool open = peer.socket.receive();
+            peer.last_message = std::chrono::steady_clock::now();
+            std::string line;
+            while (open && peer.socket.next_line(line)) {
+                open = handle_line(peer, line);
+            }
+            if (!open) {
+                disconnect(peer);
+                peers.erase(peers.begin() + i);
+            }
+        }
+        // Hung workers would hold their shard forever
+        auto now = std::chrono::steady_clock::now();
+        for (std::size_t i = peers.size(); i-- > 0;) {
+            if (now - peers[i].last_message > std::chrono::milliseconds(timeout)) {
+                std::cerr << "Dropped a worker silent for more than " << timeout << " ms" << std::endl;
+                disconnect(peers[i]);
+                peers.erase(peers.begin() + i);
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            accept_peer(listener);
+        }
+        // Shards given back by lost workers go to idle ones
+        for (Peer& peer : peers) {
+            send_shard(peer);
+        }
+        if (peers.empty() && local_worker_count > 0 && !local_workers_running()) {
+            close(listener);
+            throw std::runtime_error("All local workers stopped before the end of the arena");
+        }
+        if (arena.report_interval > 0 && now - last_report >= std::chrono::milliseconds(arena.report_interval)) {
+            arena.print_current();
+            last_report = now;
+        }
+        if (!arena.checkpoint_path.empty() && now - last_checkpoint >= std::chrono::seconds(arena.checkpoint_interval)) {
+            arena.save_checkpoint(arena.restored);
+            last_checkpoint = now;
+        }
+    }
+    for (Peer& peer : peers) {
+        peer.socket.write_line("done");
+        peer.socket.close();
+    }
+    peers.clear();
+    close(listener);
+    if (is_unix(address)) {
+        unlink(address.substr(UNIX_PREFIX.size()).c_str());
+    }
+    for (pid_t pid : local_workers) {
+        waitpid(pid, nullptr, 0);
+    }
+    local_workers.clear();
+    arena.save_checkpoint(arena.restored);
+    arena.set_results(arena.restored);
+    if (arena.report_interval > 0) {
+        arena.print_current();
+    }
+    auto end_instant = std::chrono::system_clock::now();
+    arena.real_time = std::chrono::duration_cast<std::chrono::microseconds>(end_instant - begin_instant).count();
+    std::cout << std::endl;
+}
+
+
+// ArenaWorker
+
+ArenaWorker::ArenaWorker(Arena& arena, std::string address)
+  : arena(arena)
+  , address(address) {}
+
+// Plays the shards sent by the coordinator until it is done. Results are
+// written under "writing", shared with the alive messages
+void
+ArenaWorker::play_shards(LineSocket& socket, ArenaRoom& room, std::mutex& writing) {
+    std::string line;
+    while (socket.read_line(line)) {
+        std::istringstream in(line);
+        std::string kind;
+        in >> kind;
+        if (kind == "done") {
+            break;
+        }
+        if (kind == "rejected") {
+            throw std::runtime_error("Rejected by the coordinator, which expects the " + line.substr(kind.size() + 1));
+        }
+        if (kind == "seed") {
+            in >> arena.seed;
+            continue;
+        }
+        ArenaTask shard;
+        in >> shard.group >> shard.first >> shard.count;
+        if (kind != "shard" || !in || shard.group < 0 || shard.group >= int(arena.group_ids.size())) {
+            throw std::runtime_error("Unexpected message from coordinator: " + line);
+        }
+        GroupResults results = room.play(shard);
+        // Sends the results of the shard, and clears the counters for the next one
+        std::ostringstream out;
+        out << "result " << shard.group << " " << shard.first << " " << shard.count << " " << room.execution_time;
+        for (const std::vector<int>* values : { &results.wins, &results.scores, &results.squared_scores }) {
+            for (int value : *values) {
+                out << " " << value;
+            }
+        }
+        out << " " << results.differences << " " << results.squared_differences;
+        for (const auto& player : room.players) {
+            out << " " << player->move_counter;
+        }
+        for (const auto& player : room.players) {
+            out << " " << player->time;
+        }
+        for (const auto& player : room.players) {
+            player->move_counter = 0;
+            player->time = 0;
+        }
+        room.execution_time = 0;
+        std::lock_guard<std::mutex> lock(writing);
+        if (!socket.write_line(out.str())) {
+            break;
+        }
+    }
+}
+
+void
+ArenaWorker::run() {
+    arena.prepare();
+    // The coordinator may start after its remote workers
+    int fd = -1;
+    for (int attempt = 0; attempt < 100 && fd < 0; attempt++) {
+        fd = open_socket(address, false);
+        if (fd < 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    if (fd < 0) {
+        throw std::runtime_error("Could not connect to " + address);
+    }
+    LineSocket socket(fd);
+    if (!arena.record_path.empty()) {
+        arena.records = std::make_shared<GameRecordWriter>(arena.record_path, arena.rules);
+    }
+    ArenaRoom room(&arena, 0);
+    socket.write_line("hello " + (seeded ? std::to_string(arena.seed) : "-") + " " + ArenaCoordinator::settings(arena));
+    // Tells the coordinator that the worker is alive while it plays long shards
+    std::mutex writing;
+    std::condition_variable stopping;
+    bool stopped = false;
+    std::thread alive([&]() {
+        std::unique_lock<std::mutex> lock(writing);
+        while (!stopping.wait_for(lock, std::chrono::milliseconds(keepalive), [&stopped]() { return stopped; })) {
+            socket.write_line("alive");
+        }
+    });
+    auto stop_alive = [&]() {
+        {
+            std::lock_guard<std::mutex> lock(writing);
+            stopped = true;
+        }
+        stopping.notify_all();
+        alive.join();
+    };
+    try {
+        play_shards(socket, room, writing);
+    } catch (...) {
+        stop_alive();
+        socket.close();
+        arena.records.reset();
+        throw;
+    }
+    stop_alive();
+    socket.close();
+    arena.records.reset();
+}
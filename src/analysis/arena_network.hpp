@@ -0,0 +1,114 @@
+#ifndef ARENA_NETWORK_HPP
+#define ARENA_NETWORK_HPP
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "arena.hpp"
+#include "arena_room.hpp"
+
+// Arena played by several processes, possibly on several machines.
+// The coordinator splits the groups of its arena in shards of "chunk_size"
+// games, and sends them to workers connected to its socket. Workers are
+// arenas with the same settings, which play a shard and send back its
+// results. Shards of a worker that disconnects, or stays silent for
+// "timeout" milliseconds, are sent to another one.
+//
+// Addresses are "unix:<path>" for a local socket, or "<host>:<port>" for TCP.
+// Messages are lines of space separated words:
+//   worker:      hello <seed, or - if not chosen> <settings>, see ArenaCoordinator::settings
+//   coordinator: rejected <expected settings or seed>, if they differ, or
+//                seed <seed>, once, then shard <group> <first game> <games> | done
+//   worker:      alive, every "keepalive" milliseconds
+//                result <group> <first game> <games> <execution time>
+//                       <wins> <scores> <squared scores> (one per position)
+//                       <differences> <squared differences>
+//                       <moves> <times> (one per player of the arena)
+
+// Reads and writes lines on a connected socket
+class LineSocket {
+private:
+    int fd;
+    std::string buffer;
+
+public:
+    LineSocket(int fd);
+
+    int get_fd() const;
+    // Reads what is available, returns false if the connection is closed
+    bool receive();
+    // Takes the next complete line out of what was received
+    bool next_line(std::string& line);
+    // Waits for the next line, returns false if the connection is closed
+    bool read_line(std::string& line);
+    bool write_line(const std::string& line);
+    void close();
+};
+
+class ArenaCoordinator {
+private:
+    struct Peer {
+        LineSocket socket;
+        bool ready;
+        bool busy;
+        ArenaTask shard;
+        std::chrono::steady_clock::time_point last_message;
+    };
+
+    Arena& arena;
+    std::string address;
+    std::deque<ArenaTask> shards;
+    std::vector<Peer> peers;
+    std::vector<pid_t> local_workers;
+    // Finished shards are added to the checkpoint of the arena
+    std::vector<int> remaining_games;
+    std::size_t finished_shards;
+
+    void spawn_local_workers(int count, int listener);
+    bool local_workers_running();
+    void accept_peer(int listener);
+    bool handle_line(Peer& peer, const std::string& line);
+    void send_shard(Peer& peer);
+    void drop_shards(int group);
+    void disconnect(Peer& peer);
+
+public:
+    // Workers silent for this many milliseconds are dropped
+    int timeout = 60000;
+
+    ArenaCoordinator(Arena& arena, std::string address);
+
+    // Rules, options and player types of "arena", which workers should share
+    static std::string settings(const Arena& arena);
+
+    // Plays all games of the arena on workers, "local_worker_count" of them
+    // being processes forked from this one. If "resume", only the games missing
+    // from the checkpoint of the arena are played, see Arena::resume
+    void run(int local_worker_count = 0, bool resume = false);
+};
+
+class ArenaWorker {
+private:
+    Arena& arena;
+    std::string address;
+
+    void play_shards(LineSocket& socket, ArenaRoom& room, std::mutex& writing);
+
+public:
+    // If set, the coordinator rejects the worker unless it has the same seed
+    bool seeded = false;
+    // Milliseconds between two alive messages, to stay under the timeout of the coordinator
+    int keepalive = 10000;
+
+    ArenaWorker(Arena& arena, std::string address);
+
+    // Plays shards until the coordinator is done, or unreachable. Games are recorded
+    // at the record path of the arena, with the index of local workers appended
+    void run();
+};
+
+#endif //ARENA_NETWORK_HPP
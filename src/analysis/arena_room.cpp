@@ -1,91 +1,174 @@
 #include "arena_room.hpp"
 
-ArenaRoom::ArenaRoom(Arena* arena)
+#include <algorithm>
+#include <typeinfo>
+
+#include "players/first_legal_player.hpp"
+#include "players/random_player.hpp"
+
+ArenaRoom::ArenaRoom(Arena* arena, int worker)
   : arena(arena)
+  , worker(worker)
   , players()
-  , results(arena->players.size(), std::vector<int>(arena->column_count(), 0))
-  , execution_time(0LL) {
+  , execution_time(0LL)
+  , mutex()
+  , finished(arena->seed, arena->count, arena->restored.chunk, arena->group_ids, arena->players.size()) {
     for (auto it = arena->players.begin(); it != arena->players.end(); it++) {
         players.push_back(std::static_pointer_cast<AnalysisPlayer>((*it)->copy()));
     }
 }
 
-ArenaRoom::ArenaRoom(const ArenaRoom& room)
-  : arena(room.arena)
-  , players(room.players)
-  , results(room.results)
-  , execution_time(room.execution_time) {}
+// Only this room writes its counters, so they need no atomic increment
+void
+ArenaRoom::add_progress(std::atomic<int>& counter, int value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+GroupResults
+ArenaRoom::play(ArenaTask task) {
+    const std::vector<int>& ids = arena->group_ids[task.group];
+    GroupResults results(ids.size());
+    std::vector<BatchGame::Policy> policies;
+    if (arena->batch_size > 0 && !arena->duplicate && !arena->records && batch_policies(ids, policies)) {
+        run_batch(ids, policies, task, results);
+    } else {
+        run_games(ids, task, results);
+    }
+    return results;
+}
+
+void
+ArenaRoom::run_task(ArenaTask task) {
+    GroupResults results = play(task);
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        finished.add_task(task, results);
+        for (size_t player = 0; player < players.size(); player++) {
+            finished.moves[player] = players[player]->move_counter;
+            finished.times[player] = players[player]->time;
+        }
+        finished.process_time = execution_time;
+    }
+    arena->test_group(task, results);
+    finish_task(task);
+}
+
+void
+ArenaRoom::finish_task(ArenaTask task) {
+    if (--arena->remaining_tasks[task.group] == 0) {
+        add_progress(arena->progress[worker].groups, 1);
+    }
+}
 
+// Each game and its players are seeded from the arena seed, the group and the game index.
+// With duplicate deals, the tiles are seeded from the deal only, and the seats are rotated
+// between the games of a deal: the differences between the score of the first player
+// and the others, summed over a deal, then measure the players on the same draws
 void
-ArenaRoom::run_single(std::vector<int> ids) {
+ArenaRoom::run_games(const std::vector<int>& ids, ArenaTask task, GroupResults& results) {
     int p = ids.size();
+    int first_positions = std::count(ids.begin(), ids.end(), ids.front());
+    long long difference = 0;
     Game game = Game(arena->rules);
+    game.enable_legal_masks();
     for (int id : ids) {
         game.add_player(players[id]);
     }
-    std::vector<int> win_count(p, 0);
-    std::vector<int> score_sum(p, 0);
-    std::vector<int> squared_score_sum(p, 0);
-    for (int c = 0; c < arena->count; c++) {
+    if (arena->records) {
+        game.add_observer(std::make_shared<GameRecorder>(arena->records));
+    }
+    std::vector<ushort> order(p);
+    for (int k = task.first; k < task.first + task.count; k++) {
+        if (arena->duplicate) {
+            game.reseed(arena->deal_seed(k / p));
+            for (int seat = 0; seat < p; seat++) {
+                order[seat] = (seat + k) % p;
+            }
+            game.set_order(order);
+        } else {
+            game.reseed(arena->game_seed(task.group, k));
+        }
+        for (int position = 0; position < p; position++) {
+            players[ids[position]]->reseed(arena->game_seed(task.group, k, position + 1));
+        }
         auto begin = std::chrono::high_resolution_clock::now();
         game.roll_game();
         auto end = std::chrono::high_resolution_clock::now();
         int winner = game.order[game.state.winning_player()];
-        win_count[winner] += 1;
+        results.wins[winner] += 1;
         for (int position = 0; position < p; position++) {
             int id = game.order[position];
             int score = game.state.get_panel(position).get_score();
-            score_sum[id] += score;
-            squared_score_sum[id] += score * score;
+            results.scores[id] += score;
+            results.squared_scores[id] += score * score;
+            difference += ids[id] == ids.front() ? (p - first_positions) * score : -first_positions * score;
+        }
+        if (arena->duplicate && (k + 1) % p == 0) {
+            results.differences += difference;
+            results.squared_differences += difference * difference;
+            difference = 0;
         }
         execution_time += std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
-        arena->processed_games++;
-        arena->print_current();
+        add_progress(arena->progress[worker].games, 1);
     }
-    arena->add_results(results, ids, win_count, score_sum, squared_score_sum);
-    arena->processed_groups++;
-    arena->print_current();
 }
 
-void
-ArenaRoom::run_sequential() {
-    while (!arena->groups.empty()) {
-        run_single(arena->groups.front());
-        arena->groups.pop();
+// Policies of the players of the group, if they all play like one
+bool
+ArenaRoom::batch_policies(const std::vector<int>& ids, std::vector<BatchGame::Policy>& policies) const {
+    policies.clear();
+    for (int id : ids) {
+        const Player& player = *players[id]->analysed_player;
+        if (typeid(player) == typeid(RandomPlayer)) {
+            bool smart = static_cast<const RandomPlayer&>(player).smart;
+            policies.push_back(smart ? BatchGame::SMART_RANDOM : BatchGame::RANDOM);
+        } else if (typeid(player) == typeid(FirstLegalPlayer)) {
+            policies.push_back(BatchGame::FIRST_LEGAL);
+        } else {
+            return false;
+        }
     }
+    return true;
 }
 
+// Same results as run_games, with games played "batch_size" at a time.
+// The batch is seeded from the first game of the task
 void
-ArenaRoom::run_async() {
-    while (!arena->groups.empty()) {
-        std::vector<int> ids;
-        {
-            const std::lock_guard<std::mutex> lock(arena->queue_mutex);
-            if (arena->groups.empty()) {
-                break;
+ArenaRoom::run_batch(const std::vector<int>& ids, std::vector<BatchGame::Policy> policies, ArenaTask task, GroupResults& results) {
+    int p = ids.size();
+    int count = task.count;
+    BatchGame batch(arena->rules, policies, std::max(1, std::min(arena->batch_size, count)), arena->game_seed(task.group, task.first));
+    for (int done = 0; done < count; done += batch.get_size()) {
+        int games = std::min(batch.get_size(), count - done);
+        auto begin = std::chrono::high_resolution_clock::now();
+        batch.roll_games(games);
+        auto end = std::chrono::high_resolution_clock::now();
+        for (int game = 0; game < games; game++) {
+            results.wins[batch.get_winner(game)] += 1;
+            for (int position = 0; position < p; position++) {
+                int score = batch.get_score(game, position);
+                results.scores[position] += score;
+                results.squared_scores[position] += score * score;
             }
-            ids = arena->groups.front();
-            arena->groups.pop();
         }
-        run_single(ids);
+        for (int position = 0; position < p; position++) {
+            players[ids[position]]->move_counter += batch.get_move_count(position);
+            players[ids[position]]->time += batch.get_move_time(position);
+        }
+        execution_time += std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+        add_progress(arena->progress[worker].games, games);
     }
 }
 
 void
 ArenaRoom::run() {
-    arena->is_sequential() ? run_sequential() : run_async();
-    // Send data back to arena
-    const std::lock_guard<std::mutex> lock(arena->results_mutex);
-    int player = 0;
-    for (auto local_player = players.begin(); local_player != players.end(); local_player++) {
-        arena->players[player]->time += (*local_player)->time;
-        arena->players[player]->move_counter += (*local_player)->move_counter;
-        int column = 0;
-        for (auto local_line = results[player].begin(); local_line != results[player].end(); local_line++) {
-            arena->results[player][column] += *local_line;
-            column++;
+    ArenaTask task;
+    while (arena->tasks->pop(worker, task)) {
+        // Tasks of stopped groups are dropped
+        if (arena->stopped[task.group]) {
+            finish_task(task);
+        } else {
+            run_task(task);
         }
-        player++;
     }
-    arena->process_time += execution_time;
-}
\ No newline at end of file
+}
@@ -2,34 +2,46 @@
 #define ARENA_ROOM_HPP
 
 #include "arena.hpp"
+#include "arena_checkpoint.hpp"
+#include "game/batch_game.hpp"
 #include "global.hpp"
 
 #include <memory>
+#include <mutex>
 #include <thread>
 
+// Worker of an Arena, playing tasks from its pool with its own copy of the players.
+// Results of finished tasks are kept per group, and merged by the arena for
+// checkpoints and once all rooms are done
 class ArenaRoom {
 private:
     Arena* arena;
+    int worker;
     std::vector<std::shared_ptr<AnalysisPlayer>> players;
-    std::vector<std::vector<int>> results;
-
-    std::thread thread;
 
     long long execution_time;
 
-    ArenaRoom(Arena* arena);
+    // Guards "finished", which the arena reads while the room plays
+    std::mutex mutex;
+    ArenaCheckpoint finished;
 
-    void run_single(std::vector<int> ids);
+    ArenaRoom(Arena* arena, int worker);
 
-    void run_sequential();
-    void run_async();
+    void static add_progress(std::atomic<int>& counter, int value);
+    GroupResults play(ArenaTask task);
+    void run_task(ArenaTask task);
+    void finish_task(ArenaTask task);
+    void run_games(const std::vector<int>& ids, ArenaTask task, GroupResults& results);
+    bool batch_policies(const std::vector<int>& ids, std::vector<BatchGame::Policy>& policies) const;
+    void run_batch(const std::vector<int>& ids, std::vector<BatchGame::Policy> policies, ArenaTask task, GroupResults& results);
 
 public:
-    ArenaRoom(const ArenaRoom& arena);
+    ArenaRoom(const ArenaRoom& room) = delete;
 
     void run();
 
-    friend void Arena::run();
+    friend class Arena;
+    friend class ArenaWorker;
 };
 
 #endif //ARENA_ROOM_HPP
@@ -0,0 +1,120 @@
+#include "game_runner.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+#include "utils/bits.hpp"
+
+namespace {
+
+// Counts the moves of each player of a game, and keeps its actions if asked
+class MoveRecorder : public Observer {
+private:
+    const Game& game;
+
+public:
+    std::vector<ushort> order;
+    std::vector<int16_t> moves;
+    std::vector<int8_t>* actions = nullptr;
+
+    MoveRecorder(const Game& game)
+      : game(game)
+      , order()
+      , moves() {}
+
+    void start_game(std::vector<ushort> _order) override {
+        order = std::move(_order);
+        moves.assign(order.size(), 0);
+    }
+
+    void action_played(Action action) override {
+        ushort player = order[game.get_state().get_current_player()];
+        moves[player]++;
+        if (actions != nullptr) {
+            actions->push_back(player);
+            actions->push_back(action.pick);
+            actions->push_back(ushort(action.color));
+            actions->push_back(action.place);
+        }
+    }
+};
+
+} // namespace
+
+GameRunner::GameRunner(std::shared_ptr<const Rules> rules, std::vector<std::shared_ptr<Player>> players)
+  : rules(rules)
+  , players(std::move(players))
+  , thread_limit(std::max(1u, std::thread::hardware_concurrency())) {
+    if (this->players.size() != rules->player_count) {
+        throw std::invalid_argument("GameRunner needs one player per seat");
+    }
+    for (const std::shared_ptr<Player>& player : this->players) {
+        if (!player->check_rules(*rules)) {
+            throw std::invalid_argument("Player " + player->player_type() + " does not support the rules");
+        }
+    }
+}
+
+void
+GameRunner::run_thread(const std::vector<int>& seeds, std::atomic<int>& next, GameRunResults& results, std::vector<std::vector<int8_t>>& actions) const {
+    int p = players.size();
+    Game game(rules);
+    game.enable_legal_masks();
+    std::vector<std::shared_ptr<Player>> copies;
+    for (const std::shared_ptr<Player>& player : players) {
+        copies.push_back(player->copy());
+        game.add_player(copies.back());
+    }
+    std::shared_ptr<MoveRecorder> recorder = std::make_shared<MoveRecorder>(game);
+    game.add_observer(recorder);
+    for (int index = next++; index < int(seeds.size()); index = next++) {
+        int seed = seeds[index];
+        game.reseed(seed);
+        for (int player = 0; player < p; player++) {
+            copies[player]->reseed(int(mix64(uint64_t(uint32_t(seed)) << 3 | uint64_t(player + 1))));
+        }
+        recorder->actions = keep_actions ? &actions[index] : nullptr;
+        game.roll_game();
+        const State& state = game.get_state();
+        for (int seat = 0; seat < p; seat++) {
+            int player = recorder->order[seat];
+            results.orders[index * p + seat] = player;
+            results.scores[index * p + player] = state.get_panel(seat).get_score();
+            results.moves[index * p + player] = recorder->moves[player];
+        }
+        results.winners[index] = recorder->order[state.winning_player()];
+    }
+}
+
+GameRunResults
+GameRunner::run(const std::vector<int>& seeds) const {
+    int games = seeds.size();
+    int p = players.size();
+    GameRunResults results;
+    results.games = games;
+    results.players = p;
+    results.seeds.assign(seeds.begin(), seeds.end());
+    results.orders.assign(games * p, 0);
+    results.scores.assign(games * p, 0);
+    results.moves.assign(games * p, 0);
+    results.winners.assign(games, 0);
+    std::vector<std::vector<int8_t>> actions(keep_actions ? games : 0);
+    std::atomic<int> next(0);
+    std::vector<std::thread> threads;
+    int thread_count = std::max(1, std::min(thread_limit, games));
+    for (int i = 0; i < thread_count; i++) {
+        threads.push_back(std::thread(&GameRunner::run_thread, this, std::cref(seeds), std::ref(next), std::ref(results), std::ref(actions)));
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (keep_actions) {
+        results.action_offsets.push_back(0);
+        for (const std::vector<int8_t>& game_actions : actions) {
+            results.actions.insert(results.actions.end(), game_actions.begin(), game_actions.end());
+            results.action_offsets.push_back(results.actions.size() / 4);
+        }
+    }
+    return results;
+}
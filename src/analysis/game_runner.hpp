@@ -0,0 +1,50 @@
+#ifndef GAME_RUNNER_HPP
+#define GAME_RUNNER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "game/game.hpp"
+#include "game/player.hpp"
+#include "rules/rules.hpp"
+
+// Outcome of the games of a GameRunner, in flat arrays indexed by game. Players
+// are designated by their index in the players of the runner
+struct GameRunResults {
+    int games = 0;
+    int players = 0;
+    std::vector<int32_t> seeds;
+    // Player at each seat, games x players
+    std::vector<int8_t> orders;
+    // Final score and move count of each player, games x players
+    std::vector<int16_t> scores;
+    std::vector<int16_t> moves;
+    std::vector<int8_t> winners;
+    // If actions are kept, those of game "g" are rows "action_offsets[g]" to
+    // "action_offsets[g + 1]" of "actions", each row being player, pick, color, place
+    std::vector<int64_t> action_offsets;
+    std::vector<int8_t> actions;
+};
+
+// Plays one game per seed with copies of the same players, spread over threads.
+// Games are independent from the threads: a game and its players are seeded
+// from its seed only
+class GameRunner {
+private:
+    std::shared_ptr<const Rules> rules;
+    std::vector<std::shared_ptr<Player>> players;
+
+    void run_thread(const std::vector<int>& seeds, std::atomic<int>& next, GameRunResults& results, std::vector<std::vector<int8_t>>& actions) const;
+
+public:
+    int thread_limit;
+    bool keep_actions = false;
+
+    GameRunner(std::shared_ptr<const Rules> rules, std::vector<std::shared_ptr<Player>> players);
+
+    GameRunResults run(const std::vector<int>& seeds) const;
+};
+
+#endif //GAME_RUNNER_HPP
@@ -1,5 +1,7 @@
 #include "pairs_arena.hpp"
 
+#include <algorithm>
+
 int
 PairsArena::get_column(int opponent, int prop) const {
     return opponent * (rules->player_count - 1) + prop - 1;
@@ -7,6 +9,7 @@ PairsArena::get_column(int opponent, int prop) const {
 
 void
 PairsArena::add_results(
+    std::vector<std::vector<int>>& _results,
     const std::vector<int>& ids,
     const std::vector<int>& new_wins,
     const std::vector<int>& new_scores,
@@ -18,9 +21,9 @@ PairsArena::add_results(
         prop++;
     }
     int index = 0;
-    std::vector<int>* first_player_results = &results[first];
+    std::vector<int>* first_player_results = &_results[first];
     int first_player_colum = get_column(second, prop);
-    std::vector<int>* second_player_results = &results[second];
+    std::vector<int>* second_player_results = &_results[second];
     int second_player_colum = get_column(first, rules->player_count - prop);
     for (int id : ids) {
         std::vector<int>* player_results =
@@ -67,6 +70,14 @@ PairsArena::print_results(std::vector<std::vector<int>> results) {
     for (int line = 0; line < player_count; line++) {
         max_player_length = std::max(max_player_length, int(players[line]->analysed_player->player_type().size()));
     }
+    // Games played by each player against each opponent, in each proportion
+    std::vector<std::vector<int>> games(player_count, std::vector<int>(column_count() / 3, 0));
+    for (size_t group = 0; group < group_games.size(); group++) {
+        const std::vector<int>& ids = group_ids[group];
+        int prop = std::count(ids.begin(), ids.end(), ids.front());
+        games[ids.front()][get_column(ids.back(), prop)] += group_games[group] * prop;
+        games[ids.back()][get_column(ids.front(), rules->player_count - prop)] += group_games[group] * (rules->player_count - prop);
+    }
     printf("Games per group:  %d\n\n", count);
     // 1 - Player line
     printf("%*s ", max_player_length, "player");
@@ -112,10 +123,10 @@ PairsArena::print_results(std::vector<std::vector<int>> results) {
 
             for (int prop = 1; prop <= prop_count; prop++) {
                 int column = get_column(opponent, prop);
-                int games = count * prop;
-                double winrate = 100. * results[line][3 * column + 0] / games;
-                double avg_score = double(results[line][3 * column + 1]) / games;
-                double score_var = std::sqrt(double(results[line][3 * column + 2]) / games - avg_score * avg_score);
+                int played = games[line][column];
+                double winrate = 100. * results[line][3 * column + 0] / played;
+                double avg_score = double(results[line][3 * column + 1]) / played;
+                double score_var = std::sqrt(double(results[line][3 * column + 2]) / played - avg_score * avg_score);
                 printf("| %4.1f%% %5.1f %5.1f ",
                     winrate,
                     avg_score,
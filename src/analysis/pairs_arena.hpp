@@ -9,10 +9,11 @@ private:
 
 protected:
     void virtual add_results(
+        std::vector<std::vector<int>>& results,
         const std::vector<int>& ids,
         const std::vector<int>& new_wins,
         const std::vector<int>& new_scores,
-        const std::vector<int>& new_squared_scores);
+        const std::vector<int>& new_squared_scores) override;
 
     virtual int column_count() const;
     virtual void generate_groups(int available_players, int game_players);
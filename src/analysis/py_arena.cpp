@@ -1,8 +1,13 @@
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include <typeinfo>
+
 #include "all_arena.hpp"
 #include "arena.hpp"
+#include "arena_network.hpp"
+#include "game_runner.hpp"
 #include "pairs_arena.hpp"
 
 namespace py = pybind11;
@@ -49,10 +54,82 @@ public:
     }
 };
 
+// Array viewing the values, which it keeps alive without copying them
+template<class T>
+py::array_t<T>
+py_array(std::vector<T>&& values, std::vector<py::ssize_t> shape) {
+    std::vector<T>* owned = new std::vector<T>(std::move(values));
+    py::capsule owner(owned, [](void* pointer) { delete static_cast<std::vector<T>*>(pointer); });
+    return py::array_t<T>(shape, owned->data(), owner);
+}
+
+// Players implemented in Python need the GIL to play, so they cannot be run without it
+void
+py_check_builtin_player(const std::shared_ptr<Player>& player) {
+    py::handle type = py::detail::get_type_handle(typeid(*player), false);
+    if (!type || !py::type::of(py::cast(player)).is(type)) {
+        throw std::invalid_argument("run_games only runs players implemented in C++, not " + player->player_type());
+    }
+}
+
+py::dict
+py_run_games(
+    std::shared_ptr<Rules> rules,
+    std::vector<std::shared_ptr<Player>> players,
+    py::array_t<int32_t, py::array::c_style | py::array::forcecast> seeds,
+    int threads,
+    bool actions) {
+    for (const std::shared_ptr<Player>& player : players) {
+        py_check_builtin_player(player);
+    }
+    GameRunner runner(rules, players);
+    if (threads > 0) {
+        runner.thread_limit = threads;
+    }
+    runner.keep_actions = actions;
+    std::vector<int> game_seeds(seeds.data(), seeds.data() + seeds.size());
+    GameRunResults results;
+    {
+        py::gil_scoped_release release;
+        results = runner.run(game_seeds);
+    }
+    py::ssize_t games = results.games;
+    py::ssize_t p = results.players;
+    py::dict arrays;
+    arrays["seeds"] = py_array(std::move(results.seeds), { games });
+    arrays["orders"] = py_array(std::move(results.orders), { games, p });
+    arrays["scores"] = py_array(std::move(results.scores), { games, p });
+    arrays["moves"] = py_array(std::move(results.moves), { games, p });
+    arrays["winners"] = py_array(std::move(results.winners), { games });
+    if (actions) {
+        py::ssize_t rows = results.actions.size() / 4;
+        arrays["action_offsets"] = py_array(std::move(results.action_offsets), { games + 1 });
+        arrays["actions"] = py_array(std::move(results.actions), { rows, 4 });
+    }
+    return arrays;
+}
+
 void
 py_bind_arena(py::module& root) {
     py::module m = root.def_submodule("arena");
 
+    py::class_<StoppingRule> stopping_rule(m, "StoppingRule");
+
+    py::enum_<StoppingRule::Test>(stopping_rule, "Test")
+        .value("NONE", StoppingRule::Test::NONE)
+        .value("SPRT", StoppingRule::Test::SPRT)
+        .value("CONFIDENCE", StoppingRule::Test::CONFIDENCE);
+
+    stopping_rule
+        .def(py::init<StoppingRule::Test, double, double>(),
+            "test"_a = StoppingRule::Test::NONE,
+            "margin"_a = 0.05,
+            "error"_a = 0.05)
+        .def_readwrite("test", &StoppingRule::test)
+        .def_readwrite("margin", &StoppingRule::margin)
+        .def_readwrite("error", &StoppingRule::error)
+        .def_readwrite("min_games", &StoppingRule::min_games);
+
     py::class_<Arena, _PyArena>(m, "Arena")
         .def(py::init())
         .def(py::init<std::shared_ptr<Rules>, std::vector<std::shared_ptr<Player>>>(),
@@ -72,11 +149,22 @@ py_bind_arena(py::module& root) {
         .def_readwrite("count", &Arena::count)
         .def_readwrite("thread_limit", &Arena::thread_limit)
         .def_readwrite("detailed_player_analysis", &Arena::detailed_player_analysis)
+        .def_readwrite("batch_size", &Arena::batch_size)
+        .def_readwrite("chunk_size", &Arena::chunk_size)
+        .def_readwrite("report_interval", &Arena::report_interval)
+        .def_readwrite("seed", &Arena::seed)
+        .def_readwrite("checkpoint_path", &Arena::checkpoint_path)
+        .def_readwrite("checkpoint_interval", &Arena::checkpoint_interval)
+        .def_readwrite("duplicate", &Arena::duplicate)
+        .def_readwrite("record_path", &Arena::record_path)
+        .def_readwrite("stopping", &Arena::stopping)
         .def_readwrite("rules", &Arena::rules)
 
         .def("mode_name", &Arena::mode_name)
         .def("ready", &Arena::ready)
         .def("run", &Arena::run)
+        .def("resume", &Arena::resume)
+        .def("games_saved", &Arena::games_saved)
         .def("print", &Arena::print)
         .def("run_print", &Arena::run_print);
 
@@ -91,4 +179,37 @@ py_bind_arena(py::module& root) {
         .def(py::init<std::shared_ptr<Rules>, std::vector<std::shared_ptr<Player>>>(),
             "rules"_a,
             "players"_a = new std::vector<std::shared_ptr<Player>>());
+
+    // Arenas given to a coordinator or a worker are kept alive while they use them
+    py::class_<ArenaCoordinator>(m, "ArenaCoordinator")
+        .def(py::init<Arena&, std::string>(),
+            "arena"_a,
+            "address"_a,
+            py::keep_alive<1, 2>())
+        .def_readwrite("timeout", &ArenaCoordinator::timeout)
+        .def_static("settings", &ArenaCoordinator::settings)
+        .def("run", &ArenaCoordinator::run,
+            "local_workers"_a = 0,
+            "resume"_a = false,
+            py::call_guard<py::gil_scoped_release>());
+
+    py::class_<ArenaWorker>(m, "ArenaWorker")
+        .def(py::init<Arena&, std::string>(),
+            "arena"_a,
+            "address"_a,
+            py::keep_alive<1, 2>())
+        .def_readwrite("seeded", &ArenaWorker::seeded)
+        .def_readwrite("keepalive", &ArenaWorker::keepalive)
+        .def("run", &ArenaWorker::run, py::call_guard<py::gil_scoped_release>());
+
+    m.def("run_games",
+        &py_run_games,
+        "Plays one game per seed in C++ threads, without the GIL, and returns NumPy arrays:\n"
+        "seeds, orders (player of each seat), scores, moves, winners, and if 'actions',\n"
+        "actions (player, pick, color, place) with action_offsets delimiting each game",
+        "rules"_a,
+        "players"_a,
+        "seeds"_a,
+        "threads"_a = 0,
+        "actions"_a = false);
 }
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "stopping_rule.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// Two-sided quantile of the normal distribution: P(|X| > z) = error
+double
+normal_quantile(double error) {
+    double low = 0;
+    double high = 40;
+    for (int i = 0; i < 100; i++) {
+        double middle = (low + high) / 2;
+        if (std::erfc(middle / std::sqrt(2.)) > error) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+} // namespace
+
+StoppingRule::StoppingRule(Test test, double margin, double error)
+  : test(test)
+  , margin(margin)
+  , error(error) {
+    if (!(margin > 0 && margin < 1) || !(error > 0 && error < 1)) {
+        throw std::invalid_argument("Margin and error of a stopping rule should be in (0, 1)");
+    }
+}
+
+bool
+StoppingRule::decided(const std::vector<int>& ids, const GroupResults& results, int games, int checks) const {
+    if (test == NONE || games <= 0 || ids.empty()) {
+        return false;
+    }
+    // Sums over the positions of each player
+    int second = -1;
+    int positions[2] = { 0, 0 };
+    double wins[2] = { 0, 0 };
+    double scores[2] = { 0, 0 };
+    double squared_scores[2] = { 0, 0 };
+    for (std::size_t position = 0; position < ids.size(); position++) {
+        int side = ids[position] == ids.front() ? 0 : 1;
+        if (side == 1 && second >= 0 && ids[position] != second) {
+            return false;
+        }
+        if (side == 1) {
+            second = ids[position];
+        }
+        positions[side]++;
+        wins[side] += results.wins[position];
+        scores[side] += results.scores[position];
+        squared_scores[side] += results.squared_scores[position];
+    }
+    if (second < 0) {
+        return false;
+    }
+    double share = double(positions[0]) / ids.size();
+    if (test == SPRT) {
+        return sprt(share, wins[0], games);
+    }
+    // Mean and variance of the score of one position, then of the difference of the means
+    double means[2];
+    double variance = 0;
+    for (int side = 0; side < 2; side++) {
+        double samples = double(games) * positions[side];
+        means[side] = scores[side] / samples;
+        variance += std::max(0., squared_scores[side] / samples - means[side] * means[side]) / samples;
+    }
+    return confident(share, wins[0], games, means[0] - means[1], variance, checks);
+}
+
+bool
+StoppingRule::sprt(double share, double wins, int games) const {
+    double p0 = std::min(std::max(share - margin, 1e-3), 1 - 1e-3);
+    double p1 = std::min(std::max(share + margin, 1e-3), 1 - 1e-3);
+    if (p1 <= p0) {
+        return false;
+    }
+    double llr = wins * std::log(p1 / p0) + (games - wins) * std::log((1 - p1) / (1 - p0));
+    double upper = std::log((1 - error) / error);
+    return llr >= upper || llr <= -upper;
+}
+
+bool
+StoppingRule::confident(double share, double wins, int games, double difference, double difference_variance, int checks) const {
+    if (games < min_games) {
+        return false;
+    }
+    double z = normal_quantile(error / (2 * std::max(checks, 1)));
+    // Standard error of the win rate if the first player only wins its share
+    double win_error = std::sqrt(share * (1 - share) / games);
+    if (std::abs(wins / games - share) > z * win_error) {
+        return true;
+    }
+    return difference_variance > 0 && std::abs(difference) > z * std::sqrt(difference_variance);
+}
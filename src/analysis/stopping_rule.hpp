@@ -0,0 +1,44 @@
+#ifndef STOPPING_RULE_HPP
+#define STOPPING_RULE_HPP
+
+#include <vector>
+
+#include "arena_checkpoint.hpp"
+
+// Sequential test deciding that a group has played enough games, checked each time
+// one of its tasks is finished, so at most "checks" times. Only groups of two players,
+// the first one against the second one, can be stopped: other groups always play all their games
+class StoppingRule {
+public:
+    enum Test {
+        // All games are played
+        NONE,
+        // Sequential probability ratio test on the win rate of the first player, between
+        // its fair share minus "margin" and its fair share plus "margin"
+        SPRT,
+        // Stops once the confidence interval of the win rate of the first player
+        // excludes its fair share, or the one of the score difference excludes 0
+        CONFIDENCE,
+    };
+
+    Test test = NONE;
+    double margin = 0.05;
+    // Probability of a wrong decision for a group. CONFIDENCE splits it
+    // between the two intervals of each of its checks (Bonferroni correction)
+    double error = 0.05;
+    // CONFIDENCE approximates the means of the group by normal distributions, which
+    // needs enough games: it is not checked before this many
+    int min_games = 30;
+
+    StoppingRule() = default;
+    // Margin and error should be in (0, 1)
+    StoppingRule(Test test, double margin = 0.05, double error = 0.05);
+
+    bool decided(const std::vector<int>& ids, const GroupResults& results, int games, int checks) const;
+
+private:
+    bool sprt(double share, double wins, int games) const;
+    bool confident(double share, double wins, int games, double difference, double difference_variance, int checks) const;
+};
+
+#endif //STOPPING_RULE_HPP
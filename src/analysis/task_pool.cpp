@@ -0,0 +1,57 @@
+#include "task_pool.hpp"
+
+#include <stdexcept>
+
+TaskPool::TaskPool(int worker_count)
+  : queues(new Queue[worker_count])
+  , worker_count(worker_count) {
+    if (worker_count <= 0) {
+        throw std::invalid_argument("TaskPool needs at least one worker");
+    }
+}
+
+// Consecutive tasks, usually of the same group, go to different
+// workers, so that a long group is spread from the start
+void
+TaskPool::deal(const std::vector<ArenaTask>& tasks) {
+    int worker = 0;
+    for (const ArenaTask& task : tasks) {
+        push(worker, task);
+        worker = (worker + 1) % worker_count;
+    }
+}
+
+void
+TaskPool::push(int worker, ArenaTask task) {
+    Queue& queue = queues[worker];
+    const std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(task);
+}
+
+bool
+TaskPool::pop(int worker, ArenaTask& task) {
+    {
+        Queue& own = queues[worker];
+        const std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (int i = 1; i < worker_count; i++) {
+        Queue& other = queues[(worker + i) % worker_count];
+        const std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.tasks.empty()) {
+            task = other.tasks.front();
+            other.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+int
+TaskPool::get_worker_count() const {
+    return worker_count;
+}
@@ -0,0 +1,46 @@
+#ifndef TASK_POOL_HPP
+#define TASK_POOL_HPP
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Games of a group to play, a group being split in several tasks.
+// Games are numbered in their group, from "first" to "first + count - 1"
+struct ArenaTask {
+    int group;
+    int first;
+    int count;
+};
+
+// Work-stealing pool of tasks, with one deque per worker. A worker takes
+// tasks from the back of its own deque, and once it is empty, steals from
+// the front of the others. Tasks are all pushed before workers start, so a
+// worker finding every deque empty is done
+class TaskPool {
+private:
+    // Each deque has its own lock, and padding keeps them on separate cache
+    // lines, so that workers only contend when stealing
+    struct Queue {
+        std::mutex mutex;
+        std::deque<ArenaTask> tasks;
+        char padding[64];
+    };
+
+    std::unique_ptr<Queue[]> queues;
+    int worker_count;
+
+public:
+    TaskPool(int worker_count);
+
+    // Deals "tasks" to workers in turn
+    void deal(const std::vector<ArenaTask>& tasks);
+    void push(int worker, ArenaTask task);
+    // Sets "task" to the next task of "worker", returns false if there is none left
+    bool pop(int worker, ArenaTask& task);
+
+    int get_worker_count() const;
+};
+
+#endif //TASK_POOL_HPP
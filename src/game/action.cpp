@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 
 bool
 operator==(Action left, Action right) {
@@ -15,6 +16,20 @@ operator!=(Action left, Action right) {
 }
 
 
+Action
+index_action(ushort index, const Rules& rules) {
+    if (index >= action_index_count(rules)) {
+        throw std::invalid_argument("Action index " + std::to_string(index) + " is too big");
+    }
+    ushort n = rules.tile_types;
+    return Action{
+        .pick = ushort(index / (n * (n + 1))),
+        .color = Tile(ushort(index / (n + 1) % n)),
+        .place = ushort(index % (n + 1)),
+    };
+}
+
+
 std::ostream&
 operator<<(std::ostream& os, Action action) {
     return os << '<' << action.pick << action.color.letter() << action.place << '>';
@@ -1,7 +1,11 @@
 #ifndef ACTION_HPP
 #define ACTION_HPP
 
+#include <array>
+#include <vector>
+
 #include "global.hpp"
+#include "rules/rules.hpp"
 #include "state/tiles.hpp"
 
 struct Action {
@@ -19,4 +23,62 @@ struct Action {
     std::string repr() const;
 };
 
+// Upper bound of the number of legal actions, for the largest supported rules
+const ushort MAX_ACTION_COUNT = (1 + MAX_FACTORY_COUNT) * TILE_TYPES * (1 + TILE_TYPES);
+
+// Dense index of the actions of some rules, for policy outputs:
+// (pick * tile_types + color) * (tile_types + 1) + place, below action_index_count
+ushort action_index_count(const Rules& rules);
+ushort action_index(Action action, const Rules& rules);
+// Throws if the index is not below action_index_count
+Action index_action(ushort index, const Rules& rules);
+
+// List of actions, used to list legal actions without heap allocation. Rules with
+// more players than MAX_PLAYER_COUNT can have more actions than its capacity:
+// they are then all moved to "overflow", on the heap
+class ActionList {
+private:
+    std::array<Action, MAX_ACTION_COUNT> actions;
+    std::vector<Action> overflow;
+    ushort count = 0;
+
+    const Action* data() const { return count > MAX_ACTION_COUNT ? overflow.data() : actions.data(); }
+
+public:
+    void clear() {
+        count = 0;
+        overflow.clear();
+    }
+    void push_back(Action action) {
+        if (count < MAX_ACTION_COUNT) {
+            actions[count++] = action;
+            return;
+        }
+        if (count == MAX_ACTION_COUNT) {
+            overflow.assign(actions.begin(), actions.end());
+        }
+        overflow.push_back(action);
+        count++;
+    }
+
+    ushort size() const { return count; }
+    bool empty() const { return count == 0; }
+    Action operator[](ushort index) const { return data()[index]; }
+
+    const Action* begin() const { return data(); }
+    const Action* end() const { return data() + count; }
+};
+
+// Indexes are computed for every legal action, so these are inlined
+
+inline ushort
+action_index_count(const Rules& rules) {
+    return (rules.factory_count() + 1) * rules.tile_types * (rules.tile_types + 1);
+}
+
+inline ushort
+action_index(Action action, const Rules& rules) {
+    return (action.pick * rules.tile_types + ushort(action.color)) * (rules.tile_types + 1) + action.place;
+}
+
 #endif //ACTION_HPP
@@ -0,0 +1,469 @@
+#include "batch_game.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+#include "utils/bits.hpp"
+
+BatchGame::BatchGame(std::shared_ptr<const Rules> _rules, std::vector<Policy> policies, int size, int seed)
+  : rules(_rules)
+  , masks(WallMasks::of(_rules->tile_types))
+  , n(_rules->tile_types)
+  , factory_count(_rules->factory_count())
+  , player_count(_rules->player_count)
+  , policies(policies)
+  , penalties()
+  , size(size)
+  , randomness(seed) {
+    if (policies.size() != player_count) {
+        throw std::invalid_argument("BatchGame needs one policy per player");
+    }
+    if (size <= 0) {
+        throw std::invalid_argument("BatchGame needs a positive number of games");
+    }
+    if (rules->factory_tiles * factory_count > std::numeric_limits<uint8_t>::max()) {
+        throw std::invalid_argument("Rules have too many tiles per round for BatchGame");
+    }
+    for (ushort f = 0; f <= rules->overflow_count; f++) {
+        penalties.push_back(rules->penalty_for_floor(f));
+    }
+    player.resize(size);
+    center_token.resize(size);
+    remaining.resize(size);
+    order.resize(player_count * size);
+    score.resize(player_count * size);
+    floor.resize(player_count * size);
+    first_token.resize(player_count * size);
+    wall.resize(player_count * size);
+    line_colors.resize(player_count * n * size);
+    line_amounts.resize(player_count * n * size);
+    accepted_lines.resize(player_count * n * size);
+    sources.resize((1 + factory_count) * n * size);
+    source_colors.resize((1 + factory_count) * size);
+    bag.resize(n * size);
+    bin.resize(n * size);
+    actions.resize(size);
+}
+
+// Private
+
+inline std::size_t
+BatchGame::at(std::size_t row, int game) const {
+    return row * size + game;
+}
+
+inline std::size_t
+BatchGame::seat_row(ushort seat, ushort line_or_color) const {
+    return seat * n + line_or_color;
+}
+
+// Resets all games at once, row by row, and seats players of each game randomly
+void
+BatchGame::reset(int game_count) {
+    std::fill(player.begin(), player.end(), 0);
+    std::fill(center_token.begin(), center_token.end(), 0);
+    std::fill(remaining.begin(), remaining.end(), 0);
+    std::fill(score.begin(), score.end(), 0);
+    std::fill(floor.begin(), floor.end(), 0);
+    std::fill(first_token.begin(), first_token.end(), 0);
+    std::fill(wall.begin(), wall.end(), 0);
+    std::fill(line_colors.begin(), line_colors.end(), TILE_TYPES);
+    std::fill(line_amounts.begin(), line_amounts.end(), 0);
+    std::fill(accepted_lines.begin(), accepted_lines.end(), (1 << n) - 1);
+    std::fill(sources.begin(), sources.end(), 0);
+    std::fill(source_colors.begin(), source_colors.end(), 0);
+    std::fill(bag.begin(), bag.end(), rules->tile_count);
+    std::fill(bin.begin(), bin.end(), 0);
+    std::array<uint8_t, 256> seats;
+    std::iota(seats.begin(), seats.begin() + player_count, 0);
+    for (int game = 0; game < game_count; game++) {
+        std::shuffle(seats.begin(), seats.begin() + player_count, randomness);
+        for (ushort seat = 0; seat < player_count; seat++) {
+            order[at(seat, game)] = seats[seat];
+        }
+    }
+}
+
+// Same draws as Game::setup_factories
+void
+BatchGame::setup_factories(int game) {
+    std::array<uint16_t, TILE_TYPES> bag_counts{};
+    std::array<uint16_t, TILE_TYPES> bin_counts{};
+    uint32_t bag_total = 0;
+    uint32_t bin_total = 0;
+    for (ushort color = 0; color < n; color++) {
+        bag_counts[color] = bag[at(color, game)];
+        bin_counts[color] = bin[at(color, game)];
+        bag_total += bag_counts[color];
+        bin_total += bin_counts[color];
+    }
+    for (ushort pick = 1; pick <= factory_count; pick++) {
+        std::array<uint8_t, TILE_TYPES> drawn{};
+        for (ushort k = 0; k < rules->factory_tiles; k++) {
+            if (bag_total == 0) {
+                if (bin_total == 0) {
+                    break;
+                }
+                std::swap(bag_counts, bin_counts);
+                std::swap(bag_total, bin_total);
+            }
+            uint32_t v = random_below(randomness, bag_total);
+            ushort color = 0;
+            while (v >= bag_counts[color]) {
+                v -= bag_counts[color];
+                color++;
+            }
+            bag_counts[color]--;
+            bag_total--;
+            drawn[color]++;
+        }
+        uint8_t colors = 0;
+        for (ushort color = 0; color < n; color++) {
+            sources[at(pick * n + color, game)] = drawn[color];
+            remaining[game] += drawn[color];
+            colors |= (drawn[color] > 0) << color;
+        }
+        source_colors[at(pick, game)] = colors;
+        if (bag_total == 0 && bin_total == 0) {
+            break;
+        }
+    }
+    for (ushort color = 0; color < n; color++) {
+        bag[at(color, game)] = bag_counts[color];
+        bin[at(color, game)] = bin_counts[color];
+    }
+    center_token[game] = 1;
+}
+
+void
+BatchGame::update_accepted_line(int game, ushort seat, ushort line) {
+    uint32_t placed = wall[at(seat, game)];
+    ushort amount = line_amounts[at(seat_row(seat, line - 1), game)];
+    ushort line_color = line_colors[at(seat_row(seat, line - 1), game)];
+    uint8_t bit = 1 << (line - 1);
+    for (ushort color = 0; color < n; color++) {
+        bool on_wall = placed & masks.colors[color] & masks.lines[line - 1];
+        bool accepted = !on_wall && (amount == 0 || (line_color == color && amount < line));
+        uint8_t& lines = accepted_lines[at(seat_row(seat, color), game)];
+        lines = accepted ? (lines | bit) : (lines & ~bit);
+    }
+}
+
+Action
+BatchGame::choose(int game) {
+    ushort seat = player[game];
+    switch (policies[order[at(seat, game)]]) {
+        case SMART_RANDOM:
+            return choose_random(game, true);
+        case RANDOM:
+            return choose_random(game, false);
+        default:
+            return choose_first_legal(game);
+    }
+}
+
+// Uniform choice among the legal actions, or the ones placing on lines if "smart" and there are some
+Action
+BatchGame::choose_random(int game, bool smart) {
+    ushort seat = player[game];
+    std::array<uint8_t, TILE_TYPES> lines{};
+    for (ushort color = 0; color < n; color++) {
+        lines[color] = accepted_lines[at(seat_row(seat, color), game)];
+    }
+    uint32_t line_actions = 0;
+    uint32_t floor_actions = 0;
+    for (ushort pick = 0; pick <= factory_count; pick++) {
+        uint32_t colors = source_colors[at(pick, game)];
+        floor_actions += popcount(colors);
+        for (; colors != 0; colors &= colors - 1) {
+            line_actions += popcount(uint32_t(lines[lowest_bit(colors)]));
+        }
+    }
+    // Actions are numbered by source, then color, then place
+    bool with_floor = !smart || line_actions == 0;
+    bool with_lines = !smart || line_actions > 0;
+    uint32_t total = (with_floor ? floor_actions : 0) + (with_lines ? line_actions : 0);
+    uint32_t k = random_below(randomness, total);
+    for (ushort pick = 0; pick <= factory_count; pick++) {
+        for (uint32_t colors = source_colors[at(pick, game)]; colors != 0; colors &= colors - 1) {
+            ushort color = lowest_bit(colors);
+            if (with_floor) {
+                if (k == 0) {
+                    return Action{ .pick = pick, .color = Tile(color), .place = 0 };
+                }
+                k--;
+            }
+            if (with_lines) {
+                uint32_t accepted = lines[color];
+                uint32_t count = popcount(accepted);
+                if (k < count) {
+                    for (; k > 0; k--) {
+                        accepted &= accepted - 1;
+                    }
+                    return Action{ .pick = pick, .color = Tile(color), .place = ushort(lowest_bit(accepted) + 1) };
+                }
+                k -= count;
+            }
+        }
+    }
+    return Action();
+}
+
+// Same order as FirstLegalPlayer::first_legal: highest place, then lowest source and color
+Action
+BatchGame::choose_first_legal(int game) const {
+    ushort seat = player[game];
+    for (ushort place = n; place > 0; place--) {
+        uint8_t bit = 1 << (place - 1);
+        for (ushort pick = 0; pick <= factory_count; pick++) {
+            for (uint32_t colors = source_colors[at(pick, game)]; colors != 0; colors &= colors - 1) {
+                ushort color = lowest_bit(colors);
+                if (accepted_lines[at(seat_row(seat, color), game)] & bit) {
+                    return Action{ .pick = pick, .color = Tile(color), .place = place };
+                }
+            }
+        }
+    }
+    for (ushort pick = 0; pick <= factory_count; pick++) {
+        uint32_t colors = source_colors[at(pick, game)];
+        if (colors != 0) {
+            return Action{ .pick = pick, .color = Tile(lowest_bit(colors)), .place = 0 };
+        }
+    }
+    return Action();
+}
+
+// Same steps as Game::apply_unchecked
+void
+BatchGame::apply(int game, Action action) {
+    ushort seat = player[game];
+    ushort color = ushort(action.color);
+    uint8_t& picked = sources[at(action.pick * n + color, game)];
+    int count = picked;
+    picked = 0;
+    remaining[game] -= count;
+
+    int overflow_count = count;
+    if (action.place > 0) {
+        std::size_t line = at(seat_row(seat, action.place - 1), game);
+        int amount = line_amounts[line];
+        overflow_count = std::max(0, count - (action.place - amount));
+        line_amounts[line] = amount + count - overflow_count;
+        line_colors[line] = color;
+        update_accepted_line(game, seat, action.place);
+    }
+    bin[at(color, game)] += overflow_count;
+
+    if (action.pick == 0) {
+        source_colors[at(0, game)] &= ~(1 << color);
+        if (center_token[game]) {
+            center_token[game] = 0;
+            overflow_count++;
+            first_token[at(seat, game)] = 1;
+        }
+    } else {
+        // Move the rest of the factory to the center
+        uint8_t& colors = source_colors[at(action.pick, game)];
+        colors &= ~(1 << color);
+        for (uint32_t rest = colors; rest != 0; rest &= rest - 1) {
+            ushort c = lowest_bit(rest);
+            uint8_t& tiles = sources[at(action.pick * n + c, game)];
+            sources[at(c, game)] += tiles;
+            tiles = 0;
+        }
+        source_colors[at(0, game)] |= colors;
+        colors = 0;
+    }
+    uint8_t& seat_floor = floor[at(seat, game)];
+    seat_floor = std::min<int>(seat_floor + overflow_count, rules->overflow_count);
+
+    player[game] = seat + 1 == player_count ? 0 : seat + 1;
+    move_counts[order[at(seat, game)]]++;
+}
+
+// Same steps as Game::score_panels and Game::apply_first_token
+void
+BatchGame::end_round(int game) {
+    for (ushort seat = 0; seat < player_count; seat++) {
+        uint32_t& placed = wall[at(seat, game)];
+        int delta = 0;
+        for (ushort line = 1; line <= n; line++) {
+            std::size_t row = at(seat_row(seat, line - 1), game);
+            if (line_amounts[row] != line) {
+                continue;
+            }
+            ushort color = line_colors[row];
+            uint32_t bit = masks.colors[color] & masks.lines[line - 1];
+            if (placed & bit) {
+                bin[at(color, game)] += line;
+            } else {
+                placed |= bit;
+                ushort width = popcount(placed & masks.lines[line - 1]);
+                ushort height = popcount(placed & masks.columns[lowest_bit(bit) % n]);
+                delta += (width != 1 && height != 1) ? width + height : width + height - 1;
+                bin[at(color, game)] += line - 1;
+            }
+            line_amounts[row] = 0;
+            line_colors[row] = TILE_TYPES;
+        }
+        uint8_t& seat_floor = floor[at(seat, game)];
+        delta -= penalties[seat_floor];
+        seat_floor = 0;
+        uint16_t& seat_score = score[at(seat, game)];
+        seat_score = seat_score > -delta ? seat_score + delta : 0;
+        for (ushort line = 1; line <= n; line++) {
+            update_accepted_line(game, seat, line);
+        }
+        if (first_token[at(seat, game)]) {
+            first_token[at(seat, game)] = 0;
+            player[game] = seat;
+        }
+    }
+}
+
+bool
+BatchGame::is_game_finished(int game) const {
+    for (ushort seat = 0; seat < player_count; seat++) {
+        uint32_t placed = wall[at(seat, game)];
+        for (ushort line = 0; line < n; line++) {
+            if ((placed & masks.lines[line]) == masks.lines[line]) {
+                return true;
+            }
+        }
+    }
+    for (ushort color = 0; color < n; color++) {
+        if (bag[at(color, game)] + bin[at(color, game)] == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+BatchGame::score_final(int game) {
+    for (ushort seat = 0; seat < player_count; seat++) {
+        uint32_t placed = wall[at(seat, game)];
+        int bonus = 0;
+        for (ushort i = 0; i < n; i++) {
+            bonus += rules->line_bonus * ((placed & masks.lines[i]) == masks.lines[i]) +
+                     rules->column_bonus * ((placed & masks.columns[i]) == masks.columns[i]) +
+                     rules->type_bonus * ((placed & masks.colors[i]) == masks.colors[i]);
+        }
+        uint16_t& seat_score = score[at(seat, game)];
+        seat_score = seat_score > -bonus ? seat_score + bonus : 0;
+    }
+}
+
+
+// Public
+
+void
+BatchGame::roll_games(int count) {
+    if (count < 0 || count > size) {
+        throw std::invalid_argument("BatchGame can play at most " + std::to_string(size) + " games");
+    }
+    reset(count);
+    move_counts.assign(player_count, 0);
+    move_times.assign(player_count, 0);
+    active.resize(count);
+    std::iota(active.begin(), active.end(), 0);
+    for (int game : active) {
+        setup_factories(game);
+    }
+    while (!active.empty()) {
+        // Each running game chooses one move, then plays it. As in Game, where only
+        // Player::play is timed, only choices are timed, and the time of the pass
+        // is shared between players by their number of moves in it
+        pass_moves.assign(player_count, 0);
+        int moves = 0;
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (int game : active) {
+            if (remaining[game] > 0) {
+                actions[game] = choose(game);
+                pass_moves[order[at(player[game], game)]]++;
+                moves++;
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double elapsed = std::chrono::duration<double, std::micro>(end - begin).count();
+        for (ushort p = 0; p < player_count && moves > 0; p++) {
+            move_times[p] += elapsed * pass_moves[p] / moves;
+        }
+        for (int game : active) {
+            if (remaining[game] > 0) {
+                apply(game, actions[game]);
+            }
+        }
+        // Then games at the end of their round score it, and either start the next one or stop
+        std::size_t running = 0;
+        for (int game : active) {
+            if (remaining[game] == 0) {
+                end_round(game);
+                if (is_game_finished(game)) {
+                    score_final(game);
+                    continue;
+                }
+                setup_factories(game);
+            }
+            active[running++] = game;
+        }
+        active.resize(running);
+    }
+}
+
+int
+BatchGame::get_size() const {
+    return size;
+}
+
+long long
+BatchGame::get_move_count(ushort _player) const {
+    return move_counts.at(_player);
+}
+
+long long
+BatchGame::get_move_time(ushort _player) const {
+    return std::llround(move_times.at(_player));
+}
+
+ushort
+BatchGame::get_score(int game, ushort _player) const {
+    for (ushort seat = 0; seat < player_count; seat++) {
+        if (order[at(seat, game)] == _player) {
+            return score[at(seat, game)];
+        }
+    }
+    throw std::invalid_argument("No player " + std::to_string(_player) + " in game");
+}
+
+// Same choice as State::winning_player, on seats
+ushort
+BatchGame::get_winner(int game) const {
+    ushort highest_score = 0;
+    for (ushort seat = 0; seat < player_count; seat++) {
+        highest_score = std::max(highest_score, score[at(seat, game)]);
+    }
+    ushort winner = 0;
+    ushort highest_count = 0;
+    for (ushort seat = 0; seat < player_count; seat++) {
+        if (score[at(seat, game)] != highest_score) {
+            continue;
+        }
+        uint32_t placed = wall[at(seat, game)];
+        ushort count = 0;
+        for (ushort line = 0; line < n; line++) {
+            count += (placed & masks.lines[line]) == masks.lines[line];
+        }
+        if (count >= highest_count) {
+            highest_count = count;
+            winner = seat;
+        }
+    }
+    return order[at(winner, game)];
+}
@@ -0,0 +1,103 @@
+#ifndef BATCH_GAME_HPP
+#define BATCH_GAME_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "action.hpp"
+#include "global.hpp"
+#include "rules/rules.hpp"
+#include "state/wall.hpp"
+#include "utils/random.hpp"
+
+// Plays many independent games in lock-step, where every player follows a
+// simple policy, without State, Player or Observer objects.
+// States are stored as a structure of arrays: each field is a row of values,
+// one per game, and fields with several values per game (such as the count of
+// each color in each source) are consecutive rows. Each phase of the games
+// (moves, end of rounds, results) is a loop over games on contiguous rows.
+// Games follow the same rules as Game, with players seated in a random order
+class BatchGame {
+public:
+    enum Policy {
+        // Same choices as RandomPlayer, smart or not
+        SMART_RANDOM,
+        RANDOM,
+        // Same choices as FirstLegalPlayer
+        FIRST_LEGAL,
+    };
+
+private:
+    const std::shared_ptr<const Rules> rules;
+    const WallMasks& masks;
+    const ushort n;
+    const ushort factory_count;
+    const ushort player_count;
+    std::vector<Policy> policies;
+    std::vector<ushort> penalties;
+    int size;
+    rng randomness;
+
+    // Per game
+    std::vector<uint8_t> player;
+    std::vector<uint8_t> center_token;
+    std::vector<uint16_t> remaining;
+    // Per seat: the player seated there, and its panel
+    std::vector<uint8_t> order;
+    std::vector<uint16_t> score;
+    std::vector<uint8_t> floor;
+    std::vector<uint8_t> first_token;
+    std::vector<uint32_t> wall;
+    // Per seat and line
+    std::vector<uint8_t> line_colors;
+    std::vector<uint8_t> line_amounts;
+    // Per seat and color, bit "line - 1" is set if the line accepts the color
+    std::vector<uint8_t> accepted_lines;
+    // Per source and color, then per source the mask of its colors
+    std::vector<uint8_t> sources;
+    std::vector<uint8_t> source_colors;
+    // Per color
+    std::vector<uint16_t> bag;
+    std::vector<uint16_t> bin;
+
+    std::vector<int> active;
+    // Per game, the move chosen in the current pass
+    std::vector<Action> actions;
+    // Per player, and per player in the current pass
+    std::vector<long long> move_counts;
+    std::vector<int> pass_moves;
+    std::vector<double> move_times;
+
+    std::size_t at(std::size_t row, int game) const;
+    std::size_t seat_row(ushort seat, ushort line_or_color) const;
+
+    void reset(int game_count);
+    void setup_factories(int game);
+    void update_accepted_line(int game, ushort seat, ushort line);
+    Action choose(int game);
+    Action choose_random(int game, bool smart);
+    Action choose_first_legal(int game) const;
+    void apply(int game, Action action);
+    void end_round(int game);
+    bool is_game_finished(int game) const;
+    void score_final(int game);
+
+public:
+    // "policies" are the policies of each player, which are "player_count" in rules
+    BatchGame(std::shared_ptr<const Rules> rules, std::vector<Policy> policies, int size, int seed);
+
+    // Plays "count" games (at most "size") from the start to their end
+    void roll_games(int count);
+
+    int get_size() const;
+    // Moves played by "player" in the last games
+    long long get_move_count(ushort player) const;
+    // Microseconds spent choosing the moves of "player" in the last games
+    long long get_move_time(ushort player) const;
+    // Results of the last games, for each player (not seat)
+    ushort get_score(int game, ushort player) const;
+    ushort get_winner(int game) const;
+};
+
+#endif //BATCH_GAME_HPP
@@ -1,5 +1,8 @@
 #include "game.hpp"
 
+#include "state/zobrist.hpp"
+#include "utils/bits.hpp"
+
 // Constuctors
 
 Game::Game()
@@ -13,23 +16,25 @@ Game::Game(std::shared_ptr<const Rules> rules, int seed)
   , players()
   , observers()
   , order()
-  , randomness(seed)
-  , range() {
+  , fixed_order()
+  , seed(seed)
+  , randomness(seed) {
     reset();
 }
 
-Game::Game(std::shared_ptr<const Rules> rules, std::vector<std::shared_ptr<Player>> players)
+Game::Game(std::shared_ptr<const Rules> rules, std::vector<std::shared_ptr<Player>> _players)
   : state(rules)
   , players()
   , observers()
   , order()
-  , randomness(random_seed())
-  , range() {
-    if (players.size() > rules->player_count) {
+  , fixed_order()
+  , seed(random_seed())
+  , randomness(seed) {
+    if (_players.size() > rules->player_count) {
         throw std::invalid_argument("Too many players for rules");
     }
-    for (std::shared_ptr<Player> player : players) {
-        players.push_back(std::move(player));
+    for (const std::shared_ptr<Player>& player : _players) {
+        players.push_back(player);
         std::shared_ptr<Observer> observer = player->observer();
         if (observer != nullptr) {
             observers.push_back(std::move(observer));
@@ -41,88 +46,230 @@ Game::Game(std::shared_ptr<const Rules> rules, std::vector<std::shared_ptr<Playe
 
 // Private methods
 
-// Should only be called if there is at least
-// one tile in bag
-Tile
-Game::pull_one_random_tile() {
-    int v = random_range(randomness, range, 0, state.bag.total());
-    int i;
-    for (i = 0; i < state.rules->tile_types - 1; i++) {
-        v -= state.bag[i];
-        if (v < 0) {
-            break;
+inline std::array<ushort, TILE_TYPES>
+source_quantities(const State& state, ushort pick) {
+    return (pick == 0 ? state.get_center().tiles : state.get_factory(pick).tiles).get_quantities();
+}
+
+inline const std::array<ushort, TILE_TYPES>&
+source_quantities(const CompactState& state, ushort pick) {
+    return state.sources[pick];
+}
+
+inline bool
+legal_line(const State& state, ushort place, ushort color) {
+    return state.get_panel(state.get_current_player()).legal_line(place, Tile(color));
+}
+
+inline bool
+legal_line(const CompactState& state, ushort place, ushort color) {
+    return state.legal_line(state.get_current_player(), place, color);
+}
+
+// Calls "visit" on each legal action placing on a line between
+// "begin_place" and "end_place", until it returns false.
+// Returns false if the enumeration was stopped.
+template<class S, class Visitor>
+bool
+scan_legal_between(const S& state, ushort begin_place, ushort end_place, Visitor& visit) {
+    const Rules& rules = *state.get_rules();
+    for (ushort pick = 0; pick <= rules.factory_count(); pick++) {
+        const std::array<ushort, TILE_TYPES>& quantities = source_quantities(state, pick);
+        for (ushort color = 0; color < rules.tile_types; color++) {
+            if (quantities[color] == 0) {
+                continue;
+            }
+            for (ushort place = begin_place; place <= end_place; place++) {
+                if (place > 0 && !legal_line(state, place, color)) {
+                    continue;
+                }
+                if (!visit(Action{ .pick = pick, .color = Tile(color), .place = place })) {
+                    return false;
+                }
+            }
         }
     }
-    Tile tile = Tile(i);
-    state.bag -= tile;
-    return tile;
+    return true;
 }
 
-Tiles
-Game::pull_random_tiles(int count) {
-    if (count == 0) {
-        return Tiles::ZERO;
-    }
-    Tiles result;
-    // If bag almost empty
-    int available = state.bag.total();
-    if (available <= count) {
-        // Pull out the rest
-        if (available > 0) {
-            result = state.bag;
-            count -= available;
-        }
-        // If done already
-        if (count == 0) {
-            state.bag = Tiles::ZERO;
-            // Return
-            return result;
-        }
-        // Else empty bin into bag and try again
-        state.bag = state.bin;
-        state.bin = Tiles::ZERO;
-        available = state.bag.total();
-        // If bag still almost empty
-        if (available <= count) {
-            // Pull out the rest
-            if (available > 0) {
-                result = state.bag;
-                state.bag = Tiles::ZERO;
+// Same as above, reading the masks tracked by the state if it has them
+template<class Visitor>
+bool
+visit_legal_between(const State& state, ushort begin_place, ushort end_place, Visitor& visit) {
+    if (!state.has_legal_masks()) {
+        return scan_legal_between(state, begin_place, end_place, visit);
+    }
+    const LegalMasks& masks = state.get_legal_masks();
+    const std::array<uint8_t, TILE_TYPES>& accepted_lines = masks.accepted_lines[state.get_current_player()];
+    // Bit "line - 1" is set for lines between begin_place and end_place
+    uint8_t place_range = begin_place > end_place ? 0 : ((1 << end_place) - 1) & ~((1 << std::max(begin_place - 1, 0)) - 1);
+    for (ushort pick = 0; pick < masks.source_colors.size(); pick++) {
+        uint32_t colors = masks.source_colors[pick];
+        while (colors != 0) {
+            ushort color = lowest_bit(colors);
+            colors &= colors - 1;
+            if (begin_place == 0 && !visit(Action{ .pick = pick, .color = Tile(color), .place = 0 })) {
+                return false;
+            }
+            uint32_t lines = accepted_lines[color] & place_range;
+            while (lines != 0) {
+                ushort place = lowest_bit(lines) + 1;
+                lines &= lines - 1;
+                if (!visit(Action{ .pick = pick, .color = Tile(color), .place = place })) {
+                    return false;
+                }
             }
-            // And return
-            return result;
         }
     }
-    // Pull out tile one by one
-    for (int i = 0; i < count; i++) {
-        result += pull_one_random_tile();
+    return true;
+}
+
+template<class Visitor>
+bool
+visit_legal_between(const CompactState& state, ushort begin_place, ushort end_place, Visitor& visit) {
+    return scan_legal_between(state, begin_place, end_place, visit);
+}
+
+template<class Container>
+struct ActionAppender {
+    Container& actions;
+    bool operator()(Action action) {
+        actions.push_back(action);
+        return true;
+    }
+};
+
+struct ActionCounter {
+    ushort count = 0;
+    bool operator()(Action /*action*/) {
+        count++;
+        return true;
+    }
+};
+
+struct ActionSelector {
+    ushort index;
+    ushort seen = 0;
+    Action action{};
+    bool operator()(Action visited) {
+        if (seen++ == index) {
+            action = visited;
+            return false;
+        }
+        return true;
+    }
+};
+
+// Marks the action_index of each legal action, in a uint8_t array or a bitset
+template<class Mask>
+struct ActionMasker {
+    const Rules& rules;
+    Mask& mask;
+    bool operator()(Action action) {
+        mask[action_index(action, rules)] = 1;
+        return true;
+    }
+};
+
+template<class S, class Container>
+void
+list_legal_between(const S& state, ushort begin_place, ushort end_place, Container& actions) {
+    ActionAppender<Container> appender{ actions };
+    visit_legal_between(state, begin_place, end_place, appender);
+}
+
+template<class S>
+void
+list_smart_legal(const S& state, ActionList& actions) {
+    actions.clear();
+    list_legal_between(state, 1, state.get_rules()->tile_types, actions);
+    if (actions.empty()) {
+        list_legal_between(state, 0, 0, actions);
+    }
+}
+
+template<class S, class Mask>
+void
+mark_legal(const S& state, Mask& mask) {
+    ActionMasker<Mask> masker{ *state.get_rules(), mask };
+    visit_legal_between(state, 0, state.get_rules()->tile_types, masker);
+}
+
+// Bits past MAX_ACTION_COUNT would be out of the bitset
+template<class S>
+void
+mark_legal_bits(const S& state, std::bitset<MAX_ACTION_COUNT>& mask) {
+    ushort count = action_index_count(*state.get_rules());
+    if (count > MAX_ACTION_COUNT) {
+        throw std::invalid_argument("Rules have " + std::to_string(count) + " action indices, more than the " + std::to_string(MAX_ACTION_COUNT) + " of bitset masks");
+    }
+    mask.reset();
+    mark_legal(state, mask);
+}
+
+template<class S>
+ushort
+count_legal_between(const S& state, ushort begin_place, ushort end_place) {
+    ActionCounter counter;
+    visit_legal_between(state, begin_place, end_place, counter);
+    return counter.count;
+}
+
+template<class S>
+ushort
+count_smart_legal(const S& state) {
+    ushort count = count_legal_between(state, 1, state.get_rules()->tile_types);
+    return count > 0 ? count : count_legal_between(state, 0, 0);
+}
+
+// Sets "action" to the legal action at position "index", returns false
+// if there are only "seen" legal actions
+template<class S>
+bool
+nth_legal_between(const S& state, ushort begin_place, ushort end_place, ushort index, Action& action, ushort& seen) {
+    ActionSelector selector{ index };
+    bool found = !visit_legal_between(state, begin_place, end_place, selector);
+    action = selector.action;
+    seen = selector.seen;
+    return found;
+}
+
+template<class S>
+Action
+nth_legal(const S& state, ushort index) {
+    Action action;
+    ushort seen;
+    if (!nth_legal_between(state, 0, state.get_rules()->tile_types, index, action, seen)) {
+        throw std::out_of_range("No legal action at index " + std::to_string(index));
+    }
+    return action;
+}
+
+template<class S>
+Action
+nth_smart_legal(const S& state, ushort index) {
+    Action action;
+    ushort seen;
+    if (nth_legal_between(state, 1, state.get_rules()->tile_types, index, action, seen)) {
+        return action;
+    }
+    if (seen > 0 || !nth_legal_between(state, 0, 0, index, action, seen)) {
+        throw std::out_of_range("No smart legal action at index " + std::to_string(index));
     }
-    return result;
+    return action;
 }
 
 std::vector<Action>
 Game::all_legal_between(const State& state, ushort begin_place, ushort end_place) {
     std::vector<Action> legal_actions{};
-    std::shared_ptr<const Rules> rules = state.get_rules();
-    const Panel& panel = state.get_panel(state.player);
-    for (ushort pick = 0; pick <= rules->factory_count(); pick++) {
-        Tiles tiles = (pick == 0) ? state.center.tiles : state.get_factory(pick).tiles;
-        if (tiles.is_empty()) {
-            continue;
-        }
-        for (ushort color = 0; color < rules->tile_types; color++) {
-            Tile tile = Tile(color);
-            if (!tiles.has_color(tile)) {
-                continue;
-            }
-            for (ushort place = begin_place; place <= end_place; place++) {
-                if (place > 0 && !panel.legal_line(place, tile)) {
-                    continue;
-                }
-                legal_actions.push_back(Action{ .pick = pick, .color = tile, .place = place });
-            }
-        }
-    }
+    list_legal_between(state, begin_place, end_place, legal_actions);
+    return legal_actions;
+}
+
+std::vector<Action>
+Game::all_legal_between(const CompactState& state, ushort begin_place, ushort end_place) {
+    std::vector<Action> legal_actions{};
+    list_legal_between(state, begin_place, end_place, legal_actions);
     return legal_actions;
 }
 
@@ -134,11 +281,46 @@ Game::get_state() const {
     return state;
 }
 
+void
+Game::enable_legal_masks(bool enabled) {
+    state.enable_legal_masks(enabled);
+}
+
+void
+Game::reseed(int _seed) {
+    seed = _seed;
+    randomness.seed(seed);
+    // The next order is shuffled from the seating order, not from the last one
+    order.clear();
+}
+
+int
+Game::get_seed() const {
+    return seed;
+}
+
+void
+Game::set_order(std::vector<ushort> _order) {
+    std::vector<ushort> sorted = _order;
+    std::sort(sorted.begin(), sorted.end());
+    for (size_t i = 0; i < sorted.size(); i++) {
+        if (sorted.size() != state.rules->player_count || sorted[i] != i) {
+            throw std::invalid_argument("Order should be a permutation of the players");
+        }
+    }
+    fixed_order = std::move(_order);
+}
+
 void
 Game::override_state(const State& _state) {
     state = _state;
 }
 
+void
+Game::override_state(const CompactState& _state) {
+    _state.restore(state);
+}
+
 
 ushort
 Game::players_missing() const {
@@ -205,12 +387,16 @@ Game::remove_observer(std::shared_ptr<Observer> observer) {
 void
 Game::reset() {
     state.reset();
-    if (order.empty()) {
-        for (ushort i = 0; i < state.rules->player_count; i++) {
-            order.push_back(i);
+    if (!fixed_order.empty()) {
+        order = fixed_order;
+    } else {
+        if (order.empty()) {
+            for (ushort i = 0; i < state.rules->player_count; i++) {
+                order.push_back(i);
+            }
         }
+        std::shuffle(order.begin(), order.end(), randomness);
     }
-    std::shuffle(order.begin(), order.end(), randomness);
     state.set_current_player(0);
 }
 
@@ -245,7 +431,12 @@ Game::roll_round() {
         const std::shared_ptr<Player>& player = players[order[state.player]];
         Action action = player->play(state);
         try {
-            apply(action);
+            // Only illegal actions go through the checked apply, to report the error
+            if (legal(action)) {
+                apply_unchecked(action, state);
+            } else {
+                apply(action);
+            }
             for (const std::shared_ptr<Observer>& observer : observers) {
                 observer->action_played(action);
             }
@@ -280,6 +471,7 @@ Game::roll_game() {
     }
     reset();
     for (const std::shared_ptr<Observer>& observer : observers) {
+        observer->game_seeded(seed);
         observer->start_game(order);
     }
     roll_end_game();
@@ -292,15 +484,71 @@ Game::roll_game() {
 
 void
 Game::setup_factories() {
-    // Fill factories
+    setup_factories(state, randomness);
+}
+
+// Fills all factories in one pass over local tile counts. A bag holding no more
+// tiles than a factory needs is emptied into it without drawing, then the bin is
+// emptied into the bag, which is emptied as well if it is still too small. Other
+// tiles are drawn one at a time, uniformly from the bag. If both are empty,
+// filling stops
+void
+Game::setup_factories(State& state, rng& randomness) {
+    const ushort n = state.rules->tile_types;
+    std::array<ushort, TILE_TYPES> bag = state.bag.get_quantities();
+    std::array<ushort, TILE_TYPES> bin = state.bin.get_quantities();
+    uint32_t bag_total = 0;
+    uint32_t bin_total = 0;
+    for (ushort color = 0; color < n; color++) {
+        bag_total += bag[color];
+        bin_total += bin[color];
+    }
     for (auto& factory : state.factories) {
-        factory.tiles = pull_random_tiles(state.rules->factory_tiles);
-        if (state.bag.is_empty() && state.bin.is_empty()) {
+        std::array<ushort, TILE_TYPES> drawn{};
+        uint32_t count = state.rules->factory_tiles;
+        auto take_bag = [&]() {
+            for (ushort color = 0; color < n; color++) {
+                drawn[color] += bag[color];
+                bag[color] = 0;
+            }
+            count -= bag_total;
+            bag_total = 0;
+        };
+        if (bag_total <= count) {
+            take_bag();
+            if (count > 0) {
+                std::swap(bag, bin);
+                std::swap(bag_total, bin_total);
+                if (bag_total <= count) {
+                    take_bag();
+                }
+            }
+        }
+        for (; count > 0 && bag_total > 0; count--) {
+            uint32_t v = random_below(randomness, bag_total);
+            ushort color = 0;
+            while (v >= bag[color]) {
+                v -= bag[color];
+                color++;
+            }
+            bag[color]--;
+            bag_total--;
+            drawn[color]++;
+        }
+        factory.tiles.set_quantities(drawn);
+        if (bag_total == 0 && bin_total == 0) {
             break;
         }
     }
+    state.bag.set_quantities(bag);
+    state.bin.set_quantities(bin);
     state.center.tiles = Tiles::ZERO;
     state.center.first_token = true;
+    if (state.legal_masks.enabled) {
+        for (ushort pick = 0; pick <= state.rules->factory_count(); pick++) {
+            state.update_source_mask(pick);
+        }
+    }
 }
 
 void
@@ -334,6 +582,9 @@ Game::score_panels(State& state) {
         panel.clear_floor();
         panel.add_score(score);
     }
+    if (state.legal_masks.enabled) {
+        state.update_legal_masks();
+    }
 }
 
 void
@@ -374,20 +625,12 @@ Game::legal(Action action, const State& state) {
         return false;
     }
     // If action is not "throwing away", check color can be placed on line
-    if (action.place > 0 && !state.get_panel(state.player).legal_line(action.place, action.color)) {
+    if (action.place > 0 && (action.place > rules->tile_types || !state.get_panel_unchecked(state.player).legal_line_unchecked(action.place, action.color))) {
         return false;
     }
-    Tiles picked;
-    if (action.pick == 0) {
-        picked = state.get_center().tiles;
-    } else {
-        picked = state.get_factory(action.pick).tiles;
-    }
     // Check action color is present in picked Center / Factory
-    if (!picked.has_color(action.color)) {
-        return false;
-    }
-    return true;
+    const Tiles& picked = (action.pick == 0) ? state.get_center().tiles : state.get_factory_unchecked(action.pick).tiles;
+    return picked.get_unchecked(action.color) > 0;
 }
 
 
@@ -398,8 +641,8 @@ Game::apply(Action action, State& state) {
         throw std::invalid_argument("No tile of color " + action.color.str() + " in game");
     }
 
-    Panel& panel = state.get_panel_mut(state.get_current_player());
-    Tiles& picked = (action.pick == 0) ? state.get_center_mut().tiles : state.get_factory_mut(action.pick).tiles;
+    const Panel& panel = state.get_panel(state.get_current_player());
+    const Tiles& picked = (action.pick == 0) ? state.get_center().tiles : state.get_factory(action.pick).tiles;
 
     // Check action color is present in picked Center / Factory
     if (picked.is_empty()) {
@@ -414,13 +657,18 @@ Game::apply(Action action, State& state) {
     }
 
     // Action is confirmed to be legal
-    // Everything that follows should not raise exceptions
-    Center& center = state.get_center_mut();
+    apply_unchecked(action, state);
+}
 
-    // Remove all tiles of corresponding color from picked
-    int count = picked[action.color];
-    picked[action.color] = 0;
+void
+Game::apply_unchecked(Action action, State& state) {
+    Panel& panel = state.get_panel_mut_unchecked(state.player);
+    Center& center = state.center;
+    Tiles& picked = (action.pick == 0) ? center.tiles : state.get_factory_mut_unchecked(action.pick).tiles;
 
+    // Remove all tiles of corresponding color from picked
+    int count = picked.get_unchecked(action.color);
+    picked.set_unchecked(action.color, 0);
 
     int overflow_count;
     if (action.place == 0) {
@@ -429,17 +677,13 @@ Game::apply(Action action, State& state) {
     } else {
         // Else pyramid, some will be placed in a line
         Pyramid& pyramid = panel.get_pyramid_mut();
-        overflow_count = std::max(0, count - pyramid.amount_remaining(action.place));
-        // Determine new amount of tiles on pyramid line
-        count -= overflow_count;
-        count += pyramid.amount(action.place);
-        // And set it
-        pyramid.set_line(action.place, count, action.color);
-    }
-    if (overflow_count > 0) {
-        // Throw excess tiles in bin
-        state.get_bin_mut() += Tiles(action.color, overflow_count);
+        int amount = pyramid.amount_unchecked(action.place);
+        overflow_count = std::max(0, count - (action.place - amount));
+        // Set new amount of tiles on pyramid line
+        pyramid.set_line_unchecked(action.place, amount + count - overflow_count, action.color);
     }
+    // Throw excess tiles in bin
+    state.bin.set_unchecked(action.color, state.bin.get_unchecked(action.color) + overflow_count);
 
     if (action.pick == 0) {
         // If center, check if first token is taken
@@ -450,12 +694,19 @@ Game::apply(Action action, State& state) {
         }
     } else {
         // If factory, move all tiles to center
-        Factory& factory = state.get_factory_mut(action.pick);
-        center.tiles += factory.tiles;
-        factory.tiles = Tiles::ZERO;
+        center.tiles += picked;
+        picked = Tiles::ZERO;
     }
     // Add thrown tiles as floor penalty
     panel.add_floor(overflow_count);
+
+    if (state.legal_masks.enabled) {
+        state.update_source_mask(0);
+        state.update_source_mask(action.pick);
+        if (action.place > 0) {
+            state.update_line_mask(state.player, action.place);
+        }
+    }
 }
 
 void
@@ -488,4 +739,227 @@ Game::all_smart_legal(const State& state) {
         actions = Game::all_penalty_legal(state);
     }
     return actions;
-}
\ No newline at end of file
+}
+
+// Compact state
+
+bool
+Game::legal(Action action, const CompactState& state) {
+    const Rules& rules = *state.rules;
+    // Check action is coherent with current rules
+    if (ushort(action.color) >= rules.tile_types || action.pick > rules.factory_count()) {
+        return false;
+    }
+    // If action is not "throwing away", check color can be placed on line
+    if (action.place > 0 && (action.place > rules.tile_types || !state.legal_line(state.player, action.place, ushort(action.color)))) {
+        return false;
+    }
+    // Check action color is present in picked Center / Factory
+    return state.sources[action.pick][ushort(action.color)] > 0;
+}
+
+void
+Game::apply(Action action, CompactState& state) {
+    const Rules& rules = *state.rules;
+    // Check action is coherent with current rules
+    if (ushort(action.color) >= rules.tile_types) {
+        throw std::invalid_argument("No tile of color " + action.color.str() + " in game");
+    }
+    if (action.pick > rules.factory_count()) {
+        throw std::invalid_argument("No factory with id '" + std::to_string(action.pick) + "'");
+    }
+    if (action.place > rules.tile_types) {
+        throw std::invalid_argument("No line '" + std::to_string(action.place) + "'");
+    }
+    ushort color = ushort(action.color);
+
+    // Check action color is present in picked Center / Factory
+    if (state.sources[action.pick][color] == 0) {
+        throw std::invalid_argument("Source " + std::to_string(action.pick) + " has no tiles of color " + action.color.str());
+    }
+    // If action is not "throwing away", check color can be placed on line
+    if (action.place > 0 && !state.legal_line(state.player, action.place, color)) {
+        throw std::invalid_argument("Cannot place tile " + action.color.str() + " on line " + std::to_string(action.place));
+    }
+
+    // Action is confirmed to be legal
+    apply_unchecked(action, state);
+}
+
+void
+Game::apply_unchecked(Action action, CompactState& state) {
+    ushort color = ushort(action.color);
+    CompactPanel& panel = state.panels[state.player];
+    std::array<ushort, TILE_TYPES>& picked = state.sources[action.pick];
+
+    // Keys of the features the action may change, xored out of the hash
+    // before the action, and back in with their new values after it
+    auto changed_keys = [&]() {
+        uint64_t keys = Zobrist::key(Zobrist::source(action.pick), Zobrist::tiles(picked)) ^
+                        Zobrist::key(Zobrist::BIN, Zobrist::tiles(state.bin)) ^
+                        Zobrist::key(Zobrist::CENTER_TOKEN, state.first_token) ^
+                        Zobrist::key(Zobrist::panel(state.player, Zobrist::FLOOR), panel.floor) ^
+                        Zobrist::key(Zobrist::panel(state.player, Zobrist::TOKEN), panel.first_token);
+        if (action.pick != 0) {
+            keys ^= Zobrist::key(Zobrist::source(0), Zobrist::tiles(state.sources[0]));
+        }
+        if (action.place > 0) {
+            ushort line = action.place - 1;
+            keys ^= Zobrist::key(Zobrist::panel(state.player, Zobrist::LINE + line),
+                Zobrist::line(panel.pyramid_colors[line], panel.pyramid_amounts[line]));
+        }
+        return keys;
+    };
+    state.hash ^= changed_keys();
+
+    // Remove all tiles of corresponding color from picked
+    int count = picked[color];
+    picked[color] = 0;
+
+    int overflow_count;
+    if (action.place == 0) {
+        // If directly thrown away
+        overflow_count = count;
+    } else {
+        // Else pyramid, some will be placed in a line
+        int line = action.place - 1;
+        int amount = panel.pyramid_amounts[line];
+        overflow_count = std::max(0, count - (action.place - amount));
+        // Set new amount of tiles on pyramid line
+        panel.pyramid_amounts[line] = amount + count - overflow_count;
+        panel.pyramid_colors[line] = color;
+    }
+    // Throw excess tiles in bin
+    state.bin[color] += overflow_count;
+
+    if (action.pick == 0) {
+        // If center, check if first token is taken
+        if (state.first_token) {
+            state.first_token = false;
+            overflow_count++;
+            panel.first_token = true;
+        }
+    } else {
+        // If factory, move all tiles to center
+        std::array<ushort, TILE_TYPES>& center = state.sources[0];
+        for (ushort c = 0; c < TILE_TYPES; c++) {
+            center[c] += picked[c];
+            picked[c] = 0;
+        }
+    }
+    // Add thrown tiles as floor penalty
+    panel.floor = std::min<int>(panel.floor + overflow_count, state.rules->overflow_count);
+
+    state.hash ^= changed_keys();
+}
+
+std::vector<Action>
+Game::all_legal(const CompactState& state) {
+    return all_legal_between(state, 0, state.rules->tile_types);
+}
+
+std::vector<Action>
+Game::all_non_penalty_legal(const CompactState& state) {
+    return all_legal_between(state, 1, state.rules->tile_types);
+}
+
+std::vector<Action>
+Game::all_penalty_legal(const CompactState& state) {
+    return all_legal_between(state, 0, 0);
+}
+
+std::vector<Action>
+Game::all_smart_legal(const CompactState& state) {
+    std::vector<Action> actions = Game::all_non_penalty_legal(state);
+    if (actions.size() == 0) {
+        actions = Game::all_penalty_legal(state);
+    }
+    return actions;
+}
+
+
+// Allocation-free
+
+void
+Game::all_legal(const State& state, ActionList& actions) {
+    actions.clear();
+    list_legal_between(state, 0, state.rules->tile_types, actions);
+}
+
+void
+Game::all_smart_legal(const State& state, ActionList& actions) {
+    list_smart_legal(state, actions);
+}
+
+ushort
+Game::count_legal(const State& state) {
+    return count_legal_between(state, 0, state.rules->tile_types);
+}
+
+ushort
+Game::count_smart_legal(const State& state) {
+    return ::count_smart_legal(state);
+}
+
+Action
+Game::nth_legal(const State& state, ushort index) {
+    return ::nth_legal(state, index);
+}
+
+Action
+Game::nth_smart_legal(const State& state, ushort index) {
+    return ::nth_smart_legal(state, index);
+}
+
+void
+Game::all_legal(const CompactState& state, ActionList& actions) {
+    actions.clear();
+    list_legal_between(state, 0, state.rules->tile_types, actions);
+}
+
+void
+Game::all_smart_legal(const CompactState& state, ActionList& actions) {
+    list_smart_legal(state, actions);
+}
+
+ushort
+Game::count_legal(const CompactState& state) {
+    return count_legal_between(state, 0, state.rules->tile_types);
+}
+
+ushort
+Game::count_smart_legal(const CompactState& state) {
+    return ::count_smart_legal(state);
+}
+
+Action
+Game::nth_legal(const CompactState& state, ushort index) {
+    return ::nth_legal(state, index);
+}
+
+Action
+Game::nth_smart_legal(const CompactState& state, ushort index) {
+    return ::nth_smart_legal(state, index);
+}
+
+void
+Game::legal_mask(const State& state, uint8_t* mask) {
+    std::fill(mask, mask + action_index_count(*state.rules), 0);
+    mark_legal(state, mask);
+}
+
+void
+Game::legal_mask(const CompactState& state, uint8_t* mask) {
+    std::fill(mask, mask + action_index_count(*state.rules), 0);
+    mark_legal(state, mask);
+}
+
+void
+Game::legal_mask(const State& state, std::bitset<MAX_ACTION_COUNT>& mask) {
+    mark_legal_bits(state, mask);
+}
+
+void
+Game::legal_mask(const CompactState& state, std::bitset<MAX_ACTION_COUNT>& mask) {
+    mark_legal_bits(state, mask);
+}
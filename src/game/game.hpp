@@ -2,6 +2,8 @@
 #define GAME_HPP
 
 #include <algorithm>
+#include <bitset>
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <vector>
@@ -10,6 +12,7 @@
 #include "observer.hpp"
 #include "player.hpp"
 #include "rules/rules.hpp"
+#include "state/compact_state.hpp"
 #include "state/state.hpp"
 #include "utils/random.hpp"
 
@@ -18,18 +21,18 @@ class Game {
 private:
     friend class Arena;
     friend class ArenaRoom;
+    friend class VecEnv;
 
     State state;
     std::vector<std::shared_ptr<Player>> players;
     std::vector<std::shared_ptr<Observer>> observers;
     std::vector<ushort> order;
+    std::vector<ushort> fixed_order;
+    int seed;
     rng randomness;
-    ushort_range range;
-
-    Tile pull_one_random_tile();
-    Tiles pull_random_tiles(int count);
 
     std::vector<Action> static all_legal_between(const State& state, ushort begin_place, ushort end_place);
+    std::vector<Action> static all_legal_between(const CompactState& state, ushort begin_place, ushort end_place);
 
 public:
     Game();
@@ -38,7 +41,16 @@ public:
     Game(std::shared_ptr<const Rules> rules, std::vector<std::shared_ptr<Player>> players);
 
     const State& get_state() const;
+    void enable_legal_masks(bool enabled = true);
+    // Resets the generator of the tile draws and player orders
+    void reseed(int seed);
+    // Seed the generator was last given
+    int get_seed() const;
+    // Seating order of the next games, "order[seat]" being the index of a player.
+    // If empty, it is shuffled at each reset, which draws from the generator
+    void set_order(std::vector<ushort> order);
     void override_state(const State& state);
+    void override_state(const CompactState& state);
 
     ushort players_missing() const;
     bool has_enough_players() const;
@@ -60,6 +72,7 @@ public:
     void roll_game();
 
     void setup_factories();
+    void static setup_factories(State& state, rng& randomness);
     void score_panels();
     void static score_panels(State& state);
     void apply_first_token();
@@ -70,11 +83,44 @@ public:
 
     bool static legal(Action action, const State& state);
     void static apply(Action action, State& state);
+    // Trusted version of apply, for actions known to be legal
+    void static apply_unchecked(Action action, State& state);
     void static score_final(State& state);
     std::vector<Action> static all_legal(const State& state);
     std::vector<Action> static all_non_penalty_legal(const State& state);
     std::vector<Action> static all_penalty_legal(const State& state);
     std::vector<Action> static all_smart_legal(const State& state);
+
+    // Same as above, on the trivially copyable state used by search
+    bool static legal(Action action, const CompactState& state);
+    void static apply(Action action, CompactState& state);
+    void static apply_unchecked(Action action, CompactState& state);
+    std::vector<Action> static all_legal(const CompactState& state);
+    std::vector<Action> static all_non_penalty_legal(const CompactState& state);
+    std::vector<Action> static all_penalty_legal(const CompactState& state);
+    std::vector<Action> static all_smart_legal(const CompactState& state);
+
+    // Allocation-free versions, writing into a caller-provided list
+    void static all_legal(const State& state, ActionList& actions);
+    void static all_smart_legal(const State& state, ActionList& actions);
+    void static all_legal(const CompactState& state, ActionList& actions);
+    void static all_smart_legal(const CompactState& state, ActionList& actions);
+    // Number of actions that all_legal / all_smart_legal would list
+    ushort static count_legal(const State& state);
+    ushort static count_smart_legal(const State& state);
+    ushort static count_legal(const CompactState& state);
+    ushort static count_smart_legal(const CompactState& state);
+    // Action at position "index" of all_legal / all_smart_legal, without listing the others
+    Action static nth_legal(const State& state, ushort index);
+    Action static nth_smart_legal(const State& state, ushort index);
+    Action static nth_legal(const CompactState& state, ushort index);
+    Action static nth_smart_legal(const CompactState& state, ushort index);
+    // Sets the "action_index_count" values of "mask" to 1 at the action_index of legal actions, and 0 elsewhere
+    void static legal_mask(const State& state, uint8_t* mask);
+    void static legal_mask(const CompactState& state, uint8_t* mask);
+    // Throws std::invalid_argument if the rules have more than MAX_ACTION_COUNT action indices
+    void static legal_mask(const State& state, std::bitset<MAX_ACTION_COUNT>& mask);
+    void static legal_mask(const CompactState& state, std::bitset<MAX_ACTION_COUNT>& mask);
 };
 
 #endif //GAME_HPP
@@ -0,0 +1,483 @@
+#include "game_record.hpp"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "game.hpp"
+
+namespace {
+
+const char MAGIC[8] = { 'C', 'R', 'M', 'G', 'A', 'M', 'E', 'S' };
+const uint32_t VERSION = 1;
+const std::size_t RULE_FIELDS = 9;
+const std::size_t HEADER_SIZE = sizeof(MAGIC) + sizeof(uint32_t) + RULE_FIELDS * sizeof(uint16_t);
+
+// Bits needed to store values up to "max"
+int
+width(uint32_t max) {
+    int bits = 0;
+    while (bits < 32 && (uint64_t(1) << bits) <= max) {
+        bits++;
+    }
+    return bits;
+}
+
+// Widths of the fields of a record, which only depend on the rules
+struct Widths {
+    int seat;
+    int round_count;
+    int score;
+    int action_count;
+    int factory_tiles;
+    int pick;
+    int color;
+    int place;
+
+    Widths(const Rules& rules)
+      : seat(width(rules.player_count - 1))
+      , round_count(8)
+      , score(16)
+      , action_count(width(rules.factory_count() * rules.factory_tiles))
+      , factory_tiles(width(rules.factory_tiles))
+      , pick(width(rules.factory_count()))
+      , color(width(rules.tile_types - 1))
+      , place(width(rules.tile_types)) {}
+};
+
+class BitWriter {
+private:
+    std::vector<uint8_t>& bytes;
+    uint64_t bits = 0;
+    int count = 0;
+
+public:
+    BitWriter(std::vector<uint8_t>& bytes)
+      : bytes(bytes) {}
+
+    void
+    write(uint32_t value, int width) {
+        if (width < 32 && value >= (uint32_t(1) << width)) {
+            throw std::invalid_argument("Value " + std::to_string(value) + " does not fit in a game record");
+        }
+        bits |= uint64_t(value) << count;
+        count += width;
+        while (count >= 8) {
+            bytes.push_back(uint8_t(bits));
+            bits >>= 8;
+            count -= 8;
+        }
+    }
+
+    void
+    finish() {
+        if (count > 0) {
+            bytes.push_back(uint8_t(bits));
+        }
+        bits = 0;
+        count = 0;
+    }
+};
+
+class BitReader {
+private:
+    const uint8_t* begin;
+    const uint8_t* end;
+    uint64_t bits = 0;
+    int count = 0;
+
+public:
+    BitReader(const uint8_t* begin, const uint8_t* end)
+      : begin(begin)
+      , end(end) {}
+
+    uint32_t
+    read(int width) {
+        while (count < width) {
+            if (begin == end) {
+                throw std::runtime_error("Game record is truncated");
+            }
+            bits |= uint64_t(*begin++) << count;
+            count += 8;
+        }
+        uint32_t value = uint32_t(bits & ((uint64_t(1) << width) - 1));
+        bits >>= width;
+        count -= width;
+        return value;
+    }
+};
+
+template<class T>
+void
+append_value(std::vector<uint8_t>& bytes, T value) {
+    const uint8_t* raw = reinterpret_cast<const uint8_t*>(&value);
+    bytes.insert(bytes.end(), raw, raw + sizeof(value));
+}
+
+template<class T>
+T
+read_value(const uint8_t* data) {
+    T value;
+    std::copy(data, data + sizeof(value), reinterpret_cast<uint8_t*>(&value));
+    return value;
+}
+
+// Records hold a seat per player of MAX_PLAYER_COUNT, and a color per tile type
+bool
+recordable(const Rules& rules) {
+    return rules.player_count >= 2 && rules.player_count <= MAX_PLAYER_COUNT && rules.tile_types >= 1 && rules.tile_types <= TILE_TYPES;
+}
+
+std::vector<uint8_t>
+encode_header(const Rules& rules) {
+    std::vector<uint8_t> bytes(MAGIC, MAGIC + sizeof(MAGIC));
+    append_value<uint32_t>(bytes, VERSION);
+    for (ushort field : { rules.player_count, rules.tile_count, rules.tile_types, rules.factory_tiles, rules.line_bonus, rules.column_bonus, rules.type_bonus, rules.overflow_count, rules.overflow_penalty }) {
+        append_value<uint16_t>(bytes, field);
+    }
+    return bytes;
+}
+
+std::shared_ptr<const Rules>
+decode_header(const uint8_t* data, std::size_t length) {
+    if (length < HEADER_SIZE || !std::equal(MAGIC, MAGIC + sizeof(MAGIC), data)) {
+        throw std::runtime_error("Not a game record file");
+    }
+    if (read_value<uint32_t>(data + sizeof(MAGIC)) != VERSION) {
+        throw std::runtime_error("Unsupported game record version");
+    }
+    std::shared_ptr<Rules> rules = std::make_shared<Rules>();
+    const uint8_t* field = data + sizeof(MAGIC) + sizeof(uint32_t);
+    for (ushort* value : { &rules->player_count, &rules->tile_count, &rules->tile_types, &rules->factory_tiles, &rules->line_bonus, &rules->column_bonus, &rules->type_bonus, &rules->overflow_count, &rules->overflow_penalty }) {
+        *value = read_value<uint16_t>(field);
+        field += sizeof(uint16_t);
+    }
+    if (!recordable(*rules)) {
+        throw std::runtime_error("Game record file has invalid rules");
+    }
+    return rules;
+}
+
+void
+encode(const Rules& rules, const GameRecord& record, std::vector<uint8_t>& bytes) {
+    Widths widths(rules);
+    std::size_t size_offset = bytes.size();
+    append_value<uint32_t>(bytes, 0);
+    append_value<int32_t>(bytes, record.seed);
+    BitWriter writer(bytes);
+    writer.write(record.rounds.size(), widths.round_count);
+    for (ushort player : record.order) {
+        writer.write(player, widths.seat);
+    }
+    for (ushort score : record.scores) {
+        writer.write(score, widths.score);
+    }
+    for (const RoundRecord& round : record.rounds) {
+        writer.write(round.actions.size(), widths.action_count);
+        for (const Tiles& factory : round.factories) {
+            std::array<ushort, TILE_TYPES> quantities = factory.get_quantities();
+            for (ushort color = 0; color < rules.tile_types; color++) {
+                writer.write(quantities[color], widths.factory_tiles);
+            }
+        }
+        for (Action action : round.actions) {
+            writer.write(action.pick, widths.pick);
+            writer.write(ushort(action.color), widths.color);
+            writer.write(action.place, widths.place);
+        }
+    }
+    writer.finish();
+    uint32_t size = bytes.size() - size_offset - sizeof(uint32_t);
+    std::copy(reinterpret_cast<const uint8_t*>(&size), reinterpret_cast<const uint8_t*>(&size) + sizeof(size), bytes.begin() + size_offset);
+}
+
+GameRecord
+decode(const Rules& rules, const uint8_t* data, std::size_t size) {
+    Widths widths(rules);
+    if (size < sizeof(int32_t)) {
+        throw std::runtime_error("Game record is truncated");
+    }
+    GameRecord record;
+    record.seed = read_value<int32_t>(data);
+    BitReader reader(data + sizeof(int32_t), data + size);
+    std::size_t round_count = reader.read(widths.round_count);
+    for (ushort seat = 0; seat < rules.player_count; seat++) {
+        record.order.push_back(reader.read(widths.seat));
+    }
+    for (ushort seat = 0; seat < rules.player_count; seat++) {
+        record.scores.push_back(reader.read(widths.score));
+    }
+    for (std::size_t i = 0; i < round_count; i++) {
+        RoundRecord round;
+        std::size_t action_count = reader.read(widths.action_count);
+        for (ushort factory = 0; factory < rules.factory_count(); factory++) {
+            std::array<ushort, TILE_TYPES> quantities{};
+            for (ushort color = 0; color < rules.tile_types; color++) {
+                quantities[color] = reader.read(widths.factory_tiles);
+            }
+            Tiles tiles;
+            tiles.set_quantities(quantities);
+            round.factories.push_back(tiles);
+        }
+        for (std::size_t k = 0; k < action_count; k++) {
+            ushort pick = reader.read(widths.pick);
+            ushort color = reader.read(widths.color);
+            ushort place = reader.read(widths.place);
+            if (color >= rules.tile_types) {
+                throw std::runtime_error("Game record has an invalid action");
+            }
+            round.actions.push_back(Action{ .pick = pick, .color = Tile(color), .place = place });
+        }
+        record.rounds.push_back(std::move(round));
+    }
+    return record;
+}
+
+// Fills the factories as Game::setup_factories did: tiles come from the bag,
+// and from the bin poured into the bag only once the bag is empty
+void
+fill_factories(State& state, const RoundRecord& round) {
+    const Rules& rules = *state.get_rules();
+    std::array<ushort, TILE_TYPES> bag = state.get_bag().get_quantities();
+    std::array<ushort, TILE_TYPES> bin = state.get_bin().get_quantities();
+    std::array<int, TILE_TYPES> drawn{};
+    int bag_total = 0;
+    int drawn_total = 0;
+    for (ushort factory = 0; factory < rules.factory_count(); factory++) {
+        std::array<ushort, TILE_TYPES> quantities = round.factories[factory].get_quantities();
+        for (ushort color = 0; color < rules.tile_types; color++) {
+            drawn[color] += quantities[color];
+            drawn_total += quantities[color];
+        }
+        state.get_factory_mut(factory + 1).tiles = round.factories[factory];
+    }
+    for (ushort color = 0; color < rules.tile_types; color++) {
+        bag_total += bag[color];
+    }
+    bool poured = drawn_total > bag_total;
+    for (ushort color = 0; color < rules.tile_types; color++) {
+        int left = bag[color] + (poured ? bin[color] : 0) - drawn[color];
+        if (left < 0) {
+            throw std::runtime_error("Game record draws tiles missing from the bag");
+        }
+        bag[color] = left;
+        bin[color] = poured ? 0 : bin[color];
+    }
+    state.get_bag_mut().set_quantities(bag);
+    state.get_bin_mut().set_quantities(bin);
+    state.get_center_mut().tiles = Tiles::ZERO;
+    state.get_center_mut().first_token = true;
+    if (state.has_legal_masks()) {
+        state.update_legal_masks();
+    }
+}
+
+} // namespace
+
+
+// GameRecordWriter
+
+GameRecordWriter::GameRecordWriter(const std::string& path, std::shared_ptr<const Rules> rules, bool append, std::size_t buffer_size)
+  : rules(rules)
+  , file()
+  , mutex()
+  , buffer()
+  , buffer_size(buffer_size) {
+    if (!recordable(*rules)) {
+        throw std::invalid_argument("Game records do not support " + std::to_string(rules->player_count) + " players and " + std::to_string(rules->tile_types) + " tile types");
+    }
+    std::vector<uint8_t> header = encode_header(*rules);
+    if (append) {
+        std::ifstream existing(path, std::ios::binary);
+        std::vector<uint8_t> found(HEADER_SIZE);
+        if (existing.read(reinterpret_cast<char*>(found.data()), found.size())) {
+            if (found != header) {
+                throw std::runtime_error(path + " holds records of other rules");
+            }
+            file.open(path, std::ios::binary | std::ios::app);
+            header.clear();
+        }
+    }
+    if (header.size() > 0) {
+        file.open(path, std::ios::binary | std::ios::trunc);
+    }
+    if (!file) {
+        throw std::runtime_error("Could not write game records to " + path);
+    }
+    buffer = header;
+}
+
+GameRecordWriter::~GameRecordWriter() {
+    flush_buffer();
+}
+
+void
+GameRecordWriter::flush_buffer() {
+    file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    file.flush();
+    buffer.clear();
+}
+
+void
+GameRecordWriter::write(const GameRecord& record) {
+    std::vector<uint8_t> bytes;
+    encode(*rules, record, bytes);
+    const std::lock_guard<std::mutex> lock(mutex);
+    buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+    if (buffer.size() >= buffer_size) {
+        flush_buffer();
+    }
+}
+
+void
+GameRecordWriter::flush() {
+    const std::lock_guard<std::mutex> lock(mutex);
+    flush_buffer();
+}
+
+
+// GameRecorder
+
+GameRecorder::GameRecorder(std::shared_ptr<GameRecordWriter> writer)
+  : writer(std::move(writer))
+  , record() {}
+
+void
+GameRecorder::game_seeded(int seed) {
+    record.seed = seed;
+}
+
+void
+GameRecorder::start_game(std::vector<ushort> order) {
+    record.order = std::move(order);
+    record.scores.clear();
+    record.rounds.clear();
+}
+
+void
+GameRecorder::new_round(const State& state) {
+    RoundRecord round;
+    for (ushort factory = 1; factory <= state.get_rules()->factory_count(); factory++) {
+        round.factories.push_back(state.get_factory(factory).tiles);
+    }
+    record.rounds.push_back(std::move(round));
+}
+
+void
+GameRecorder::action_played(Action action) {
+    record.rounds.back().actions.push_back(action);
+}
+
+void
+GameRecorder::end_game(const State& state, ushort /*winner_position*/) {
+    for (ushort seat = 0; seat < state.get_rules()->player_count; seat++) {
+        record.scores.push_back(state.get_panel(seat).get_score());
+    }
+    writer->write(record);
+}
+
+
+// GameRecords
+
+GameRecords::GameRecords(const std::string& path)
+  : rules()
+  , data(nullptr)
+  , length(0)
+  , offsets() {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not read game records from " + path);
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size == 0) {
+        close(fd);
+        throw std::runtime_error("Could not read game records from " + path);
+    }
+    length = status.st_size;
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Could not map game records from " + path);
+    }
+    data = static_cast<const uint8_t*>(mapped);
+    try {
+        rules = decode_header(data, length);
+    } catch (...) {
+        munmap(const_cast<uint8_t*>(data), length);
+        throw;
+    }
+    // A record cut by an interrupted writer is left out
+    std::size_t offset = HEADER_SIZE;
+    while (offset + sizeof(uint32_t) <= length) {
+        uint32_t size = read_value<uint32_t>(data + offset);
+        if (offset + sizeof(uint32_t) + size > length) {
+            break;
+        }
+        offsets.push_back(offset);
+        offset += sizeof(uint32_t) + size;
+    }
+}
+
+GameRecords::~GameRecords() {
+    munmap(const_cast<uint8_t*>(data), length);
+}
+
+const std::shared_ptr<const Rules>&
+GameRecords::get_rules() const {
+    return rules;
+}
+
+std::size_t
+GameRecords::size() const {
+    return offsets.size();
+}
+
+GameRecord
+GameRecords::get(std::size_t index) const {
+    if (index >= offsets.size()) {
+        throw std::out_of_range("No game record at index " + std::to_string(index));
+    }
+    const uint8_t* record = data + offsets[index];
+    return decode(*rules, record + sizeof(uint32_t), read_value<uint32_t>(record));
+}
+
+State
+GameRecords::replay(std::size_t index, Observer& observer) const {
+    GameRecord record = get(index);
+    State state(rules);
+    state.reset();
+    state.set_current_player(0);
+    observer.game_seeded(record.seed);
+    observer.start_game(record.order);
+    for (const RoundRecord& round : record.rounds) {
+        fill_factories(state, round);
+        observer.new_round(state);
+        for (Action action : round.actions) {
+            Game::apply(action, state);
+            observer.action_played(action);
+            state.next_player();
+        }
+        if (!state.is_round_finished()) {
+            throw std::runtime_error("Game record has an unfinished round");
+        }
+        Game::score_panels(state);
+        Game::apply_first_token(state);
+    }
+    Game::score_final(state);
+    for (ushort seat = 0; seat < rules->player_count; seat++) {
+        if (state.get_panel(seat).get_score() != record.scores[seat]) {
+            throw std::runtime_error("Game record does not replay to its scores");
+        }
+    }
+    observer.end_game(state, state.winning_player());
+    return state;
+}
+
+State
+GameRecords::replay(std::size_t index) const {
+    Observer observer;
+    return replay(index, observer);
+}
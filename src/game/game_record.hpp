@@ -0,0 +1,101 @@
+#ifndef GAME_RECORD_HPP
+#define GAME_RECORD_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "action.hpp"
+#include "observer.hpp"
+#include "rules/rules.hpp"
+#include "state/state.hpp"
+#include "state/tiles.hpp"
+
+// Binary records of played games. A file starts with a header holding the rules,
+// then each record is its size in bytes followed by its content:
+//   seed (32 bits), then bit-packed with widths fitting the rules:
+//     round count, order (one player index per seat), final score of each seat,
+//     and for each round: action count, tile counts of each factory at the start
+//     of the round, and the actions as pick, color and place
+// Integers are stored in the byte order of the machine
+
+struct RoundRecord {
+    std::vector<Tiles> factories;
+    std::vector<Action> actions;
+};
+
+struct GameRecord {
+    int seed = 0;
+    std::vector<ushort> order;
+    // Final score of each seat
+    std::vector<ushort> scores;
+    std::vector<RoundRecord> rounds;
+};
+
+// Appends records to a file, keeping them in memory until "buffer_size" bytes are
+// waiting. Records can be written from several threads
+class GameRecordWriter {
+private:
+    std::shared_ptr<const Rules> rules;
+    std::ofstream file;
+    std::mutex mutex;
+    std::vector<uint8_t> buffer;
+    std::size_t buffer_size;
+
+    void flush_buffer();
+
+public:
+    // If "append" and the file has records of the same rules, new records are added after them
+    GameRecordWriter(const std::string& path, std::shared_ptr<const Rules> rules, bool append = false, std::size_t buffer_size = 1 << 20);
+    GameRecordWriter(const GameRecordWriter& writer) = delete;
+    ~GameRecordWriter();
+
+    void write(const GameRecord& record);
+    void flush();
+};
+
+// Builds the record of the game it observes, and gives it to its writer at
+// the end of the game. A recorder observes one game at a time
+class GameRecorder : public Observer {
+private:
+    std::shared_ptr<GameRecordWriter> writer;
+    GameRecord record;
+
+public:
+    GameRecorder(std::shared_ptr<GameRecordWriter> writer);
+
+    void game_seeded(int seed) override;
+    void start_game(std::vector<ushort> order) override;
+    void new_round(const State& state) override;
+    void action_played(Action action) override;
+    void end_game(const State& state, ushort winner_position) override;
+};
+
+// Records of a file, mapped in memory and indexed when opened, so that
+// any of them can be read without reading the ones before
+class GameRecords {
+private:
+    std::shared_ptr<const Rules> rules;
+    const uint8_t* data;
+    std::size_t length;
+    std::vector<std::size_t> offsets;
+
+public:
+    GameRecords(const std::string& path);
+    GameRecords(const GameRecords& records) = delete;
+    ~GameRecords();
+
+    const std::shared_ptr<const Rules>& get_rules() const;
+    std::size_t size() const;
+    GameRecord get(std::size_t index) const;
+    // Plays the recorded game again with Game::apply, notifying the observer as
+    // a Game would, and returns its final state. Throws if the record is not
+    // a legal game or does not end with its scores
+    State replay(std::size_t index, Observer& observer) const;
+    State replay(std::size_t index) const;
+};
+
+#endif //GAME_RECORD_HPP
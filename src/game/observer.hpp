@@ -9,6 +9,8 @@ class Game;
 
 class Observer {
 public:
+    // Seed of the generator of the game, given just before start_game
+    void virtual game_seeded(int /*seed*/) {}
     void virtual start_game(std::vector<ushort> /*order*/) {}
     void virtual new_round(const State& /*state*/) {}
     void virtual action_played(Action /*action*/) {}
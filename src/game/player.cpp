@@ -19,6 +19,9 @@ Player::error(std::string message) {
     std::cout << "[PLAYER:" << player_type() << ":ERROR]" << message << std::endl;
 }
 
+void
+Player::reseed(int /*seed*/) {}
+
 
 // Reading
 
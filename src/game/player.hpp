@@ -22,6 +22,9 @@ public:
     virtual Action play(const State& state) = 0;
     virtual void error(std::string message);
 
+    // Resets the random generators of the player, if any
+    virtual void reseed(int seed);
+
     // Reading
     virtual std::string player_type() const;
     friend std::ostream& operator<<(std::ostream& os, const Player& player);
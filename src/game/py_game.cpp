@@ -1,10 +1,14 @@
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
 #include "action.hpp"
 #include "game.hpp"
+#include "game_record.hpp"
 #include "player.hpp"
+#include "py_buffer.hpp"
 #include "py_utils.hpp"
+#include "vec_env.hpp"
 
 namespace py = pybind11;
 using namespace py::literals;
@@ -21,6 +25,31 @@ py_create_action(
     };
 }
 
+// Read-only array viewing a row buffer of the VecEnv "env", which it keeps alive
+template<class T>
+py::array_t<T>
+py_env_view(py::object env, const std::vector<T>& values, ushort width) {
+    py::ssize_t size = env.cast<const VecEnv&>().size();
+    std::vector<py::ssize_t> shape = { size };
+    if (width > 0) {
+        shape.push_back(width);
+    }
+    py::array_t<T> view(shape, values.data(), env);
+    view.attr("flags").attr("writeable") = false;
+    return view;
+}
+
+py::array_t<float>
+py_env_observations(py::object env) {
+    const VecEnv& self = env.cast<const VecEnv&>();
+    ushort n = self.get_rules()->tile_types;
+    py::array_t<float> view({ py::ssize_t(self.size()), py::ssize_t(self.get_encoder().plane_count()), py::ssize_t(n), py::ssize_t(n) },
+        self.get_observations().data(),
+        env);
+    view.attr("flags").attr("writeable") = false;
+    return view;
+}
+
 class PyPlayer : public Player {
 public:
     using Player::Player;
@@ -58,6 +87,13 @@ public:
             error,
             message);
     }
+    void reseed(int seed) override {
+        PYBIND11_OVERLOAD(
+            void,
+            Player,
+            reseed,
+            seed);
+    }
     std::string player_type() const override {
         PYBIND11_OVERLOAD(
             std::string,
@@ -70,6 +106,13 @@ class PyObserver : public Observer {
 public:
     using Observer::Observer;
 
+    void game_seeded(int seed) override {
+        PYBIND11_OVERLOAD(
+            void,
+            Observer,
+            game_seeded,
+            seed);
+    }
     void start_game(std::vector<ushort> order) override {
         PYBIND11_OVERLOAD(
             void,
@@ -133,7 +176,13 @@ py_bind_game(py::module& root) {
             "players"_a)
 
         .def_property_readonly("state", &Game::get_state)
-        .def("override_state", &Game::override_state)
+        .def("enable_legal_masks",
+            &Game::enable_legal_masks,
+            "enabled"_a = true)
+        .def("reseed", &Game::reseed, "seed"_a)
+        .def("get_seed", &Game::get_seed)
+        .def("set_order", &Game::set_order, "order"_a)
+        .def("override_state", [](Game& game, const State& state) { game.override_state(state); }, "state"_a)
 
         .def("players_missing", &Game::players_missing)
         .def("has_enough_players", &Game::has_enough_players)
@@ -162,7 +211,7 @@ py_bind_game(py::module& root) {
         .def("roll_game", &Game::roll_game)
         .def("next_player", &Game::next_player)
 
-        .def("setup_factories", &Game::setup_factories)
+        .def("setup_factories", [](Game& game) { game.setup_factories(); })
         .def("score_panels", [](Game& game) { game.score_panels(); })
         .def("apply_first_token", [](Game& game) { game.apply_first_token(); })
 
@@ -191,6 +240,9 @@ py_bind_game(py::module& root) {
         .def("error",
             &Player::error,
             "message"_a)
+        .def("reseed",
+            &Player::reseed,
+            "seed"_a)
 
         .def("player_type", &Player::player_type)
         .def("__str__", &Player::str)
@@ -199,6 +251,9 @@ py_bind_game(py::module& root) {
     py::class_<Observer, std::shared_ptr<Observer>, PyObserver>(m, "Observer")
         .def(py::init<>())
 
+        .def("game_seeded",
+            &Observer::game_seeded,
+            "seed"_a)
         .def("start_game",
             &Observer::start_game,
             "order"_a)
@@ -221,8 +276,139 @@ py_bind_game(py::module& root) {
         .def("score_final", [](State& state) { Game::score_final(state); })
         .def("legal", [](Action action, const State& state) { return Game::legal(action, state); })
         .def("apply", [](Action action, State& state) { Game::apply(action, state); })
-        .def("all_legal", &Game::all_legal)
-        .def("all_non_penalty_legal", &Game::all_non_penalty_legal)
-        .def("all_penalty_legal", &Game::all_penalty_legal)
-        .def("all_smart_legal", &Game::all_smart_legal);
-}
\ No newline at end of file
+        .def("all_legal", [](const State& state) { return Game::all_legal(state); })
+        .def("all_non_penalty_legal", [](const State& state) { return Game::all_non_penalty_legal(state); })
+        .def("all_penalty_legal", [](const State& state) { return Game::all_penalty_legal(state); })
+        .def("all_smart_legal", [](const State& state) { return Game::all_smart_legal(state); })
+        .def("legal_mask",
+            [](const State& state, py::object out) {
+                ushort count = action_index_count(*state.get_rules());
+                if (out.is_none()) {
+                    out = py::array_t<uint8_t>(count);
+                }
+                Game::legal_mask(state, py_buffer_values<uint8_t>(out.cast<py::buffer>().request(true), count));
+                return out;
+            },
+            "Writes 1 at the action_index of legal actions and 0 elsewhere into 'out', a C-contiguous uint8 buffer "
+            "of action_index_count values, or into a new array if 'out' is None, and returns it",
+            "state"_a,
+            "out"_a = py::none())
+        .def("legal_indices",
+            [](const State& state) {
+                std::bitset<MAX_ACTION_COUNT> mask;
+                Game::legal_mask(state, mask);
+                std::vector<int> indices;
+                for (int index = 0; index < MAX_ACTION_COUNT; index++) {
+                    if (mask[index]) {
+                        indices.push_back(index);
+                    }
+                }
+                return indices;
+            },
+            "Increasing action_index of the legal actions, for rules of at most MAX_ACTION_COUNT indices",
+            "state"_a);
+
+    m.def("action_index_count",
+        [](const Rules& rules) { return action_index_count(rules); },
+        "rules"_a);
+    m.def("action_index",
+        [](Action action, const Rules& rules) { return action_index(action, rules); },
+        "Dense index of the action, (pick * tile_types + color) * (tile_types + 1) + place",
+        "action"_a,
+        "rules"_a);
+    m.def("index_action",
+        &index_action,
+        "index"_a,
+        "rules"_a);
+
+    py::class_<RoundRecord>(m, "RoundRecord")
+        .def_readonly("factories", &RoundRecord::factories)
+        .def_readonly("actions", &RoundRecord::actions);
+
+    py::class_<GameRecord>(m, "GameRecord")
+        .def_readonly("seed", &GameRecord::seed)
+        .def_readonly("order", &GameRecord::order)
+        .def_readonly("scores", &GameRecord::scores)
+        .def_readonly("rounds", &GameRecord::rounds);
+
+    py::class_<GameRecordWriter, std::shared_ptr<GameRecordWriter>>(m, "GameRecordWriter")
+        .def(py::init<const std::string&, std::shared_ptr<const Rules>, bool, std::size_t>(),
+            "path"_a,
+            "rules"_a,
+            "append"_a = false,
+            "buffer_size"_a = 1 << 20)
+        .def("write", &GameRecordWriter::write, "record"_a)
+        .def("flush", &GameRecordWriter::flush);
+
+    py::class_<GameRecorder, std::shared_ptr<GameRecorder>, Observer>(m, "GameRecorder")
+        .def(py::init<std::shared_ptr<GameRecordWriter>>(), "writer"_a);
+
+    py::class_<GameRecords>(m, "GameRecords")
+        .def(py::init<const std::string&>(), "path"_a)
+        .def_property_readonly("rules", &GameRecords::get_rules)
+        .def("__len__", &GameRecords::size)
+        .def("__getitem__", &GameRecords::get, "index"_a)
+        .def("replay",
+            py::overload_cast<std::size_t, Observer&>(&GameRecords::replay, py::const_),
+            "index"_a,
+            "observer"_a)
+        .def("replay",
+            py::overload_cast<std::size_t>(&GameRecords::replay, py::const_),
+            "index"_a);
+
+    py::class_<VecEnv>(m, "VecEnv")
+        .def(py::init<std::shared_ptr<const Rules>, int, int>(),
+            "rules"_a,
+            "size"_a,
+            "seed"_a = 0)
+        .def_readwrite("thread_limit", &VecEnv::thread_limit)
+        .def("__len__", &VecEnv::size)
+        .def_property_readonly("rules", &VecEnv::get_rules)
+        .def_property_readonly("action_count", &VecEnv::get_action_count)
+        .def("state", &VecEnv::get_state, "env"_a)
+
+        .def("reset",
+            [](py::object self) {
+                self.cast<VecEnv&>().reset();
+                return py_env_observations(self);
+            },
+            "Starts new games in every env and returns the observations")
+        .def("step",
+            [](py::object self, py::array_t<int32_t, py::array::c_style | py::array::forcecast> actions) {
+                VecEnv& env = self.cast<VecEnv&>();
+                if (actions.size() != env.size()) {
+                    throw std::invalid_argument("step needs one action per env");
+                }
+                {
+                    py::gil_scoped_release release;
+                    env.step(actions.data());
+                }
+                return py::make_tuple(
+                    py_env_observations(self),
+                    py_env_view(self, env.get_rewards(), env.get_rules()->player_count),
+                    py_env_view(self, env.get_dones(), 0),
+                    py_env_view(self, env.get_masks(), env.get_action_count()));
+            },
+            "Plays one action index per env and returns (observations, rewards, dones, masks).\n"
+            "Arrays are read-only views of the env, overwritten by the next step",
+            "actions"_a)
+
+        .def_property_readonly("observations", &py_env_observations)
+        .def_property_readonly("masks", [](py::object self) {
+            const VecEnv& env = self.cast<const VecEnv&>();
+            return py_env_view(self, env.get_masks(), env.get_action_count());
+        })
+        .def_property_readonly("rewards", [](py::object self) {
+            const VecEnv& env = self.cast<const VecEnv&>();
+            return py_env_view(self, env.get_rewards(), env.get_rules()->player_count);
+        })
+        .def_property_readonly("dones", [](py::object self) {
+            return py_env_view(self, self.cast<const VecEnv&>().get_dones(), 0);
+        })
+        .def_property_readonly("players", [](py::object self) {
+            return py_env_view(self, self.cast<const VecEnv&>().get_players(), 0);
+        })
+        .def_property_readonly("winners", [](py::object self) {
+            return py_env_view(self, self.cast<const VecEnv&>().get_winners(), 0);
+        });
+}
@@ -0,0 +1,256 @@
+#include "vec_env.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+
+#include "utils/bits.hpp"
+
+VecEnv::VecEnv(std::shared_ptr<const Rules> rules, int size, int seed)
+  : rules(rules)
+  , encoder(rules)
+  , games()
+  , action_count(action_index_count(*rules))
+  , observations(std::size_t(size) * encoder.size())
+  , masks(std::size_t(size) * action_count)
+  , rewards(std::size_t(size) * rules->player_count)
+  , dones(size)
+  , players(size)
+  , winners(size) {
+    if (size <= 0) {
+        throw std::invalid_argument("VecEnv needs at least one game");
+    }
+    games.reserve(size);
+    for (int env = 0; env < size; env++) {
+        games.emplace_back(rules, int(mix64(uint64_t(uint32_t(seed)) << 32 | uint32_t(env))));
+        games.back().enable_legal_masks();
+    }
+    reset();
+}
+
+VecEnv::~VecEnv() {
+    stop_workers();
+}
+
+int
+VecEnv::size() const {
+    return games.size();
+}
+
+const std::shared_ptr<const Rules>&
+VecEnv::get_rules() const {
+    return rules;
+}
+
+const State&
+VecEnv::get_state(int env) const {
+    if (env < 0 || env >= size()) {
+        throw std::invalid_argument("Env " + std::to_string(env) + " does not exist");
+    }
+    return games[env].get_state();
+}
+
+const StateEncoder&
+VecEnv::get_encoder() const {
+    return encoder;
+}
+
+ushort
+VecEnv::get_action_count() const {
+    return action_count;
+}
+
+// "count" threads run the steps, this one and "count" - 1 workers
+void
+VecEnv::start_workers(int count) {
+    if (int(workers.size()) == count - 1) {
+        return;
+    }
+    stop_workers();
+    stopping = false;
+    tasks.reset(new TaskPool(count));
+    for (int worker = 1; worker < count; worker++) {
+        workers.push_back(std::thread(&VecEnv::work, this, worker, generation));
+    }
+}
+
+void
+VecEnv::stop_workers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    started.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+// Runs the tasks of each step after "seen"
+void
+VecEnv::work(int worker, long long seen) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        started.wait(lock, [this, seen]() { return stopping || generation != seen; });
+        if (stopping) {
+            return;
+        }
+        seen = generation;
+        lock.unlock();
+        run_tasks(worker);
+        lock.lock();
+        if (--running == 0) {
+            finished.notify_all();
+        }
+    }
+}
+
+void
+VecEnv::run_tasks(int worker) {
+    ArenaTask task;
+    while (tasks->pop(worker, task)) {
+        try {
+            for (int env = task.first; env < task.first + task.count; env++) {
+                job(env);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            error = std::current_exception();
+        }
+    }
+}
+
+// Envs are dealt in a few tasks per thread, as ending rounds makes some steps longer
+void
+VecEnv::for_each_env(std::function<void(int)> body) {
+    int count = std::max(1, std::min(thread_limit, size()));
+    if (count == 1) {
+        for (int env = 0; env < size(); env++) {
+            body(env);
+        }
+        return;
+    }
+    start_workers(count);
+    int chunk = std::max(1, size() / (4 * count));
+    std::vector<ArenaTask> envs;
+    for (int first = 0; first < size(); first += chunk) {
+        envs.push_back(ArenaTask{ 0, first, std::min(chunk, size() - first) });
+    }
+    tasks->deal(envs);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = body;
+        error = nullptr;
+        running = count - 1;
+        generation++;
+    }
+    started.notify_all();
+    run_tasks(0);
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this]() { return running == 0; });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void
+VecEnv::start_game(int env) {
+    games[env].reset();
+    games[env].start_round();
+}
+
+void
+VecEnv::write_rows(int env) {
+    const State& state = games[env].get_state();
+    encoder.encode(state, observations.data() + std::size_t(env) * encoder.size());
+    Game::legal_mask(state, masks.data() + std::size_t(env) * action_count);
+    players[env] = state.get_current_player();
+}
+
+void
+VecEnv::step_env(int env, int32_t action) {
+    Game& game = games[env];
+    const State& state = game.get_state();
+    ushort p = rules->player_count;
+    std::array<int, MAX_PLAYER_COUNT> scores;
+    for (ushort seat = 0; seat < p; seat++) {
+        scores[seat] = state.get_panel_unchecked(seat).get_score();
+    }
+    Game::apply_unchecked(index_action(action, *rules), game.state);
+    game.next_player();
+    bool done = false;
+    while (state.is_round_finished()) {
+        game.end_round();
+        if (state.is_game_finished()) {
+            game.score_final();
+            done = true;
+            break;
+        }
+        game.start_round();
+    }
+    float* reward = rewards.data() + std::size_t(env) * p;
+    for (ushort seat = 0; seat < p; seat++) {
+        reward[seat] = int(state.get_panel_unchecked(seat).get_score()) - scores[seat];
+    }
+    dones[env] = done;
+    winners[env] = done ? state.winning_player() : -1;
+    if (done) {
+        start_game(env);
+    }
+    write_rows(env);
+}
+
+void
+VecEnv::reset() {
+    for_each_env([this](int env) {
+        start_game(env);
+        std::fill(rewards.begin() + env * rules->player_count, rewards.begin() + (env + 1) * rules->player_count, 0);
+        dones[env] = 0;
+        winners[env] = -1;
+        write_rows(env);
+    });
+}
+
+void
+VecEnv::step(const int32_t* actions) {
+    for (int env = 0; env < size(); env++) {
+        if (actions[env] < 0 || actions[env] >= action_count || !games[env].legal(index_action(actions[env], *rules))) {
+            throw std::invalid_argument("Action " + std::to_string(actions[env]) + " is not legal in env " + std::to_string(env));
+        }
+    }
+    for_each_env([this, actions](int env) {
+        step_env(env, actions[env]);
+    });
+}
+
+const std::vector<float>&
+VecEnv::get_observations() const {
+    return observations;
+}
+
+const std::vector<uint8_t>&
+VecEnv::get_masks() const {
+    return masks;
+}
+
+const std::vector<float>&
+VecEnv::get_rewards() const {
+    return rewards;
+}
+
+const std::vector<uint8_t>&
+VecEnv::get_dones() const {
+    return dones;
+}
+
+const std::vector<int8_t>&
+VecEnv::get_players() const {
+    return players;
+}
+
+const std::vector<int8_t>&
+VecEnv::get_winners() const {
+    return winners;
+}
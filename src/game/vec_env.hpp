@@ -0,0 +1,92 @@
+#ifndef VEC_ENV_HPP
+#define VEC_ENV_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "action.hpp"
+#include "analysis/task_pool.hpp"
+#include "game.hpp"
+#include "rules/rules.hpp"
+#include "state/state_encoder.hpp"
+
+// Independent games stepped together, for reinforcement learning. Each step
+// plays one action in every game, for its current player, then finishes rounds
+// and starts new ones, and restarts games that ended. Results of the last step
+// are kept in contiguous rows, one per game:
+//   observations: the state seen by the player to play, see StateEncoder
+//   masks: 1 for each legal action index, see action_index
+//   rewards: score won by each seat during the step, the final bonus included
+//   dones: 1 if the game ended, in which case the other rows describe the new game
+//   players: seat to play
+//   winners: seat that won the game that ended, -1 if it did not
+class VecEnv {
+private:
+    std::shared_ptr<const Rules> rules;
+    StateEncoder encoder;
+    std::vector<Game> games;
+    ushort action_count;
+
+    std::vector<float> observations;
+    std::vector<uint8_t> masks;
+    std::vector<float> rewards;
+    std::vector<uint8_t> dones;
+    std::vector<int8_t> players;
+    std::vector<int8_t> winners;
+
+    // Workers are kept between steps, and woken for each of them. Envs
+    // of a step are split in tasks, the "group" of a task being unused
+    std::vector<std::thread> workers;
+    std::unique_ptr<TaskPool> tasks;
+    std::mutex mutex;
+    std::condition_variable started;
+    std::condition_variable finished;
+    std::function<void(int)> job;
+    long long generation = 0;
+    int running = 0;
+    bool stopping = false;
+    std::exception_ptr error;
+
+    void start_game(int env);
+    void step_env(int env, int32_t action);
+    void write_rows(int env);
+    void start_workers(int count);
+    void stop_workers();
+    void work(int worker, long long seen);
+    void run_tasks(int worker);
+    // Calls "body" on each game, split between threads
+    void for_each_env(std::function<void(int)> body);
+
+public:
+    int thread_limit = 1;
+
+    // Game "env" is seeded from "seed" and "env"
+    VecEnv(std::shared_ptr<const Rules> rules, int size, int seed);
+    ~VecEnv();
+
+    int size() const;
+    const std::shared_ptr<const Rules>& get_rules() const;
+    const State& get_state(int env) const;
+    const StateEncoder& get_encoder() const;
+    ushort get_action_count() const;
+
+    // Starts new games in every env
+    void reset();
+    // "actions" holds one action index per game. Throws if one is illegal, before playing any
+    void step(const int32_t* actions);
+
+    const std::vector<float>& get_observations() const;
+    const std::vector<uint8_t>& get_masks() const;
+    const std::vector<float>& get_rewards() const;
+    const std::vector<uint8_t>& get_dones() const;
+    const std::vector<int8_t>& get_players() const;
+    const std::vector<int8_t>& get_winners() const;
+};
+
+#endif //VEC_ENV_HPP
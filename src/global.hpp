@@ -4,5 +4,7 @@
 typedef unsigned short ushort;
 
 const ushort TILE_TYPES = 5;
+const ushort MAX_PLAYER_COUNT = 4;
+const ushort MAX_FACTORY_COUNT = 1 + 2 * MAX_PLAYER_COUNT;
 
 #endif //GLOBAL_HPP
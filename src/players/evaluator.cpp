@@ -0,0 +1,116 @@
+#include "evaluator.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "game/action.hpp"
+
+Evaluator::Evaluator(std::shared_ptr<const Rules> rules)
+  : rules(rules)
+  , encoder(rules) {}
+
+const std::shared_ptr<const Rules>&
+Evaluator::get_rules() const {
+    return rules;
+}
+
+const StateEncoder&
+Evaluator::get_encoder() const {
+    return encoder;
+}
+
+bool
+Evaluator::allows_threads() const {
+    return true;
+}
+
+std::string
+Evaluator::name() const {
+    return "evaluator";
+}
+
+
+EvaluationQueue::EvaluationQueue(std::shared_ptr<Evaluator> evaluator, int batch_size)
+  : evaluator(evaluator)
+  , open(std::make_shared<Batch>())
+  , batch_size(batch_size) {}
+
+const std::shared_ptr<Evaluator>&
+EvaluationQueue::get_evaluator() const {
+    return evaluator;
+}
+
+// Evaluates a closed batch, without the lock, and hands the results to its threads
+void
+EvaluationQueue::run(const std::shared_ptr<Batch>& batch) {
+    const Rules& rules = *evaluator->get_rules();
+    int count = batch->policies.size();
+    std::size_t actions = action_index_count(rules);
+    std::vector<float> policies(count * actions);
+    std::vector<float> values(count * rules.player_count);
+    std::exception_ptr error;
+    try {
+        evaluator->evaluate(count, batch->observations.data(), policies.data(), values.data());
+        for (int i = 0; i < count; i++) {
+            std::copy(policies.begin() + i * actions, policies.begin() + (i + 1) * actions, batch->policies[i]);
+            std::copy(values.begin() + i * rules.player_count, values.begin() + (i + 1) * rules.player_count, batch->values[i]);
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    batch->done = true;
+    batch->error = error;
+    batch_count++;
+    evaluation_count += count;
+    evaluated.notify_all();
+}
+
+void
+EvaluationQueue::evaluate(const float* observation, float* policy, float* values) {
+    std::size_t size = evaluator->get_encoder().size();
+    std::unique_lock<std::mutex> lock(mutex);
+    std::shared_ptr<Batch> batch = open;
+    batch->observations.insert(batch->observations.end(), observation, observation + size);
+    batch->policies.push_back(policy);
+    batch->values.push_back(values);
+    bool full = int(batch->policies.size()) >= batch_size;
+    if (!full && !evaluated.wait_for(lock, std::chrono::microseconds(max_wait), [&batch]() { return batch->done; })) {
+        // The first thread to wait too long evaluates the batch if nobody else did
+        full = open == batch;
+    }
+    if (full) {
+        open = std::make_shared<Batch>();
+        lock.unlock();
+        run(batch);
+        lock.lock();
+    }
+    evaluated.wait(lock, [&batch]() { return batch->done; });
+    if (batch->error) {
+        std::rethrow_exception(batch->error);
+    }
+}
+
+void
+EvaluationQueue::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (open->policies.empty()) {
+        return;
+    }
+    std::shared_ptr<Batch> batch = open;
+    open = std::make_shared<Batch>();
+    lock.unlock();
+    run(batch);
+}
+
+long long
+EvaluationQueue::get_batch_count() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return batch_count;
+}
+
+long long
+EvaluationQueue::get_evaluation_count() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return evaluation_count;
+}
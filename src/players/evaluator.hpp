@@ -0,0 +1,77 @@
+#ifndef EVALUATOR_HPP
+#define EVALUATOR_HPP
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "rules/rules.hpp"
+#include "state/state_encoder.hpp"
+
+// Priors and values of batches of states, for search players. States are given
+// as StateEncoder planes, so values are ordered from the player to play
+class Evaluator {
+protected:
+    std::shared_ptr<const Rules> rules;
+    StateEncoder encoder;
+
+public:
+    Evaluator(std::shared_ptr<const Rules> rules);
+    virtual ~Evaluator() = default;
+
+    const std::shared_ptr<const Rules>& get_rules() const;
+    const StateEncoder& get_encoder() const;
+
+    // For each of the "count" states of "observations", writes in "policies" a
+    // logit for each action_index, and in "values" the expected share of wins of
+    // each player. Called from several threads, one batch at a time
+    virtual void evaluate(int count, const float* observations, float* policies, float* values) = 0;
+    // False if "evaluate" would block when called from other threads than the
+    // calling one, so that a search using it should stay on this thread
+    virtual bool allows_threads() const;
+
+    virtual std::string name() const;
+};
+
+// Gathers evaluations of single states, requested from any thread, into batches
+// for an Evaluator. A batch is evaluated by the thread that fills it, or by its
+// first thread once it waited "max_wait" microseconds, while the others wait
+class EvaluationQueue {
+private:
+    struct Batch {
+        std::vector<float> observations;
+        std::vector<float*> policies;
+        std::vector<float*> values;
+        bool done = false;
+        std::exception_ptr error;
+    };
+
+    std::shared_ptr<Evaluator> evaluator;
+    std::mutex mutex;
+    std::condition_variable evaluated;
+    std::shared_ptr<Batch> open;
+    long long batch_count = 0;
+    long long evaluation_count = 0;
+
+    void run(const std::shared_ptr<Batch>& batch);
+
+public:
+    int batch_size;
+    int max_wait = 200;
+
+    EvaluationQueue(std::shared_ptr<Evaluator> evaluator, int batch_size = 8);
+
+    const std::shared_ptr<Evaluator>& get_evaluator() const;
+    // Blocks until the batch of the state is evaluated, rethrowing the errors of the Evaluator
+    void evaluate(const float* observation, float* policy, float* values);
+    // Evaluates the waiting states now, for threads that would wait for them
+    void flush();
+
+    long long get_batch_count();
+    long long get_evaluation_count();
+};
+
+#endif //EVALUATOR_HPP
@@ -10,6 +10,11 @@ FirstLegalPlayer::copy() const {
 
 Action
 FirstLegalPlayer::play(const State& state) {
+    return first_legal(state);
+}
+
+Action
+FirstLegalPlayer::first_legal(const State& state) {
     auto rules = state.get_rules();
     for (ushort place = rules->tile_types; place != std::numeric_limits<ushort>::max(); place--) {
         for (ushort pick = 0; pick <= rules->factory_count(); pick++) {
@@ -11,6 +11,7 @@ public:
     virtual std::shared_ptr<Player> copy() const override;
 
     virtual Action play(const State& state) override;
+    Action static first_legal(const State& state);
 
     virtual std::string player_type() const override;
 };
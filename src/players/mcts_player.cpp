@@ -0,0 +1,405 @@
+#include "mcts_player.hpp"
+
+#include "game/game.hpp"
+
+MctsPlayer::MctsPlayer(bool until_round, int rollouts)
+  : rollouts(rollouts)
+  , until_round(until_round) {}
+
+MctsPlayer::MctsPlayer(const MctsPlayer& other)
+  : std::enable_shared_from_this<MctsPlayer>()
+  , Player()
+  , Observer()
+  , heuristic(other.heuristic)
+  , rollouts(other.rollouts)
+  , until_round(other.until_round)
+  , smart(other.smart)
+  , c(other.c)
+  , widening(other.widening)
+  , max_nodes(other.max_nodes)
+  , transpositions(other.transpositions) {}
+
+MctsPlayer::~MctsPlayer() = default;
+
+// Private
+
+// Statistics of a new node, which are the ones of its state if it is already in the table
+uint32_t
+MctsPlayer::add_stats(const CompactState& state, NodeType type, const Stats& initial) {
+    uint32_t index = stats.size();
+    if (transpositions) {
+        uint32_t stored = table.insert(state.hash ^ type, index);
+        if (stored != index && stored != TranspositionTable::NONE) {
+            return stored;
+        }
+    }
+    stats.push_back(initial);
+    return index;
+}
+
+uint32_t
+MctsPlayer::add_node(const CompactState& state, NodeType type, Action action) {
+    Node node;
+    node.state = state;
+    node.action = action;
+    node.type = type;
+    node.child_count = 0;
+    node.action_count = 0;
+    if (type == DECISION) {
+        node.action_count = smart ? Game::count_smart_legal(state) : Game::count_legal(state);
+    }
+    node.first_child = NONE;
+    node.next_sibling = NONE;
+    node.stats = add_stats(state, type, Stats{ 0, {} });
+    nodes.push_back(node);
+    return nodes.size() - 1;
+}
+
+uint32_t
+MctsPlayer::add_child(uint32_t parent, const CompactState& state, NodeType type, Action action) {
+    uint32_t index = add_node(state, type, action);
+    nodes[index].next_sibling = nodes[parent].first_child;
+    nodes[parent].first_child = index;
+    nodes[parent].child_count++;
+    return index;
+}
+
+uint32_t
+MctsPlayer::find_child(uint32_t parent, const CompactState& state) const {
+    for (uint32_t child = nodes[parent].first_child; child != NONE; child = nodes[child].next_sibling) {
+        if (nodes[child].state == state) {
+            return child;
+        }
+    }
+    return NONE;
+}
+
+// Copies the subtree of "index" at the beginning of the spare pool,
+// which then replaces the current one
+void
+MctsPlayer::move_root(uint32_t index) {
+    if (index == 0) {
+        root = 0;
+        return;
+    }
+    spare_nodes.clear();
+    spare_nodes.push_back(nodes[index]);
+    spare_nodes[0].next_sibling = NONE;
+    for (std::size_t i = 0; i < spare_nodes.size(); i++) {
+        uint32_t previous = NONE;
+        uint32_t child = spare_nodes[i].first_child;
+        spare_nodes[i].first_child = NONE;
+        for (; child != NONE; child = nodes[child].next_sibling) {
+            uint32_t copy = spare_nodes.size();
+            spare_nodes.push_back(nodes[child]);
+            spare_nodes[copy].next_sibling = NONE;
+            if (previous == NONE) {
+                spare_nodes[i].first_child = copy;
+            } else {
+                spare_nodes[previous].next_sibling = copy;
+            }
+            previous = copy;
+        }
+    }
+    std::swap(nodes, spare_nodes);
+    root = 0;
+    // Statistics of the kept nodes are compacted the same way
+    std::swap(stats, spare_stats);
+    stats.clear();
+    table.clear();
+    for (Node& node : nodes) {
+        node.stats = add_stats(node.state, node.type, spare_stats[node.stats]);
+    }
+}
+
+// Keeps the tree if its root is "state", and resets it otherwise
+void
+MctsPlayer::prepare(const State& state) {
+    rules = state.get_rules();
+    table.reserve(transpositions ? max_nodes : 0);
+    simulation.reset(new Rollout<RandomPolicy>(rules, RandomPolicy{ smart }, randomness()));
+
+    CompactState current(state);
+    if (root != NONE && nodes[root].type == DECISION && nodes[root].state == current) {
+        move_root(root);
+    } else {
+        clear_tree();
+        root = add_node(current, DECISION);
+    }
+}
+
+
+uint32_t
+MctsPlayer::expand(uint32_t index) {
+    CompactState next = nodes[index].state;
+    ushort k = nodes[index].child_count;
+    Action action = smart ? Game::nth_smart_legal(next, k) : Game::nth_legal(next, k);
+    Game::apply_unchecked(action, next);
+    next.next_player();
+    if (!next.is_round_finished()) {
+        return add_child(index, next, DECISION, action);
+    }
+    // Same steps as Game::end_round, and Game::score_final if the game is over
+    State after = next.to_state(rules);
+    Game::score_panels(after);
+    Game::apply_first_token(after);
+    if (after.is_game_finished()) {
+        Game::score_final(after);
+        return add_child(index, CompactState(after), TERMINAL, action);
+    }
+    return add_child(index, CompactState(after), CHANCE, action);
+}
+
+// Selects child with highest UCT for the player acting at node "index",
+// see MonteCarloPlayer::select_ucb
+uint32_t
+MctsPlayer::select_uct(uint32_t index) const {
+    const Node& node = nodes[index];
+    ushort player = node.state.get_current_player();
+    float ln_n = log(stats[node.stats].visits);
+    float highest_uct = -std::numeric_limits<float>::infinity();
+    uint32_t highest_index = NONE;
+    for (uint32_t child = node.first_child; child != NONE; child = nodes[child].next_sibling) {
+        const Stats& child_stats = stats[nodes[child].stats];
+        if (child_stats.visits == 0) {
+            return child;
+        }
+        float uct = (child_stats.score_sums[player] / child_stats.visits) + c * sqrt(ln_n / child_stats.visits);
+        if (uct > highest_uct) {
+            highest_uct = uct;
+            highest_index = child;
+        }
+    }
+    return highest_index;
+}
+
+// Draws the factories of the next round. A new outcome becomes a child as long as
+// progressive widening allows it, otherwise one of the known outcomes is picked
+// uniformly, since they were all drawn with the right probabilities
+uint32_t
+MctsPlayer::sample_outcome(uint32_t index, bool& created) {
+    created = false;
+    simulation->override_state(nodes[index].state);
+    simulation->start_round();
+    CompactState outcome(simulation->get_state());
+    uint32_t match = find_child(index, outcome);
+    if (match != NONE) {
+        return match;
+    }
+    const Node& node = nodes[index];
+    if (nodes.size() < max_nodes && node.child_count < 1 + pow(stats[node.stats].visits, widening)) {
+        created = true;
+        return add_child(index, outcome, DECISION);
+    }
+    if (node.child_count == 0) {
+        return NONE;
+    }
+    ushort k = unit(randomness) * node.child_count;
+    uint32_t child = node.first_child;
+    for (; k > 0 && nodes[child].next_sibling != NONE; k--) {
+        child = nodes[child].next_sibling;
+    }
+    return child;
+}
+
+// Score of each player after a rollout from node "index"
+std::array<float, MAX_PLAYER_COUNT>
+MctsPlayer::evaluate(uint32_t index) {
+    const Node& node = nodes[index];
+    simulation->override_state(node.state);
+    if (node.type == TERMINAL) {
+        return final_scores(simulation->get_state());
+    }
+    if (node.type == CHANCE) {
+        simulation->start_round();
+    }
+    simulation->roll_round();
+    simulation->end_round();
+    if (!until_round) {
+        simulation->roll_end_game();
+        return final_scores(simulation->get_state());
+    }
+    const State& state = simulation->get_state();
+    if (state.is_game_finished()) {
+        simulation->score_final();
+        return final_scores(state);
+    }
+    std::array<float, MAX_PLAYER_COUNT> scores{};
+    for (int p = 0; p < rules->player_count; p++) {
+        scores[p] = heuristic.eval(state, p);
+    }
+    return scores;
+}
+
+std::array<float, MAX_PLAYER_COUNT>
+MctsPlayer::final_scores(const State& state) const {
+    std::array<float, MAX_PLAYER_COUNT> scores{};
+    scores[state.winning_player()] = 1.f;
+    return scores;
+}
+
+void
+MctsPlayer::search() {
+    for (int k = 0; k < rollouts; k++) {
+        // Selection and expansion
+        path.clear();
+        uint32_t index = root;
+        path.push_back(index);
+        bool leaf = false;
+        while (!leaf) {
+            const Node& node = nodes[index];
+            if (node.type == TERMINAL || (node.type == DECISION && node.action_count == 0)) {
+                break;
+            }
+            if (node.type == DECISION) {
+                if (node.child_count < node.action_count) {
+                    if (nodes.size() >= max_nodes) {
+                        break;
+                    }
+                    index = expand(index);
+                    leaf = true;
+                } else {
+                    index = select_uct(index);
+                }
+            } else {
+                uint32_t outcome = sample_outcome(index, leaf);
+                if (outcome == NONE) {
+                    break;
+                }
+                index = outcome;
+            }
+            path.push_back(index);
+        }
+        // Simulation and backpropagation
+        std::array<float, MAX_PLAYER_COUNT> scores = evaluate(path.back());
+        for (uint32_t i : path) {
+            Stats& node_stats = stats[nodes[i].stats];
+            node_stats.visits++;
+            for (ushort p = 0; p < MAX_PLAYER_COUNT; p++) {
+                node_stats.score_sums[p] += scores[p];
+            }
+        }
+    }
+}
+
+
+// Public
+
+bool
+MctsPlayer::check_rules(const Rules& rules) const {
+    return CompactState::supports(rules);
+}
+
+std::shared_ptr<Player>
+MctsPlayer::copy() const {
+    return std::make_shared<MctsPlayer>(*this);
+}
+
+Action
+MctsPlayer::play(const State& state) {
+    prepare(state);
+    if (nodes[root].action_count == 1) {
+        return smart ? Game::nth_smart_legal(nodes[root].state, 0) : Game::nth_legal(nodes[root].state, 0);
+    }
+    search();
+    // Most visited action, or the first legal one if the search visited none
+    Action best_action = smart ? Game::nth_smart_legal(nodes[root].state, 0) : Game::nth_legal(nodes[root].state, 0);
+    uint32_t best_visits = 0;
+    for (uint32_t child = nodes[root].first_child; child != NONE; child = nodes[child].next_sibling) {
+        uint32_t visits = stats[nodes[child].stats].visits;
+        if (visits > best_visits) {
+            best_visits = visits;
+            best_action = nodes[child].action;
+        }
+    }
+    return best_action;
+}
+
+void
+MctsPlayer::reseed(int seed) {
+    randomness.seed(seed);
+}
+
+
+std::string
+MctsPlayer::player_type() const {
+    return "mcts-" +
+           std::to_string(rollouts) +
+           (smart ? "" : "-naive") +
+           (transpositions ? "" : "-no-tt") +
+           "-" + (until_round ? heuristic.str() : "full");
+}
+
+
+// Tree
+
+std::size_t
+MctsPlayer::get_tree_size() const {
+    return nodes.size();
+}
+
+uint32_t
+MctsPlayer::get_root_visits() const {
+    return root == NONE ? 0 : stats[nodes[root].stats].visits;
+}
+
+void
+MctsPlayer::clear_tree() {
+    nodes.clear();
+    stats.clear();
+    table.clear();
+    root = NONE;
+}
+
+
+// Observer
+
+std::shared_ptr<Observer>
+MctsPlayer::observer() {
+    return shared_from_this();
+}
+
+void
+MctsPlayer::start_game(std::vector<ushort> /*order*/) {
+    clear_tree();
+}
+
+// The root follows the factories drawn by the game, if it
+// was waiting for them. Otherwise the tree will be reset
+void
+MctsPlayer::new_round(const State& state) {
+    if (root == NONE || nodes[root].type != CHANCE) {
+        root = NONE;
+        return;
+    }
+    CompactState outcome(state);
+    uint32_t match = find_child(root, outcome);
+    if (match == NONE && nodes.size() < max_nodes) {
+        match = add_child(root, outcome, DECISION);
+    }
+    root = match;
+}
+
+// The root follows the actions played by all players (including this one).
+// Whether the new root matches the state is checked in the next call to play,
+// so the tree is simply reset if it missed some actions, or saw some twice
+void
+MctsPlayer::action_played(Action action) {
+    if (root == NONE || nodes[root].type != DECISION) {
+        root = NONE;
+        return;
+    }
+    uint32_t next_root = NONE;
+    for (uint32_t child = nodes[root].first_child; child != NONE; child = nodes[child].next_sibling) {
+        if (nodes[child].action == action) {
+            next_root = child;
+            break;
+        }
+    }
+    root = next_root;
+}
+
+void
+MctsPlayer::end_game(const State& /*state*/, ushort /*winner_position*/) {
+    clear_tree();
+}
@@ -0,0 +1,135 @@
+#ifndef MCTS_PLAYER_HPP
+#define MCTS_PLAYER_HPP
+
+#include "game/action.hpp"
+#include "game/observer.hpp"
+#include "game/player.hpp"
+#include "global.hpp"
+#include "rollout.hpp"
+#include "round_heuristic.hpp"
+#include "state/compact_state.hpp"
+#include "state/state.hpp"
+#include "transposition_table.hpp"
+#include "utils/random.hpp"
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+// Monte Carlo Tree Search player, expanding one node per rollout with UCT.
+// Tile draws between rounds are chance nodes, whose outcomes are sampled
+// with progressive widening. As an observer, the player follows the actions
+// played in its game, so the subtree of the new position is kept between moves.
+// Nodes of the same state, reached by different orders of actions, can share
+// their statistics through a transposition table.
+class MctsPlayer
+  : public std::enable_shared_from_this<MctsPlayer>
+  , public Player
+  , public Observer {
+public:
+    enum NodeType {
+        DECISION,
+        CHANCE,
+        TERMINAL,
+    };
+
+    // Nodes are stored in a pool, and refer to each other by index
+    struct Node {
+        // Decision: state before the current player acts
+        // Chance: state after the end of the round, before factories are filled
+        // Terminal: state after final scoring
+        CompactState state;
+        // Action leading to this node, if its parent is a decision node
+        Action action;
+        NodeType type;
+        // Number of children, and of legal actions for decision nodes
+        ushort child_count;
+        ushort action_count;
+        uint32_t first_child;
+        uint32_t next_sibling;
+        // Index of the statistics of the node
+        uint32_t stats;
+    };
+
+    struct Stats {
+        uint32_t visits;
+        std::array<float, MAX_PLAYER_COUNT> score_sums;
+    };
+
+    constexpr static uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+private:
+    std::vector<Node> nodes;
+    // Second pool, where the kept subtree is copied when moving the root
+    std::vector<Node> spare_nodes;
+    uint32_t root = NONE;
+    std::vector<uint32_t> path;
+    // Statistics of the nodes, and a second pool to compact them when moving the root
+    std::vector<Stats> stats;
+    std::vector<Stats> spare_stats;
+    // Index in stats of each state, if transpositions are shared
+    TranspositionTable table;
+
+    std::shared_ptr<const Rules> rules;
+    std::unique_ptr<Rollout<RandomPolicy>> simulation;
+    rng randomness = rng(random_seed());
+    std::uniform_real_distribution<float> unit{ 0.f, 1.f };
+
+    uint32_t add_stats(const CompactState& state, NodeType type, const Stats& initial);
+    uint32_t add_node(const CompactState& state, NodeType type, Action action = Action());
+    uint32_t add_child(uint32_t parent, const CompactState& state, NodeType type, Action action = Action());
+    uint32_t find_child(uint32_t parent, const CompactState& state) const;
+    void move_root(uint32_t index);
+    void prepare(const State& state);
+
+    uint32_t expand(uint32_t index);
+    uint32_t select_uct(uint32_t index) const;
+    uint32_t sample_outcome(uint32_t index, bool& created);
+    std::array<float, MAX_PLAYER_COUNT> evaluate(uint32_t index);
+    std::array<float, MAX_PLAYER_COUNT> final_scores(const State& state) const;
+    void search();
+
+public:
+    constexpr static int DEFAULT_ROLLOUTS = 1000;
+    constexpr static float DEFAULT_C = M_SQRT2;
+    constexpr static uint32_t DEFAULT_MAX_NODES = 100000;
+    RoundHeuristic heuristic{};
+    int rollouts;
+    bool until_round;
+    bool smart = true;
+    float c = DEFAULT_C;
+    // A chance node visited n times has at most 1 + n^widening sampled outcomes
+    float widening = 0.5f;
+    // Once the pool holds this many nodes, rollouts start from leaves without expanding them
+    uint32_t max_nodes = DEFAULT_MAX_NODES;
+    // Whether nodes of the same state share their statistics
+    bool transpositions = true;
+
+    MctsPlayer(bool until_round = true, int rollouts = DEFAULT_ROLLOUTS);
+    MctsPlayer(const MctsPlayer& other);
+    ~MctsPlayer();
+
+    virtual bool check_rules(const Rules& rules) const override;
+    virtual std::shared_ptr<Player> copy() const override;
+
+    virtual Action play(const State& state) override;
+    virtual void reseed(int seed) override;
+
+    virtual std::string player_type() const override;
+
+    // Tree
+    std::size_t get_tree_size() const;
+    uint32_t get_root_visits() const;
+    void clear_tree();
+
+    // Observer
+    virtual std::shared_ptr<Observer> observer() override;
+    virtual void start_game(std::vector<ushort> order) override;
+    virtual void new_round(const State& state) override;
+    virtual void action_played(Action action) override;
+    virtual void end_game(const State& state, ushort winner_position) override;
+};
+
+#endif //MCTS_PLAYER_HPP
@@ -0,0 +1,248 @@
+#include "mlp_evaluator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+#include "game/action.hpp"
+
+namespace {
+
+const char MAGIC[8] = { 'C', 'R', 'M', 'M', 'L', 'P', 'E', 'V' };
+const uint32_t VERSION = 1;
+
+template<class T>
+void
+write_values(std::ofstream& file, const T* values, std::size_t count) {
+    file.write(reinterpret_cast<const char*>(values), count * sizeof(T));
+}
+
+template<class T>
+void
+read_values(std::ifstream& file, T* values, std::size_t count) {
+    if (!file.read(reinterpret_cast<char*>(values), count * sizeof(T))) {
+        throw std::runtime_error("MLP file is truncated");
+    }
+}
+
+// "outputs" of "count" rows are the biases plus the inputs times the weights.
+// Rows are done four at a time, so that each row of weights is read once for
+// them, and the loop over outputs is contiguous so that it is vectorized.
+// Planes are mostly zeros, whose rows of weights are skipped
+void
+dense(int inputs, int outputs, const float* weights, const float* biases, int count, const float* in, float* out, bool relu) {
+    for (int row = 0; row < count; row++) {
+        std::copy(biases, biases + outputs, out + std::size_t(row) * outputs);
+    }
+    int row = 0;
+    for (; row + 4 <= count; row += 4) {
+        const float* in_0 = in + std::size_t(row) * inputs;
+        const float* in_1 = in_0 + inputs;
+        const float* in_2 = in_1 + inputs;
+        const float* in_3 = in_2 + inputs;
+        float* __restrict__ out_0 = out + std::size_t(row) * outputs;
+        float* __restrict__ out_1 = out_0 + outputs;
+        float* __restrict__ out_2 = out_1 + outputs;
+        float* __restrict__ out_3 = out_2 + outputs;
+        for (int i = 0; i < inputs; i++) {
+            float x_0 = in_0[i];
+            float x_1 = in_1[i];
+            float x_2 = in_2[i];
+            float x_3 = in_3[i];
+            if (x_0 == 0 && x_1 == 0 && x_2 == 0 && x_3 == 0) {
+                continue;
+            }
+            const float* __restrict__ line = weights + std::size_t(i) * outputs;
+            for (int j = 0; j < outputs; j++) {
+                float w = line[j];
+                out_0[j] += x_0 * w;
+                out_1[j] += x_1 * w;
+                out_2[j] += x_2 * w;
+                out_3[j] += x_3 * w;
+            }
+        }
+    }
+    for (; row < count; row++) {
+        const float* in_0 = in + std::size_t(row) * inputs;
+        float* __restrict__ out_0 = out + std::size_t(row) * outputs;
+        for (int i = 0; i < inputs; i++) {
+            float x_0 = in_0[i];
+            if (x_0 == 0) {
+                continue;
+            }
+            const float* __restrict__ line = weights + std::size_t(i) * outputs;
+            for (int j = 0; j < outputs; j++) {
+                out_0[j] += x_0 * line[j];
+            }
+        }
+    }
+    if (relu) {
+        for (float* value = out; value != out + std::size_t(count) * outputs; value++) {
+            *value = std::max(*value, 0.f);
+        }
+    }
+}
+
+} // namespace
+
+MlpEvaluator::MlpEvaluator(std::shared_ptr<const Rules> rules, std::vector<int> hidden, int seed)
+  : Evaluator(rules)
+  , layers() {
+    std::vector<int> sizes = { int(encoder.size()) };
+    sizes.insert(sizes.end(), hidden.begin(), hidden.end());
+    for (std::size_t i = 0; i + 1 < sizes.size(); i++) {
+        layers.push_back(Layer{ sizes[i], sizes[i + 1], {}, {} });
+    }
+    layers.push_back(Layer{ sizes.back(), action_index_count(*rules), {}, {} });
+    layers.push_back(Layer{ sizes.back(), rules->player_count, {}, {} });
+    std::mt19937 generator(seed);
+    for (Layer& layer : layers) {
+        if (layer.inputs <= 0 || layer.outputs <= 0) {
+            throw std::invalid_argument("MLP layers should not be empty");
+        }
+        // He initialization, as layers are followed by a ReLU
+        std::normal_distribution<float> normal(0.f, std::sqrt(2.f / layer.inputs));
+        layer.weights.resize(std::size_t(layer.inputs) * layer.outputs);
+        for (float& weight : layer.weights) {
+            weight = normal(generator);
+        }
+        layer.biases.assign(layer.outputs, 0.f);
+    }
+}
+
+MlpEvaluator::MlpEvaluator(std::shared_ptr<const Rules> rules, const std::string& path)
+  : Evaluator(rules)
+  , layers() {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot open MLP file " + path);
+    }
+    char magic[sizeof(MAGIC)];
+    uint32_t version;
+    uint32_t count;
+    read_values(file, magic, sizeof(MAGIC));
+    read_values(file, &version, 1);
+    if (!std::equal(magic, magic + sizeof(MAGIC), MAGIC) || version != VERSION) {
+        throw std::runtime_error(path + " is not an MLP file of version " + std::to_string(VERSION));
+    }
+    read_values(file, &count, 1);
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t sizes[2];
+        read_values(file, sizes, 2);
+        Layer layer{ int(sizes[0]), int(sizes[1]), std::vector<float>(std::size_t(sizes[0]) * sizes[1]), std::vector<float>(sizes[1]) };
+        read_values(file, layer.weights.data(), layer.weights.size());
+        read_values(file, layer.biases.data(), layer.biases.size());
+        layers.push_back(std::move(layer));
+    }
+    // Hidden layers follow each other, and both heads read the last one
+    bool valid = layers.size() >= 2 && layers.front().inputs == int(encoder.size());
+    for (std::size_t i = 1; valid && i + 2 < layers.size(); i++) {
+        valid = layers[i].inputs == layers[i - 1].outputs;
+    }
+    if (valid) {
+        const Layer& policy = layers[layers.size() - 2];
+        const Layer& value = layers.back();
+        int last = layers.size() > 2 ? layers[layers.size() - 3].outputs : int(encoder.size());
+        valid = policy.inputs == last && value.inputs == last && policy.outputs == action_index_count(*rules) && value.outputs == rules->player_count;
+    }
+    if (!valid) {
+        throw std::invalid_argument("Layers of " + path + " do not fit the rules");
+    }
+}
+
+void
+MlpEvaluator::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    uint32_t count = layers.size();
+    write_values(file, MAGIC, sizeof(MAGIC));
+    write_values(file, &VERSION, 1);
+    write_values(file, &count, 1);
+    for (const Layer& layer : layers) {
+        uint32_t sizes[2] = { uint32_t(layer.inputs), uint32_t(layer.outputs) };
+        write_values(file, sizes, 2);
+        write_values(file, layer.weights.data(), layer.weights.size());
+        write_values(file, layer.biases.data(), layer.biases.size());
+    }
+    if (!file) {
+        throw std::runtime_error("Cannot write MLP file " + path);
+    }
+}
+
+void
+MlpEvaluator::check_layer(int layer) const {
+    if (layer < 0 || layer >= layer_count()) {
+        throw std::invalid_argument("There is no layer " + std::to_string(layer));
+    }
+}
+
+int
+MlpEvaluator::layer_count() const {
+    return layers.size();
+}
+
+int
+MlpEvaluator::layer_inputs(int layer) const {
+    check_layer(layer);
+    return layers[layer].inputs;
+}
+
+int
+MlpEvaluator::layer_outputs(int layer) const {
+    check_layer(layer);
+    return layers[layer].outputs;
+}
+
+std::vector<float>&
+MlpEvaluator::get_weights(int layer) {
+    check_layer(layer);
+    return layers[layer].weights;
+}
+
+std::vector<float>&
+MlpEvaluator::get_biases(int layer) {
+    check_layer(layer);
+    return layers[layer].biases;
+}
+
+void
+MlpEvaluator::evaluate(int count, const float* observations, float* policies, float* values) {
+    std::vector<float> hidden;
+    std::vector<float> next;
+    const float* in = observations;
+    std::size_t heads = layers.size() - 2;
+    for (std::size_t i = 0; i < heads; i++) {
+        const Layer& layer = layers[i];
+        next.resize(std::size_t(count) * layer.outputs);
+        dense(layer.inputs, layer.outputs, layer.weights.data(), layer.biases.data(), count, in, next.data(), true);
+        std::swap(hidden, next);
+        in = hidden.data();
+    }
+    const Layer& policy = layers[heads];
+    const Layer& value = layers[heads + 1];
+    dense(policy.inputs, policy.outputs, policy.weights.data(), policy.biases.data(), count, in, policies, false);
+    dense(value.inputs, value.outputs, value.weights.data(), value.biases.data(), count, in, values, false);
+    for (int row = 0; row < count; row++) {
+        float* shares = values + std::size_t(row) * value.outputs;
+        float highest = *std::max_element(shares, shares + value.outputs);
+        float total = 0;
+        for (int p = 0; p < value.outputs; p++) {
+            shares[p] = std::exp(shares[p] - highest);
+            total += shares[p];
+        }
+        for (int p = 0; p < value.outputs; p++) {
+            shares[p] /= total;
+        }
+    }
+}
+
+std::string
+MlpEvaluator::name() const {
+    std::string result = "mlp";
+    for (std::size_t i = 0; i + 2 < layers.size(); i++) {
+        result += "-" + std::to_string(layers[i].outputs);
+    }
+    return result;
+}
@@ -0,0 +1,49 @@
+#ifndef MLP_EVALUATOR_HPP
+#define MLP_EVALUATOR_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "evaluator.hpp"
+#include "rules/rules.hpp"
+
+// Reference Evaluator running on the CPU: a multilayer perceptron on the
+// StateEncoder planes, with ReLU hidden layers and two heads reading the last
+// one, the action logits and the values (softmax over players).
+// Layers are the hidden ones, then the policy head, then the value head.
+// Weights are stored input-major, "weights[i * outputs + j]" linking input i to
+// output j, so that each input adds a contiguous row to the outputs
+class MlpEvaluator : public Evaluator {
+private:
+    struct Layer {
+        int inputs;
+        int outputs;
+        std::vector<float> weights;
+        std::vector<float> biases;
+    };
+
+    std::vector<Layer> layers;
+
+    void check_layer(int layer) const;
+
+public:
+    // Layers of the given hidden sizes, with random weights drawn from "seed"
+    MlpEvaluator(std::shared_ptr<const Rules> rules, std::vector<int> hidden = { 128 }, int seed = 0);
+    // Layers saved by "save", which should fit the rules
+    MlpEvaluator(std::shared_ptr<const Rules> rules, const std::string& path);
+
+    void save(const std::string& path) const;
+
+    int layer_count() const;
+    int layer_inputs(int layer) const;
+    int layer_outputs(int layer) const;
+    std::vector<float>& get_weights(int layer);
+    std::vector<float>& get_biases(int layer);
+
+    virtual void evaluate(int count, const float* observations, float* policies, float* values) override;
+
+    virtual std::string name() const override;
+};
+
+#endif //MLP_EVALUATOR_HPP
@@ -1,14 +1,20 @@
 #include "monte_carlo_player.hpp"
 
+#include "first_legal_player.hpp"
 #include "game/game.hpp"
+#include "rollout.hpp"
+#include <atomic>
+#include <numeric>
+#include <thread>
 
-MonteCarloPlayer::MonteCarloPlayer(bool until_round, int rollouts)
-  : MonteCarloPlayer(std::make_shared<RandomPlayer>(), until_round, rollouts) {}
+MonteCarloPlayer::MonteCarloPlayer(bool until_round, int rollouts, int threads)
+  : MonteCarloPlayer(std::make_shared<RandomPlayer>(), until_round, rollouts, threads) {}
 
-MonteCarloPlayer::MonteCarloPlayer(std::shared_ptr<Player> player, bool until_round, int rollouts)
+MonteCarloPlayer::MonteCarloPlayer(std::shared_ptr<Player> player, bool until_round, int rollouts, int threads)
   : sampling_player(std::move(player))
   , rollouts(rollouts)
-  , until_round(until_round) {}
+  , until_round(until_round)
+  , threads(threads) {}
 
 MonteCarloPlayer::MonteCarloPlayer(const MonteCarloPlayer& other)
   : sampling_player(other.sampling_player->copy())
@@ -16,24 +22,36 @@ MonteCarloPlayer::MonteCarloPlayer(const MonteCarloPlayer& other)
   , rollouts(other.rollouts)
   , until_round(other.until_round)
   , smart(other.smart)
-  , c(other.c) {}
+  , c(other.c)
+  , threads(other.threads)
+  , parallelism(other.parallelism)
+  , time_budget(other.time_budget)
+  , early_stop(other.early_stop) {}
 
 // Private
 
+// Score of a rollout from the state reached by arm "index". The heuristic
+// value of this state is returned when the rollout stops at the end of a round.
+// "simulator" is either a Game or a Rollout
+template<class Simulator>
 float
-MonteCarloPlayer::state_score(Game& game, const State& state, int player) {
-    game.override_state(state);
+MonteCarloPlayer::state_score(Simulator& simulator, const Arms& arms, int index) {
+    if (arms.compact) {
+        simulator.override_state(arms.next_states[index]);
+    } else {
+        simulator.override_state(arms.next_full_states[index]);
+    }
     if (until_round) {
-        game.roll_round();
-        game.end_round();
-        game.score_final();
-        if (!game.get_state().is_game_finished()) {
-            return heuristic.eval(state, player);
+        simulator.roll_round();
+        simulator.end_round();
+        simulator.score_final();
+        if (!simulator.get_state().is_game_finished()) {
+            return arms.round_values[index];
         }
     } else {
-        game.roll_end_game();
+        simulator.roll_end_game();
     }
-    return (game.get_state().winning_player() == player) ? 1.f : 0.f;
+    return (simulator.get_state().winning_player() == arms.position) ? 1.f : 0.f;
 }
 
 // Selects action "a" of index "i" with highest
@@ -44,16 +62,19 @@ MonteCarloPlayer::state_score(Game& game, const State& state, int player) {
 //    c runtime constant, default is sqrt(2)
 //    n total number of samples (n = sum_i(n_i))
 //    n_i number of times action "a" was sampled
+template<class Sums, class Counts>
 int
-MonteCarloPlayer::select_ucb(int n, const std::vector<float>& score_sums, const std::vector<int>& count) const {
+MonteCarloPlayer::select_ucb(int n, const Sums& score_sums, const Counts& count) const {
     float ln_n = log(n);
     float highest_uct = -std::numeric_limits<float>::infinity();
     int highest_index = 0;
     for (std::size_t i = 0; i < score_sums.size(); i++) {
-        if (count[i] == 0) {
+        int count_i = count[i];
+        if (count_i == 0) {
             return i;
         }
-        float uct_i = (score_sums[i] / count[i]) + c * sqrt(ln_n / count[i]);
+        float score_sum_i = score_sums[i];
+        float uct_i = (score_sum_i / count_i) + c * sqrt(ln_n / count_i);
         if (uct_i > highest_uct) {
             highest_uct = uct_i;
             highest_index = i;
@@ -62,6 +83,174 @@ MonteCarloPlayer::select_ucb(int n, const std::vector<float>& score_sums, const
     return highest_index;
 }
 
+// Whether the best action is known with enough confidence, i.e. the lower bound
+// of its average score is above the upper bounds of all other actions.
+// Scores being in [0, 1], Hoeffding's inequality gives bounds X_i +/- r_i with
+// r_i = sqrt( ln(2 / delta) / (2 * n_i) ), each holding with probability 1 - delta.
+// UCB bounds can not be used here, since sampling with UCB keeps them all close
+template<class Sums, class Counts>
+bool
+MonteCarloPlayer::is_separated(const Sums& score_sums, const Counts& count) const {
+    const float half_log = 0.5f * log(2.f / EARLY_STOP_DELTA);
+    std::size_t size = score_sums.size();
+    std::vector<float> means(size);
+    std::vector<float> radii(size);
+    std::size_t best = 0;
+    for (std::size_t i = 0; i < size; i++) {
+        int count_i = count[i];
+        if (count_i == 0) {
+            return false;
+        }
+        float score_sum_i = score_sums[i];
+        means[i] = score_sum_i / count_i;
+        radii[i] = sqrt(half_log / count_i);
+        if (means[i] > means[best]) {
+            best = i;
+        }
+    }
+    float lower_bound = means[best] - radii[best];
+    for (std::size_t i = 0; i < size; i++) {
+        if (i != best && means[i] + radii[i] >= lower_bound) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whether rollout "k" should not be run
+template<class Sums, class Counts>
+bool
+MonteCarloPlayer::should_stop(const Arms& arms, int k, int max_rollouts, const Sums& score_sums, const Counts& count) const {
+    if (arms.timed ? std::chrono::steady_clock::now() >= arms.deadline : k >= max_rollouts) {
+        return true;
+    }
+    return early_stop && k % EARLY_STOP_PERIOD == 0 && is_separated(score_sums, count);
+}
+
+// Calls "body" with the simulator running rollouts where all players act like "player":
+// a Rollout with the matching policy for random and first legal players,
+// otherwise a Game with "player" in all seats
+template<class Body>
+void
+MonteCarloPlayer::simulate(const State& state, std::shared_ptr<Player> player, int seed, Body body) const {
+    std::shared_ptr<RandomPlayer> random_player = std::dynamic_pointer_cast<RandomPlayer>(player);
+    if (random_player != nullptr) {
+        Rollout<RandomPolicy> rollout(state.get_rules(), RandomPolicy{ random_player->smart }, seed);
+        body(rollout);
+        return;
+    }
+    if (std::dynamic_pointer_cast<FirstLegalPlayer>(player) != nullptr) {
+        Rollout<FirstLegalPolicy> rollout(state.get_rules(), FirstLegalPolicy{}, seed);
+        body(rollout);
+        return;
+    }
+    player->reseed(seed);
+    Game game = Game(state.get_rules(), seed);
+    game.enable_legal_masks();
+    for (int p = 0; p < state.get_rules()->player_count; p++) {
+        game.add_player(player);
+    }
+    body(game);
+}
+
+int
+MonteCarloPlayer::thread_count() const {
+    if (threads > 0) {
+        return threads;
+    }
+    return std::max(1U, std::thread::hardware_concurrency());
+}
+
+template<class Simulator>
+void
+MonteCarloPlayer::search(Simulator& simulator, const Arms& arms, int _rollouts, std::vector<float>& score_sums, std::vector<int>& count) {
+    for (int k = 0; !should_stop(arms, k, _rollouts, score_sums, count); k++) {
+        int index = select_ucb(k, score_sums, count);
+        float score = state_score(simulator, arms, index);
+        count[index]++;
+        score_sums[index] += score;
+    }
+}
+
+// Each thread runs its share of the rollouts on its own statistics,
+// which are summed at the end. Seeds are all drawn before starting,
+// so unless timed, the result only depends on the seed of the player
+void
+MonteCarloPlayer::search_root(const State& state, const Arms& arms, std::vector<float>& score_sums, std::vector<int>& count) {
+    int thread_total = thread_count();
+    std::vector<std::vector<float>> thread_score_sums(thread_total, score_sums);
+    std::vector<std::vector<int>> thread_counts(thread_total, count);
+    std::vector<int> seeds(thread_total);
+    for (int t = 0; t < thread_total; t++) {
+        seeds[t] = randomness();
+    }
+    auto run = [&](int t) {
+        int thread_rollouts = rollouts / thread_total + (t < rollouts % thread_total ? 1 : 0);
+        simulate(state, sampling_player->copy(), seeds[t], [&](auto& simulator) {
+            search(simulator, arms, thread_rollouts, thread_score_sums[t], thread_counts[t]);
+        });
+    };
+    std::vector<std::thread> workers;
+    for (int t = 1; t < thread_total; t++) {
+        workers.push_back(std::thread(run, t));
+    }
+    run(0);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (int t = 0; t < thread_total; t++) {
+        for (std::size_t i = 0; i < score_sums.size(); i++) {
+            score_sums[i] += thread_score_sums[t][i];
+            count[i] += thread_counts[t][i];
+        }
+    }
+}
+
+inline void
+atomic_add(std::atomic<float>& value, float delta) {
+    float current = value.load();
+    while (!value.compare_exchange_weak(current, current + delta)) {
+    }
+}
+
+// Threads select actions with the same statistics. An action is counted
+// as soon as it is selected, with a score of 0 until its rollout ends,
+// so that other threads explore other actions meanwhile (virtual loss).
+// The order of updates depends on scheduling, so results are not reproducible
+void
+MonteCarloPlayer::search_shared(const State& state, const Arms& arms, std::vector<float>& score_sums, std::vector<int>& count) {
+    int thread_total = thread_count();
+    std::vector<std::atomic<float>> shared_score_sums(score_sums.size());
+    std::vector<std::atomic<int>> shared_count(count.size());
+    std::atomic<int> started(0);
+    std::vector<int> seeds(thread_total);
+    for (int t = 0; t < thread_total; t++) {
+        seeds[t] = randomness();
+    }
+    auto run = [&](int t) {
+        simulate(state, sampling_player->copy(), seeds[t], [&](auto& simulator) {
+            for (int k = started++; !should_stop(arms, k, rollouts, shared_score_sums, shared_count); k = started++) {
+                int index = select_ucb(k, shared_score_sums, shared_count);
+                shared_count[index]++;
+                float score = state_score(simulator, arms, index);
+                atomic_add(shared_score_sums[index], score);
+            }
+        });
+    };
+    std::vector<std::thread> workers;
+    for (int t = 1; t < thread_total; t++) {
+        workers.push_back(std::thread(run, t));
+    }
+    run(0);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (std::size_t i = 0; i < score_sums.size(); i++) {
+        score_sums[i] = shared_score_sums[i];
+        count[i] = shared_count[i];
+    }
+}
+
 Action
 MonteCarloPlayer::best_action(std::vector<Action> actions, std::vector<float> score_sums, std::vector<int> count) const {
     float best_score = -std::numeric_limits<float>::infinity();
@@ -93,6 +282,7 @@ MonteCarloPlayer::play(const State& state) {
     } else {
         legal_actions = Game::all_legal(state);
     }
+    rollouts_done = 0;
     if (legal_actions.size() == 1) {
         return legal_actions[0];
     }
@@ -100,28 +290,58 @@ MonteCarloPlayer::play(const State& state) {
     std::vector<float> score_sums(legal_actions.size(), 0);
     std::vector<int> count(legal_actions.size(), 0);
 
-    Game game = Game(state.get_rules());
-    for (int p = 0; p < state.get_rules()->player_count; p++) {
-        game.add_player(sampling_player);
+    // State reached by each action, restored into the game at each rollout
+    Arms arms;
+    arms.position = position;
+    arms.timed = time_budget > 0;
+    arms.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(time_budget);
+    arms.compact = CompactState::supports(*state.get_rules());
+    arms.next_states.reserve(arms.compact ? legal_actions.size() : 0);
+    arms.next_full_states.reserve(arms.compact ? 0 : legal_actions.size());
+    arms.round_values.reserve(legal_actions.size());
+    for (Action action : legal_actions) {
+        State next_state(state);
+        Game::apply_unchecked(action, next_state);
+        if (arms.compact) {
+            arms.next_states.push_back(CompactState(next_state));
+        } else {
+            arms.next_full_states.push_back(next_state);
+        }
+        arms.round_values.push_back(until_round ? heuristic.eval(next_state, position) : 0.f);
     }
 
-    for (int k = 0; k < rollouts; k++) {
-        int index = select_ucb(k, score_sums, count);
-        State next_state(state);
-        Game::apply(legal_actions[index], next_state);
-        float score = state_score(game, next_state, position);
-        count[index]++;
-        score_sums[index] += score;
+    if (thread_count() == 1) {
+        simulate(state, sampling_player, randomness(), [&](auto& simulator) {
+            search(simulator, arms, rollouts, score_sums, count);
+        });
+    } else if (parallelism == SHARED) {
+        search_shared(state, arms, score_sums, count);
+    } else {
+        search_root(state, arms, score_sums, count);
     }
+    rollouts_done = std::accumulate(count.begin(), count.end(), 0);
 
     return best_action(legal_actions, score_sums, count);
 }
 
+void
+MonteCarloPlayer::reseed(int seed) {
+    randomness.seed(seed);
+}
+
 
 std::string
 MonteCarloPlayer::player_type() const {
     return "mc-" +
-           std::to_string(rollouts) +
+           (time_budget > 0 ? std::to_string(time_budget) + "ms" : std::to_string(rollouts)) +
            (smart ? "" : "-naive") +
+           (early_stop ? "-es" : "") +
+           (threads == 1 ? "" : "-t" + std::to_string(threads) + (parallelism == SHARED ? "s" : "")) +
            "-" + (until_round ? heuristic.str() : "full");
+}
+
+
+int
+MonteCarloPlayer::get_rollouts_done() const {
+    return rollouts_done;
 }
\ No newline at end of file
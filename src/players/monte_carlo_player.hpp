@@ -6,17 +6,62 @@
 #include "global.hpp"
 #include "random_player.hpp"
 #include "round_heuristic.hpp"
+#include "state/compact_state.hpp"
 #include "state/state.hpp"
 #include "utils/random.hpp"
+#include <chrono>
 #include <cmath>
 
 class MonteCarloPlayer : public Player {
+public:
+    // How rollouts are shared between threads:
+    //   ROOT: each thread searches with its own statistics, merged at the end
+    //   SHARED: threads update the same statistics, with a virtual loss
+    enum Parallelism {
+        ROOT,
+        SHARED,
+    };
+
 private:
+    // Possible actions of the searched state, and what is needed to roll them out
+    struct Arms {
+        int position;
+        // States reached by each action, in "next_full_states" if the rules are too big for a CompactState
+        bool compact;
+        std::vector<CompactState> next_states;
+        std::vector<State> next_full_states;
+        std::vector<float> round_values;
+        // If timed, rollouts are run until the deadline instead of a fixed number
+        bool timed;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    // Early stop is checked every EARLY_STOP_PERIOD rollouts, with confidence 1 - EARLY_STOP_DELTA
+    constexpr static int EARLY_STOP_PERIOD = 16;
+    constexpr static float EARLY_STOP_DELTA = 0.01f;
+
     std::shared_ptr<Player> sampling_player;
     rng randomness = rng(random_seed());
 
-    float state_score(Game& game, const State& state, int player);
-    int select_ucb(int n, const std::vector<float>& score_sums, const std::vector<int>& count) const;
+    int rollouts_done = 0;
+
+    template<class Simulator>
+    float state_score(Simulator& simulator, const Arms& arms, int index);
+    template<class Sums, class Counts>
+    int select_ucb(int n, const Sums& score_sums, const Counts& count) const;
+    template<class Sums, class Counts>
+    bool is_separated(const Sums& score_sums, const Counts& count) const;
+    template<class Sums, class Counts>
+    bool should_stop(const Arms& arms, int k, int max_rollouts, const Sums& score_sums, const Counts& count) const;
+
+    template<class Body>
+    void simulate(const State& state, std::shared_ptr<Player> player, int seed, Body body) const;
+    int thread_count() const;
+
+    template<class Simulator>
+    void search(Simulator& simulator, const Arms& arms, int rollouts, std::vector<float>& score_sums, std::vector<int>& count);
+    void search_root(const State& state, const Arms& arms, std::vector<float>& score_sums, std::vector<int>& count);
+    void search_shared(const State& state, const Arms& arms, std::vector<float>& score_sums, std::vector<int>& count);
 
 protected:
     Action best_action(std::vector<Action> actions, std::vector<float> score_sums, std::vector<int> count) const;
@@ -29,16 +74,28 @@ public:
     bool until_round;
     bool smart = true;
     float c = DEFAULT_C;
+    // Number of threads used for rollouts, all available cores if 0
+    int threads;
+    Parallelism parallelism = ROOT;
+    // If positive, rollouts are run for this many milliseconds, and "rollouts" is ignored
+    int time_budget = 0;
+    // Stops once the lower Hoeffding bound of the best action is above
+    // the upper Hoeffding bounds of all others, see is_separated
+    bool early_stop = false;
 
-    MonteCarloPlayer(bool until_round = true, int rollouts = DEFAULT_ROLLOUTS);
-    MonteCarloPlayer(std::shared_ptr<Player> player, bool until_round = true, int rollouts = DEFAULT_ROLLOUTS);
+    MonteCarloPlayer(bool until_round = true, int rollouts = DEFAULT_ROLLOUTS, int threads = 1);
+    MonteCarloPlayer(std::shared_ptr<Player> player, bool until_round = true, int rollouts = DEFAULT_ROLLOUTS, int threads = 1);
     MonteCarloPlayer(const MonteCarloPlayer& other);
 
     virtual std::shared_ptr<Player> copy() const override;
 
     virtual Action play(const State& state) override;
+    virtual void reseed(int seed) override;
 
     virtual std::string player_type() const override;
+
+    // Number of rollouts run during the last call to play
+    int get_rollouts_done() const;
 };
 
 #endif //MONTE_CARLO_PLAYER_HPP
\ No newline at end of file
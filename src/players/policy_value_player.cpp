@@ -0,0 +1,313 @@
+#include "policy_value_player.hpp"
+
+#include <cmath>
+#include <exception>
+#include <thread>
+
+#include "game/game.hpp"
+
+PolicyValuePlayer::PolicyValuePlayer(std::shared_ptr<EvaluationQueue> queue, int rollouts, int threads)
+  : queue(queue)
+  , rollouts(rollouts)
+  , threads(threads) {}
+
+// Batches hold one leaf per search thread
+PolicyValuePlayer::PolicyValuePlayer(std::shared_ptr<Evaluator> evaluator, int rollouts, int threads)
+  : PolicyValuePlayer(std::make_shared<EvaluationQueue>(evaluator, std::max(1, threads)), rollouts, threads) {}
+
+PolicyValuePlayer::PolicyValuePlayer(const PolicyValuePlayer& other)
+  : Player()
+  , queue(other.queue)
+  , heuristic(other.heuristic)
+  , rollouts(other.rollouts)
+  , threads(other.threads)
+  , smart(other.smart)
+  , c(other.c)
+  , max_nodes(other.max_nodes) {}
+
+// Private
+
+// Node of the state reached after an action and Game::next_player. If the round
+// is over, it is ended the same way as Game::end_round, and valued
+uint32_t
+PolicyValuePlayer::add_node(const CompactState& state) {
+    Node node;
+    node.state = state;
+    node.type = DECISION;
+    node.expanded = false;
+    node.pending = false;
+    node.edge_count = 0;
+    node.first_edge = NONE;
+    node.visits = 0;
+    node.value_sums = {};
+    node.value = {};
+    if (state.is_round_finished()) {
+        State after = state.to_state(rules);
+        Game::score_panels(after);
+        Game::apply_first_token(after);
+        if (after.is_game_finished()) {
+            Game::score_final(after);
+            node.type = TERMINAL;
+            node.value[after.winning_player()] = 1.f;
+        } else {
+            node.type = ROUND_END;
+            for (int p = 0; p < rules->player_count; p++) {
+                node.value[p] = heuristic.eval(after, p);
+            }
+        }
+        node.state = CompactState(after);
+    }
+    nodes.push_back(node);
+    return nodes.size() - 1;
+}
+
+// Edge with the highest PUCT for the player acting at node "index". Edges not
+// visited yet are valued as their parent
+uint32_t
+PolicyValuePlayer::select_puct(uint32_t index) const {
+    const Node& node = nodes[index];
+    ushort player = node.state.get_current_player();
+    float parent_value = node.value_sums[player] / node.visits;
+    float sqrt_n = std::sqrt(float(node.visits));
+    float highest_puct = -std::numeric_limits<float>::infinity();
+    uint32_t highest_index = node.first_edge;
+    for (uint32_t edge = node.first_edge; edge < node.first_edge + node.edge_count; edge++) {
+        uint32_t child = edges[edge].child;
+        uint32_t visits = child == NONE ? 0 : nodes[child].visits;
+        float value = visits == 0 ? parent_value : nodes[child].value_sums[player] / visits;
+        float puct = value + c * edges[edge].prior * sqrt_n / (1 + visits);
+        if (puct > highest_puct) {
+            highest_puct = puct;
+            highest_index = edge;
+        }
+    }
+    return highest_index;
+}
+
+// Adds the edges of the legal actions of node "index", with the
+// softmax of their logits in "policy" as priors
+void
+PolicyValuePlayer::expand(uint32_t index, const std::vector<float>& policy) {
+    Node& node = nodes[index];
+    ActionList actions;
+    if (smart) {
+        Game::all_smart_legal(node.state, actions);
+    } else {
+        Game::all_legal(node.state, actions);
+    }
+    float highest = -std::numeric_limits<float>::infinity();
+    for (Action action : actions) {
+        highest = std::max(highest, policy[action_index(action, *rules)]);
+    }
+    float total = 0;
+    node.first_edge = edges.size();
+    node.edge_count = actions.size();
+    for (Action action : actions) {
+        float prior = std::exp(policy[action_index(action, *rules)] - highest);
+        total += prior;
+        edges.push_back(Edge{ action, prior, NONE });
+    }
+    for (uint32_t edge = node.first_edge; edge < edges.size(); edge++) {
+        edges[edge].prior /= total;
+    }
+    node.expanded = true;
+    node.pending = false;
+}
+
+// Visits were already counted during the descent, as virtual losses
+void
+PolicyValuePlayer::backup(const std::vector<uint32_t>& path, const std::array<float, MAX_PLAYER_COUNT>& value) {
+    for (uint32_t i : path) {
+        for (ushort p = 0; p < MAX_PLAYER_COUNT; p++) {
+            nodes[i].value_sums[p] += value[p];
+        }
+    }
+}
+
+// Runs one simulation. Only the evaluation runs without the lock of the tree
+PolicyValuePlayer::Simulation
+PolicyValuePlayer::simulate(std::vector<uint32_t>& path, State& state, std::vector<float>& observation, std::vector<float>& policy) {
+    std::unique_lock<std::mutex> lock(mutex);
+    path.clear();
+    uint32_t index = root;
+    while (true) {
+        nodes[index].visits++;
+        path.push_back(index);
+        const Node& node = nodes[index];
+        if (node.type != DECISION) {
+            backup(path, node.value);
+            return DONE;
+        }
+        if (!node.expanded) {
+            break;
+        }
+        uint32_t edge = select_puct(index);
+        if (edges[edge].child == NONE) {
+            if (nodes.size() >= max_nodes) {
+                for (uint32_t i : path) {
+                    nodes[i].visits--;
+                }
+                return FULL;
+            }
+            CompactState next = node.state;
+            Game::apply_unchecked(edges[edge].action, next);
+            next.next_player();
+            uint32_t child = add_node(next);
+            edges[edge].child = child;
+        }
+        index = edges[edge].child;
+    }
+    // Another thread is evaluating this leaf: its batch is evaluated without
+    // waiting for more states, and this simulation starts again once it is expanded
+    if (nodes[index].pending) {
+        for (uint32_t i : path) {
+            nodes[i].visits--;
+        }
+        lock.unlock();
+        queue->flush();
+        lock.lock();
+        expanded.wait(lock, [this, index]() { return !nodes[index].pending; });
+        return COLLIDED;
+    }
+    nodes[index].pending = true;
+    CompactState leaf_state = nodes[index].state;
+    lock.unlock();
+
+    std::array<float, MAX_PLAYER_COUNT> relative{};
+    try {
+        leaf_state.restore(state);
+        queue->get_evaluator()->get_encoder().encode(state, observation.data());
+        queue->evaluate(observation.data(), policy.data(), relative.data());
+    } catch (...) {
+        lock.lock();
+        nodes[index].pending = false;
+        expanded.notify_all();
+        throw;
+    }
+    // Values are ordered from the player to play
+    ushort p = rules->player_count;
+    std::array<float, MAX_PLAYER_COUNT> value{};
+    for (ushort k = 0; k < p; k++) {
+        value[(leaf_state.get_current_player() + k) % p] = relative[k];
+    }
+    lock.lock();
+    expand(index, policy);
+    backup(path, value);
+    expanded.notify_all();
+    return DONE;
+}
+
+// The root is expanded before the other threads start, so that they do not
+// all wait for its evaluation, and this first simulation is not a rollout
+void
+PolicyValuePlayer::search() {
+    std::atomic<int> started(0);
+    std::atomic<bool> stopped(false);
+    int simulations = 1;
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto body = [&]() {
+        std::vector<uint32_t> path;
+        State state(rules);
+        std::vector<float> observation(queue->get_evaluator()->get_encoder().size());
+        std::vector<float> policy(action_index_count(*rules));
+        try {
+            while (!stopped && started++ < simulations) {
+                Simulation simulation = simulate(path, state, observation, policy);
+                if (simulation == COLLIDED) {
+                    started--;
+                } else if (simulation == FULL) {
+                    stopped = true;
+                }
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            error = std::current_exception();
+            stopped = true;
+        }
+    };
+    body();
+    // Counts the root, but not the check that stopped its thread
+    started = 1;
+    simulations += rollouts;
+    int thread_count = queue->get_evaluator()->allows_threads() ? threads : 1;
+    std::vector<std::thread> workers;
+    for (int i = 1; i < thread_count; i++) {
+        workers.push_back(std::thread(body));
+    }
+    body();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+
+// Public
+
+bool
+PolicyValuePlayer::check_rules(const Rules& rules) const {
+    return CompactState::supports(rules) && *queue->get_evaluator()->get_rules() == rules;
+}
+
+std::shared_ptr<Player>
+PolicyValuePlayer::copy() const {
+    return std::make_shared<PolicyValuePlayer>(*this);
+}
+
+Action
+PolicyValuePlayer::play(const State& state) {
+    rules = state.get_rules();
+    nodes.clear();
+    edges.clear();
+    nodes.reserve(std::min<uint32_t>(max_nodes, rollouts + 1));
+    root = add_node(CompactState(state));
+    if (Game::count_legal(nodes[root].state) == 1) {
+        return Game::nth_legal(nodes[root].state, 0);
+    }
+    search();
+    if (!nodes[root].expanded) {
+        return smart ? Game::nth_smart_legal(nodes[root].state, 0) : Game::nth_legal(nodes[root].state, 0);
+    }
+    // Most visited action, then the one with the highest prior
+    const Node& node = nodes[root];
+    uint32_t best_edge = node.first_edge;
+    uint32_t best_visits = 0;
+    for (uint32_t edge = node.first_edge; edge < node.first_edge + node.edge_count; edge++) {
+        uint32_t child = edges[edge].child;
+        uint32_t visits = child == NONE ? 0 : nodes[child].visits;
+        if (visits > best_visits || (visits == best_visits && edges[edge].prior > edges[best_edge].prior)) {
+            best_visits = visits;
+            best_edge = edge;
+        }
+    }
+    return edges[best_edge].action;
+}
+
+
+std::string
+PolicyValuePlayer::player_type() const {
+    return "pv-" +
+           std::to_string(rollouts) +
+           "-" + queue->get_evaluator()->name() +
+           (smart ? "" : "-naive") +
+           (threads > 1 ? "-t" + std::to_string(threads) : "") +
+           "-" + heuristic.str();
+}
+
+const std::shared_ptr<EvaluationQueue>&
+PolicyValuePlayer::get_queue() const {
+    return queue;
+}
+
+std::size_t
+PolicyValuePlayer::get_tree_size() const {
+    return nodes.size();
+}
+
+uint32_t
+PolicyValuePlayer::get_root_visits() const {
+    return root == NONE ? 0 : nodes[root].visits;
+}
@@ -0,0 +1,114 @@
+#ifndef POLICY_VALUE_PLAYER_HPP
+#define POLICY_VALUE_PLAYER_HPP
+
+#include "evaluator.hpp"
+#include "game/action.hpp"
+#include "game/player.hpp"
+#include "global.hpp"
+#include "round_heuristic.hpp"
+#include "state/compact_state.hpp"
+#include "state/state.hpp"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Search player guided by an Evaluator, in the style of AlphaZero: nodes are
+// expanded with the priors of the evaluator, backed up with its values, and
+// children are selected with PUCT. The search stays in the current round, the
+// states after its end being valued with the RoundHeuristic, as MctsPlayer does.
+// Several threads search the same tree, a virtual loss (a visit without value)
+// steering them to different leaves, whose evaluations are batched by an
+// EvaluationQueue. Copies of the player share this queue, so that players of
+// games running in parallel also share their batches
+class PolicyValuePlayer : public Player {
+public:
+    enum NodeType {
+        // Player to act, with edges once evaluated
+        DECISION,
+        // End of the round or of the game, with a fixed value
+        ROUND_END,
+        TERMINAL,
+    };
+
+    // Nodes and edges are stored in pools, and refer to each other by index
+    struct Node {
+        CompactState state;
+        NodeType type;
+        bool expanded;
+        bool pending;
+        ushort edge_count;
+        uint32_t first_edge;
+        // Visits include the ones still being evaluated, whose values are not summed yet
+        uint32_t visits;
+        std::array<float, MAX_PLAYER_COUNT> value_sums;
+        // Value of ROUND_END and TERMINAL nodes
+        std::array<float, MAX_PLAYER_COUNT> value;
+    };
+
+    struct Edge {
+        Action action;
+        float prior;
+        uint32_t child;
+    };
+
+    constexpr static uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+private:
+    enum Simulation {
+        DONE,
+        // Reached a leaf another thread is evaluating, and waited for it
+        COLLIDED,
+        // The pool of nodes is full
+        FULL,
+    };
+
+    std::shared_ptr<EvaluationQueue> queue;
+    std::shared_ptr<const Rules> rules;
+    std::vector<Node> nodes;
+    std::vector<Edge> edges;
+    uint32_t root = NONE;
+    std::mutex mutex;
+    std::condition_variable expanded;
+
+    uint32_t add_node(const CompactState& state);
+    uint32_t select_puct(uint32_t index) const;
+    Simulation simulate(std::vector<uint32_t>& path, State& state, std::vector<float>& observation, std::vector<float>& policy);
+    void expand(uint32_t index, const std::vector<float>& policy);
+    void backup(const std::vector<uint32_t>& path, const std::array<float, MAX_PLAYER_COUNT>& value);
+    void search();
+
+public:
+    constexpr static int DEFAULT_ROLLOUTS = 200;
+    constexpr static float DEFAULT_C = 1.5f;
+    RoundHeuristic heuristic{};
+    // Simulations after the evaluation of the root
+    int rollouts;
+    // Searches use a single thread if the evaluator does not allow more, see Evaluator::allows_threads
+    int threads;
+    bool smart = true;
+    float c = DEFAULT_C;
+    // The search stops early once the pool holds this many nodes
+    uint32_t max_nodes = 100000;
+
+    PolicyValuePlayer(std::shared_ptr<EvaluationQueue> queue, int rollouts = DEFAULT_ROLLOUTS, int threads = 1);
+    PolicyValuePlayer(std::shared_ptr<Evaluator> evaluator, int rollouts = DEFAULT_ROLLOUTS, int threads = 1);
+    PolicyValuePlayer(const PolicyValuePlayer& other);
+
+    virtual bool check_rules(const Rules& rules) const override;
+    virtual std::shared_ptr<Player> copy() const override;
+
+    virtual Action play(const State& state) override;
+
+    virtual std::string player_type() const override;
+
+    const std::shared_ptr<EvaluationQueue>& get_queue() const;
+    std::size_t get_tree_size() const;
+    uint32_t get_root_visits() const;
+};
+
+#endif //POLICY_VALUE_PLAYER_HPP
@@ -1,8 +1,18 @@
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "evaluator.hpp"
 #include "first_legal_player.hpp"
+#include "game/action.hpp"
+#include "mcts_player.hpp"
+#include "mlp_evaluator.hpp"
 #include "monte_carlo_player.hpp"
+#include "policy_value_player.hpp"
 #include "random_player.hpp"
 #include "round_heuristic.hpp"
 #include "terminal_player.hpp"
@@ -10,6 +20,54 @@
 namespace py = pybind11;
 using namespace py::literals;
 
+// Evaluators implemented in Python override "evaluate", which takes an array of
+// observations and returns arrays of policies and values, as the one of C++ evaluators
+class PyEvaluator : public Evaluator {
+public:
+    using Evaluator::Evaluator;
+
+    py::tuple evaluate_arrays(py::array_t<float> observations) {
+        PYBIND11_OVERLOAD_PURE_NAME(
+            py::tuple,
+            Evaluator,
+            "evaluate",
+            evaluate_arrays,
+            observations);
+    }
+
+    void evaluate(int count, const float* observations, float* policies, float* values) override {
+        py::gil_scoped_acquire acquire;
+        py::ssize_t size = encoder.size();
+        py::ssize_t actions = action_index_count(*rules);
+        py::array_t<float> in({ py::ssize_t(count), size }, observations);
+        py::tuple out = evaluate_arrays(in);
+        if (out.size() != 2) {
+            throw std::invalid_argument("Evaluator.evaluate should return policies and values");
+        }
+        py::object first = out[0];
+        py::object second = out[1];
+        auto out_policies = py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(first);
+        auto out_values = py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(second);
+        if (!out_policies || !out_values || out_policies.size() != count * actions || out_values.size() != count * rules->player_count) {
+            throw std::invalid_argument("Evaluator.evaluate should return " + std::to_string(actions) + " logits and " + std::to_string(rules->player_count) + " values per state");
+        }
+        std::copy(out_policies.data(), out_policies.data() + out_policies.size(), policies);
+        std::copy(out_values.data(), out_values.data() + out_values.size(), values);
+    }
+
+    // Other threads would wait for the GIL held by the caller, as in Game.roll_game
+    bool allows_threads() const override {
+        return !PyGILState_Check();
+    }
+
+    std::string name() const override {
+        PYBIND11_OVERLOAD(
+            std::string,
+            Evaluator,
+            name);
+    }
+};
+
 void
 py_bind_players(py::module& root) {
     py::module m = root.def_submodule("players");
@@ -34,22 +92,158 @@ py_bind_players(py::module& root) {
         .value("GREY", TerminalPlayer::ColoredType::GREY)
         .value("FULL", TerminalPlayer::ColoredType::FULL);
 
-    py::class_<MonteCarloPlayer, std::shared_ptr<MonteCarloPlayer>, Player>(m, "MonteCarloPlayer")
-        .def(py::init<bool, int>(),
+    py::class_<MonteCarloPlayer> monte_carlo_player =
+        py::class_<MonteCarloPlayer, std::shared_ptr<MonteCarloPlayer>, Player>(m, "MonteCarloPlayer");
+
+    py::enum_<MonteCarloPlayer::Parallelism>(monte_carlo_player, "Parallelism")
+        .value("ROOT", MonteCarloPlayer::Parallelism::ROOT)
+        .value("SHARED", MonteCarloPlayer::Parallelism::SHARED);
+
+    monte_carlo_player
+        .def(py::init([](bool until_round, int rollouts, int threads, int time_budget, bool early_stop) {
+            std::shared_ptr<MonteCarloPlayer> player = std::make_shared<MonteCarloPlayer>(until_round, rollouts, threads);
+            player->time_budget = time_budget;
+            player->early_stop = early_stop;
+            return player;
+        }),
             "until_round"_a = true,
-            "rollouts"_a = MonteCarloPlayer::DEFAULT_ROLLOUTS)
-        .def(py::init<std::shared_ptr<Player>, bool, int>(),
+            "rollouts"_a = MonteCarloPlayer::DEFAULT_ROLLOUTS,
+            "threads"_a = 1,
+            "time_budget"_a = 0,
+            "early_stop"_a = false)
+        .def(py::init([](std::shared_ptr<Player> sampling_player, bool until_round, int rollouts, int threads, int time_budget, bool early_stop) {
+            std::shared_ptr<MonteCarloPlayer> player = std::make_shared<MonteCarloPlayer>(sampling_player, until_round, rollouts, threads);
+            player->time_budget = time_budget;
+            player->early_stop = early_stop;
+            return player;
+        }),
             "player"_a,
             "until_round"_a = true,
-            "rollouts"_a = MonteCarloPlayer::DEFAULT_ROLLOUTS)
+            "rollouts"_a = MonteCarloPlayer::DEFAULT_ROLLOUTS,
+            "threads"_a = 1,
+            "time_budget"_a = 0,
+            "early_stop"_a = false)
         .def_readwrite("heuristic", &MonteCarloPlayer::heuristic)
         .def_readwrite("rollouts", &MonteCarloPlayer::rollouts)
         .def_readwrite("until_round", &MonteCarloPlayer::until_round)
         .def_readwrite("smart", &MonteCarloPlayer::smart)
         .def_readwrite("c", &MonteCarloPlayer::c)
+        .def_readwrite("threads", &MonteCarloPlayer::threads)
+        .def_readwrite("parallelism", &MonteCarloPlayer::parallelism)
+        .def_readwrite("time_budget", &MonteCarloPlayer::time_budget)
+        .def_readwrite("early_stop", &MonteCarloPlayer::early_stop)
+        .def_property_readonly("rollouts_done", &MonteCarloPlayer::get_rollouts_done)
         .def_property_readonly_static("DEFAULT_ROLLOUTS", []() { return MonteCarloPlayer::DEFAULT_ROLLOUTS; })
         .def_property_readonly_static("DEFAULT_C", []() { return MonteCarloPlayer::DEFAULT_C; });
 
+    py::class_<MctsPlayer, std::shared_ptr<MctsPlayer>, Player>(m, "MctsPlayer")
+        .def(py::init<bool, int>(),
+            "until_round"_a = true,
+            "rollouts"_a = MctsPlayer::DEFAULT_ROLLOUTS)
+        .def_readwrite("heuristic", &MctsPlayer::heuristic)
+        .def_readwrite("rollouts", &MctsPlayer::rollouts)
+        .def_readwrite("until_round", &MctsPlayer::until_round)
+        .def_readwrite("smart", &MctsPlayer::smart)
+        .def_readwrite("c", &MctsPlayer::c)
+        .def_readwrite("widening", &MctsPlayer::widening)
+        .def_readwrite("max_nodes", &MctsPlayer::max_nodes)
+        .def_readwrite("transpositions", &MctsPlayer::transpositions)
+        .def("get_tree_size", &MctsPlayer::get_tree_size)
+        .def("get_root_visits", &MctsPlayer::get_root_visits)
+        .def("clear_tree", &MctsPlayer::clear_tree)
+        .def_property_readonly_static("DEFAULT_ROLLOUTS", []() { return MctsPlayer::DEFAULT_ROLLOUTS; })
+        .def_property_readonly_static("DEFAULT_C", []() { return MctsPlayer::DEFAULT_C; });
+
+    // Evaluators implemented in Python need the GIL, which PolicyValuePlayer.play releases.
+    // Players called while it is held, as by Game.roll_game, search on a single thread
+    py::class_<Evaluator, std::shared_ptr<Evaluator>, PyEvaluator>(m, "Evaluator")
+        .def(py::init<std::shared_ptr<const Rules>>(),
+            "rules"_a)
+        .def_property_readonly("rules", &Evaluator::get_rules)
+        .def("evaluate",
+            [](Evaluator& self, py::array_t<float, py::array::c_style | py::array::forcecast> observations) {
+                py::ssize_t size = self.get_encoder().size();
+                if (observations.size() % size != 0) {
+                    throw std::invalid_argument("Observations should be made of states of " + std::to_string(size) + " values");
+                }
+                py::ssize_t count = observations.size() / size;
+                py::array_t<float> policies({ count, py::ssize_t(action_index_count(*self.get_rules())) });
+                py::array_t<float> values({ count, py::ssize_t(self.get_rules()->player_count) });
+                {
+                    py::gil_scoped_release release;
+                    self.evaluate(count, observations.data(), policies.mutable_data(), values.mutable_data());
+                }
+                return py::make_tuple(policies, values);
+            },
+            "Returns the action logits and the values of states encoded by a StateEncoder",
+            "observations"_a)
+        .def("name", &Evaluator::name);
+
+    py::class_<MlpEvaluator, std::shared_ptr<MlpEvaluator>, Evaluator>(m, "MlpEvaluator")
+        .def(py::init<std::shared_ptr<const Rules>, std::vector<int>, int>(),
+            "rules"_a,
+            "hidden"_a = std::vector<int>{ 128 },
+            "seed"_a = 0)
+        .def(py::init<std::shared_ptr<const Rules>, const std::string&>(),
+            "rules"_a,
+            "path"_a)
+        .def("save",
+            &MlpEvaluator::save,
+            "path"_a)
+        .def_property_readonly("layer_count", &MlpEvaluator::layer_count)
+        .def("weights",
+            [](py::object self, int layer) {
+                MlpEvaluator& mlp = self.cast<MlpEvaluator&>();
+                std::vector<py::ssize_t> shape = { mlp.layer_inputs(layer), mlp.layer_outputs(layer) };
+                return py::array_t<float>(shape, mlp.get_weights(layer).data(), self);
+            },
+            "Writable view of the weights of the layer, of shape (inputs, outputs). "
+            "Layers are the hidden ones, then the policy head, then the value head",
+            "layer"_a)
+        .def("biases",
+            [](py::object self, int layer) {
+                MlpEvaluator& mlp = self.cast<MlpEvaluator&>();
+                std::vector<py::ssize_t> shape = { mlp.layer_outputs(layer) };
+                return py::array_t<float>(shape, mlp.get_biases(layer).data(), self);
+            },
+            "Writable view of the biases of the layer",
+            "layer"_a);
+
+    py::class_<EvaluationQueue, std::shared_ptr<EvaluationQueue>>(m, "EvaluationQueue")
+        .def(py::init<std::shared_ptr<Evaluator>, int>(),
+            "evaluator"_a,
+            "batch_size"_a = 8)
+        .def_property_readonly("evaluator", &EvaluationQueue::get_evaluator)
+        .def_readwrite("batch_size", &EvaluationQueue::batch_size)
+        .def_readwrite("max_wait", &EvaluationQueue::max_wait)
+        .def_property_readonly("batch_count", &EvaluationQueue::get_batch_count)
+        .def_property_readonly("evaluation_count", &EvaluationQueue::get_evaluation_count);
+
+    py::class_<PolicyValuePlayer, std::shared_ptr<PolicyValuePlayer>, Player>(m, "PolicyValuePlayer")
+        .def(py::init<std::shared_ptr<Evaluator>, int, int>(),
+            "evaluator"_a,
+            "rollouts"_a = PolicyValuePlayer::DEFAULT_ROLLOUTS,
+            "threads"_a = 1)
+        .def(py::init<std::shared_ptr<EvaluationQueue>, int, int>(),
+            "queue"_a,
+            "rollouts"_a = PolicyValuePlayer::DEFAULT_ROLLOUTS,
+            "threads"_a = 1)
+        .def_readwrite("heuristic", &PolicyValuePlayer::heuristic)
+        .def_readwrite("rollouts", &PolicyValuePlayer::rollouts)
+        .def_readwrite("threads", &PolicyValuePlayer::threads)
+        .def_readwrite("smart", &PolicyValuePlayer::smart)
+        .def_readwrite("c", &PolicyValuePlayer::c)
+        .def_readwrite("max_nodes", &PolicyValuePlayer::max_nodes)
+        .def("play",
+            &PolicyValuePlayer::play,
+            "state"_a,
+            py::call_guard<py::gil_scoped_release>())
+        .def_property_readonly("queue", &PolicyValuePlayer::get_queue)
+        .def("get_tree_size", &PolicyValuePlayer::get_tree_size)
+        .def("get_root_visits", &PolicyValuePlayer::get_root_visits)
+        .def_property_readonly_static("DEFAULT_ROLLOUTS", []() { return PolicyValuePlayer::DEFAULT_ROLLOUTS; })
+        .def_property_readonly_static("DEFAULT_C", []() { return PolicyValuePlayer::DEFAULT_C; });
+
     py::class_<RoundHeuristic>(m, "RoundHeuristic")
         .def(py::init<>())
         .def("eval_winrate",
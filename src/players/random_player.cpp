@@ -18,11 +18,11 @@ RandomPlayer::copy() const {
 
 Action
 RandomPlayer::play(const State& state) {
-    std::vector<Action> legal_actions;
+    ActionList legal_actions;
     if (smart) {
-        legal_actions = Game::all_smart_legal(state);
+        Game::all_smart_legal(state, legal_actions);
     } else {
-        legal_actions = Game::all_legal(state);
+        Game::all_legal(state, legal_actions);
     }
     if (legal_actions.size() == 1) {
         return legal_actions[0];
@@ -31,6 +31,11 @@ RandomPlayer::play(const State& state) {
     return legal_actions[index];
 }
 
+void
+RandomPlayer::reseed(int seed) {
+    randomness.seed(seed);
+}
+
 
 std::string
 RandomPlayer::player_type() const {
@@ -21,6 +21,7 @@ public:
     virtual std::shared_ptr<Player> copy() const override;
 
     virtual Action play(const State& state) override;
+    virtual void reseed(int seed) override;
 
     virtual std::string player_type() const override;
 };
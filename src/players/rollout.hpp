@@ -0,0 +1,101 @@
+#ifndef ROLLOUT_HPP
+#define ROLLOUT_HPP
+
+#include "first_legal_player.hpp"
+#include "game/action.hpp"
+#include "game/game.hpp"
+#include "global.hpp"
+#include "state/compact_state.hpp"
+#include "state/state.hpp"
+#include "utils/random.hpp"
+
+// Policies choose the actions of a Rollout. They are plain types,
+// so that their choice is inlined instead of calling Player::play
+
+// Same choices as RandomPlayer
+struct RandomPolicy {
+    bool smart = true;
+    ushort_range range{};
+
+    Action play(const State& state, rng& randomness) {
+        ActionList legal_actions;
+        if (smart) {
+            Game::all_smart_legal(state, legal_actions);
+        } else {
+            Game::all_legal(state, legal_actions);
+        }
+        if (legal_actions.size() == 1) {
+            return legal_actions[0];
+        }
+        return legal_actions[random_range(randomness, range, 0, legal_actions.size())];
+    }
+};
+
+// Same choices as FirstLegalPlayer
+struct FirstLegalPolicy {
+    Action play(const State& state, rng& /*randomness*/) {
+        return FirstLegalPlayer::first_legal(state);
+    }
+};
+
+// Plays on its own state like a Game where all players follow "Policy",
+// without players, observers, or recovery from illegal actions.
+// Methods have the same names as in Game, so that both can be used by templates
+template<class Policy>
+class Rollout {
+private:
+    State state;
+    Policy policy;
+    rng randomness;
+
+public:
+    Rollout(std::shared_ptr<const Rules> rules, Policy policy, int seed)
+      : state(rules)
+      , policy(policy)
+      , randomness(seed) {
+        state.enable_legal_masks();
+    }
+
+    const State& get_state() const {
+        return state;
+    }
+
+    void override_state(const State& _state) {
+        state = _state;
+    }
+
+    void override_state(const CompactState& compact) {
+        compact.restore(state);
+    }
+
+    void start_round() {
+        Game::setup_factories(state, randomness);
+    }
+
+    void end_round() {
+        Game::score_panels(state);
+        Game::apply_first_token(state);
+    }
+
+    void score_final() {
+        Game::score_final(state);
+    }
+
+    void roll_round() {
+        while (!state.is_round_finished()) {
+            Game::apply_unchecked(policy.play(state, randomness), state);
+            state.next_player();
+        }
+    }
+
+    void roll_end_game() {
+        while (!state.is_game_finished()) {
+            start_round();
+            roll_round();
+            end_round();
+        }
+        score_final();
+    }
+};
+
+#endif //ROLLOUT_HPP
@@ -0,0 +1,80 @@
+#include "transposition_table.hpp"
+
+#include <algorithm>
+
+TranspositionTable::TranspositionTable(std::size_t capacity)
+  : slots()
+  , mask(0)
+  , capacity(0)
+  , count(0) {
+    reserve(capacity);
+}
+
+uint32_t
+TranspositionTable::find(uint64_t hash) const {
+    if (slots.empty()) {
+        return NONE;
+    }
+    for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+        const Slot& slot = slots[i];
+        if (slot.index == NONE || slot.hash == hash) {
+            return slot.index;
+        }
+    }
+}
+
+uint32_t
+TranspositionTable::insert(uint64_t hash, uint32_t index) {
+    if (slots.empty()) {
+        return NONE;
+    }
+    for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+        Slot& slot = slots[i];
+        if (slot.index != NONE && slot.hash == hash) {
+            return slot.index;
+        }
+        if (slot.index == NONE) {
+            if (count >= capacity) {
+                return NONE;
+            }
+            slot.hash = hash;
+            slot.index = index;
+            count++;
+            return index;
+        }
+    }
+}
+
+std::size_t
+TranspositionTable::size() const {
+    return count;
+}
+
+std::size_t
+TranspositionTable::get_capacity() const {
+    return capacity;
+}
+
+// Keeps the table at most half full, so that probes stay short
+void
+TranspositionTable::reserve(std::size_t _capacity) {
+    if (_capacity == capacity) {
+        return;
+    }
+    capacity = _capacity;
+    std::size_t slot_count = 1;
+    while (slot_count < 2 * capacity) {
+        slot_count *= 2;
+    }
+    slots.assign(capacity == 0 ? 0 : slot_count, Slot{ 0, NONE });
+    mask = slot_count - 1;
+    count = 0;
+}
+
+void
+TranspositionTable::clear() {
+    if (count > 0) {
+        std::fill(slots.begin(), slots.end(), Slot{ 0, NONE });
+        count = 0;
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef TRANSPOSITION_TABLE_HPP
+#define TRANSPOSITION_TABLE_HPP
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Map from state hashes to indices, used by search players to find the
+// statistics of positions reached through different orders of actions.
+// Open addressing with linear probing, in a table that never grows:
+// once it holds "capacity" entries, insertions fail
+class TranspositionTable {
+private:
+    struct Slot {
+        uint64_t hash;
+        uint32_t index;
+    };
+
+    std::vector<Slot> slots;
+    std::size_t mask;
+    std::size_t capacity;
+    std::size_t count;
+
+public:
+    constexpr static uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    TranspositionTable(std::size_t capacity = 0);
+
+    // Index stored for "hash", or NONE
+    uint32_t find(uint64_t hash) const;
+    // Stores "index" for "hash" if it has no index yet, and returns the index
+    // stored for "hash", or NONE if the table is full
+    uint32_t insert(uint64_t hash, uint32_t index);
+
+    std::size_t size() const;
+    std::size_t get_capacity() const;
+    void reserve(std::size_t capacity);
+    void clear();
+};
+
+#endif //TRANSPOSITION_TABLE_HPP
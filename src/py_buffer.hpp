@@ -0,0 +1,37 @@
+#ifndef PY_BUFFER_HPP
+#define PY_BUFFER_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+#include <pybind11/pybind11.h>
+
+// Whether a buffer holds values of type T
+template<class T>
+bool
+py_buffer_is(const pybind11::buffer_info& info) {
+    return info.itemsize == sizeof(T) && info.format == pybind11::format_descriptor<T>::format();
+}
+
+// Values of a writable buffer, which should be C-contiguous and hold "count" values of type T
+template<class T>
+T*
+py_buffer_values(const pybind11::buffer_info& info, std::size_t count) {
+    if (!py_buffer_is<T>(info)) {
+        throw std::invalid_argument("Buffer should hold values of format " + pybind11::format_descriptor<T>::format());
+    }
+    if (std::size_t(info.size) != count) {
+        throw std::invalid_argument("Buffer should hold " + std::to_string(count) + " values, not " + std::to_string(info.size));
+    }
+    pybind11::ssize_t stride = info.itemsize;
+    for (pybind11::ssize_t dimension = info.ndim - 1; dimension >= 0; dimension--) {
+        if (info.shape[dimension] > 1 && info.strides[dimension] != stride) {
+            throw std::invalid_argument("Buffer should be C-contiguous");
+        }
+        stride *= info.shape[dimension];
+    }
+    return static_cast<T*>(info.ptr);
+}
+
+#endif //PY_BUFFER_HPP
@@ -0,0 +1,221 @@
+#include "compact_state.hpp"
+
+#include <stdexcept>
+
+#include "zobrist.hpp"
+
+inline Tile
+tile_of_value(uint8_t value) {
+    return value == TILE_TYPES ? Tile::NONE : Tile(value);
+}
+
+CompactState::CompactState(const State& state)
+  : rules(state.rules.get())
+  , player(state.player)
+  , first_token(state.center.first_token)
+  , sources()
+  , bag(state.bag.get_quantities())
+  , bin(state.bin.get_quantities())
+  , panels() {
+    if (!supports(*rules)) {
+        throw std::invalid_argument("Rules are too big to be stored in a CompactState");
+    }
+    sources[0] = state.center.tiles.get_quantities();
+    for (ushort f = 0; f < rules->factory_count(); f++) {
+        sources[f + 1] = state.factories[f].tiles.get_quantities();
+    }
+    const ushort n = rules->tile_types;
+    for (ushort p = 0; p < rules->player_count; p++) {
+        const Panel& panel = state.panels[p];
+        CompactPanel& compact = panels[p];
+        compact.score = panel.score;
+        compact.floor = panel.floor;
+        compact.first_token = panel.first_token;
+        compact.pyramid_colors.fill(TILE_TYPES);
+        for (ushort line = 0; line < n; line++) {
+            compact.pyramid_colors[line] = ushort(panel.pyramid.tile_types[line]);
+            compact.pyramid_amounts[line] = panel.pyramid.tile_filled[line];
+        }
+        compact.wall.fill(TILE_TYPES);
+        for (ushort y = 0; y < n; y++) {
+            for (ushort x = 0; x < n; x++) {
+                compact.wall[x + y * TILE_TYPES] = ushort(panel.wall.placed[x + y * n]);
+            }
+        }
+    }
+    rehash();
+}
+
+bool
+operator==(const CompactState& left, const CompactState& right) {
+    if (left.hash != right.hash ||
+        left.rules != right.rules ||
+        left.player != right.player ||
+        left.first_token != right.first_token ||
+        left.bag != right.bag ||
+        left.bin != right.bin) {
+        return false;
+    }
+    const Rules& rules = *left.rules;
+    for (ushort pick = 0; pick <= rules.factory_count(); pick++) {
+        if (left.sources[pick] != right.sources[pick]) {
+            return false;
+        }
+    }
+    for (ushort p = 0; p < rules.player_count; p++) {
+        const CompactPanel& l = left.panels[p];
+        const CompactPanel& r = right.panels[p];
+        if (l.score != r.score ||
+            l.floor != r.floor ||
+            l.first_token != r.first_token ||
+            l.pyramid_colors != r.pyramid_colors ||
+            l.pyramid_amounts != r.pyramid_amounts ||
+            l.wall != r.wall) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+operator!=(const CompactState& left, const CompactState& right) {
+    return !(left == right);
+}
+
+bool
+CompactState::supports(const Rules& rules) {
+    return rules.player_count <= MAX_PLAYER_COUNT && rules.tile_types <= TILE_TYPES;
+}
+
+// Same hash as State::hash
+void
+CompactState::rehash() {
+    const ushort n = rules->tile_types;
+    hash = Zobrist::key(Zobrist::PLAYER, player) ^
+           Zobrist::key(Zobrist::CENTER_TOKEN, first_token) ^
+           Zobrist::key(Zobrist::BAG, Zobrist::tiles(bag)) ^
+           Zobrist::key(Zobrist::BIN, Zobrist::tiles(bin));
+    for (ushort pick = 0; pick <= rules->factory_count(); pick++) {
+        hash ^= Zobrist::key(Zobrist::source(pick), Zobrist::tiles(sources[pick]));
+    }
+    for (ushort p = 0; p < rules->player_count; p++) {
+        const CompactPanel& panel = panels[p];
+        hash ^= Zobrist::key(Zobrist::panel(p, Zobrist::SCORE), panel.score) ^
+                Zobrist::key(Zobrist::panel(p, Zobrist::FLOOR), panel.floor) ^
+                Zobrist::key(Zobrist::panel(p, Zobrist::TOKEN), panel.first_token);
+        for (ushort y = 0; y < n; y++) {
+            uint64_t placed = 0;
+            for (ushort x = 0; x < n; x++) {
+                if (panel.wall[x + y * TILE_TYPES] != TILE_TYPES) {
+                    placed |= 1 << x;
+                }
+            }
+            hash ^= Zobrist::key(Zobrist::panel(p, Zobrist::LINE + y), Zobrist::line(panel.pyramid_colors[y], panel.pyramid_amounts[y])) ^
+                    Zobrist::key(Zobrist::panel(p, Zobrist::WALL + y), placed);
+        }
+    }
+}
+
+// Conversion
+
+State
+CompactState::to_state(const std::shared_ptr<const Rules>& _rules) const {
+    State state(_rules);
+    restore(state);
+    return state;
+}
+
+void
+CompactState::restore(State& state) const {
+    if (state.rules.get() != rules) {
+        throw std::logic_error("Cannot restore compact state with different rules");
+    }
+    state.player = player;
+    state.center.first_token = first_token;
+    state.center.tiles.set_quantities(sources[0]);
+    for (ushort f = 0; f < rules->factory_count(); f++) {
+        state.factories[f].tiles.set_quantities(sources[f + 1]);
+    }
+    state.bag.set_quantities(bag);
+    state.bin.set_quantities(bin);
+    const ushort n = rules->tile_types;
+    for (ushort p = 0; p < rules->player_count; p++) {
+        Panel& panel = state.panels[p];
+        const CompactPanel& compact = panels[p];
+        panel.score = compact.score;
+        panel.floor = compact.floor;
+        panel.first_token = compact.first_token;
+        for (ushort line = 0; line < n; line++) {
+            panel.pyramid.tile_types[line] = tile_of_value(compact.pyramid_colors[line]);
+            panel.pyramid.tile_filled[line] = compact.pyramid_amounts[line];
+        }
+        for (ushort y = 1; y <= n; y++) {
+            for (ushort x = 1; x <= n; x++) {
+                panel.wall.set_tile_at_unsafe(x, y, tile_of_value(compact.wall[x - 1 + (y - 1) * TILE_TYPES]));
+            }
+        }
+    }
+    if (state.legal_masks.enabled) {
+        state.update_legal_masks();
+    }
+}
+
+
+const Rules*
+CompactState::get_rules() const {
+    return rules;
+}
+
+ushort
+CompactState::get_current_player() const {
+    return player;
+}
+
+void
+CompactState::next_player() {
+    ushort previous = player;
+    if (player + 1 >= rules->player_count) {
+        player = 0;
+    } else {
+        player++;
+    }
+    hash ^= Zobrist::change(Zobrist::PLAYER, previous, player);
+}
+
+
+ushort
+CompactState::source_total(ushort pick) const {
+    const std::array<ushort, TILE_TYPES>& tiles = sources[pick];
+    ushort total = 0;
+    for (ushort color = 0; color < TILE_TYPES; color++) {
+        total += tiles[color];
+    }
+    return total;
+}
+
+bool
+CompactState::line_has_color(ushort _player, ushort line, ushort color) const {
+    ushort x = (line - 1 + color) % rules->tile_types;
+    return panels[_player].wall[x + (line - 1) * TILE_TYPES] != TILE_TYPES;
+}
+
+bool
+CompactState::legal_line(ushort _player, ushort line, ushort color) const {
+    if (line_has_color(_player, line, color)) {
+        return false;
+    }
+    const CompactPanel& panel = panels[_player];
+    ushort current = panel.pyramid_colors[line - 1];
+    return current == TILE_TYPES || (current == color && panel.pyramid_amounts[line - 1] != line);
+}
+
+
+bool
+CompactState::is_round_finished() const {
+    for (ushort pick = 0; pick <= rules->factory_count(); pick++) {
+        if (source_total(pick) > 0) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef COMPACT_STATE_HPP
+#define COMPACT_STATE_HPP
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+#include "global.hpp"
+#include "rules/rules.hpp"
+#include "state.hpp"
+
+// Plain-data copy of a Panel, see CompactState
+struct CompactPanel {
+    ushort score;
+    ushort floor;
+    bool first_token;
+    // Tile value of each pyramid line, TILE_TYPES if the line has no color
+    std::array<uint8_t, TILE_TYPES> pyramid_colors;
+    std::array<uint8_t, TILE_TYPES> pyramid_amounts;
+    // Tile value placed at (x, y), stored at index (x - 1) + (y - 1) * TILE_TYPES
+    std::array<uint8_t, TILE_TYPES * TILE_TYPES> wall;
+};
+
+// Trivially copyable equivalent of a State, with fixed arrays sized for the
+// largest supported rules, so that copying it is a single memcpy.
+// Rules are only referenced, and should outlive the CompactState.
+// Game keeps its Zobrist hash up to date, call rehash after editing it by hand.
+struct CompactState {
+    const Rules* rules;
+    uint64_t hash;
+    ushort player;
+    bool first_token;
+    // Tiles of each source, index 0 is the center and i is the factory of id i
+    std::array<std::array<ushort, TILE_TYPES>, 1 + MAX_FACTORY_COUNT> sources;
+    std::array<ushort, TILE_TYPES> bag;
+    std::array<ushort, TILE_TYPES> bin;
+    std::array<CompactPanel, MAX_PLAYER_COUNT> panels;
+
+    CompactState() = default;
+    explicit CompactState(const State& state);
+
+    friend bool operator==(const CompactState& left, const CompactState& right);
+    friend bool operator!=(const CompactState& left, const CompactState& right);
+
+    static bool supports(const Rules& rules);
+
+    void rehash();
+
+    // Conversion
+    State to_state(const std::shared_ptr<const Rules>& rules) const;
+    void restore(State& state) const;
+
+    const Rules* get_rules() const;
+    ushort get_current_player() const;
+    void next_player();
+
+    ushort source_total(ushort pick) const;
+    bool line_has_color(ushort player, ushort line, ushort color) const;
+    bool legal_line(ushort player, ushort line, ushort color) const;
+
+    bool is_round_finished() const;
+};
+
+static_assert(std::is_trivially_copyable<CompactState>::value, "CompactState should be trivially copyable");
+
+#endif //COMPACT_STATE_HPP
@@ -0,0 +1,20 @@
+#ifndef LEGAL_MASKS_HPP
+#define LEGAL_MASKS_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "global.hpp"
+
+// Bit masks describing the legal actions of a State, which it can keep
+// up to date so that legal actions are enumerated without scanning panels
+struct LegalMasks {
+    bool enabled = false;
+    // Bit "color" is set if the source (0 for the center, else the factory id) has tiles of this color
+    std::vector<uint8_t> source_colors{};
+    // Bit "line - 1" of [player][color] is set if the line of the player's pyramid accepts the color
+    std::vector<std::array<uint8_t, TILE_TYPES>> accepted_lines{};
+};
+
+#endif //LEGAL_MASKS_HPP
@@ -9,6 +9,8 @@
 #include "wall.hpp"
 
 class Panel {
+    friend struct CompactState;
+
 private:
     const std::shared_ptr<const Rules> rules;
     ushort score;
@@ -41,6 +43,8 @@ public:
     ushort get_penalty() const;
 
     bool legal_line(ushort line, Tile tile) const;
+    // Unchecked version, for lines known to be in [1, tile_types]
+    bool legal_line_unchecked(ushort line, Tile tile) const noexcept;
 
     // Reading
     friend std::ostream& operator<<(std::ostream& os, const Panel& panel);
@@ -48,4 +52,13 @@ public:
     std::string repr() const;
 };
 
+inline bool
+Panel::legal_line_unchecked(ushort line, Tile tile) const noexcept {
+    if (wall.line_has_color_unchecked(line, tile)) {
+        return false;
+    }
+    Tile current = pyramid.color_unchecked(line);
+    return current == Tile::NONE || (current == tile && pyramid.amount_unchecked(line) != line);
+}
+
 #endif //PANEL_HPP
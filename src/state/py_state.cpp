@@ -1,12 +1,15 @@
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
 #include "center.hpp"
 #include "factory.hpp"
 #include "panel.hpp"
+#include "py_buffer.hpp"
 #include "py_utils.hpp"
 #include "pyramid.hpp"
 #include "state.hpp"
+#include "state_encoder.hpp"
 #include "tile.hpp"
 #include "tiles.hpp"
 #include "wall.hpp"
@@ -14,6 +17,26 @@
 namespace py = pybind11;
 using namespace py::literals;
 
+// Encodes the states into "out", a float32 or uint8 buffer, or a new float32 array of the given shape
+py::object
+py_encode(const StateEncoder& encoder, const std::vector<const State*>& states, std::vector<py::ssize_t> shape, py::object out) {
+    if (out.is_none()) {
+        out = py::array_t<float>(shape);
+    }
+    py::buffer_info info = out.cast<py::buffer>().request(true);
+    std::size_t count = states.size() * encoder.size();
+    if (py_buffer_is<uint8_t>(info)) {
+        uint8_t* values = py_buffer_values<uint8_t>(info, count);
+        py::gil_scoped_release release;
+        encoder.encode(states, values);
+    } else {
+        float* values = py_buffer_values<float>(info, count);
+        py::gil_scoped_release release;
+        encoder.encode(states, values);
+    }
+    return out;
+}
+
 void
 py_bind_state(py::module& root) {
     py::module m = root.def_submodule("state", "Classes defining the state of a Ceramic game");
@@ -67,10 +90,10 @@ py_bind_state(py::module& root) {
             return self[tile];
         })
         .def("__setitem__", [](Tiles& self, Tile tile, ushort value) {
-            self[tile] = value;
+            self.set(tile, value);
         })
         .def("__setitem__", [](Tiles& self, int tile, ushort value) {
-            self[tile] = value;
+            self.set(tile, value);
         })
         .def("total", &Tiles::total)
         .def("__len__", &Tiles::size)
@@ -94,6 +117,7 @@ py_bind_state(py::module& root) {
 
         .def_property_readonly("quantities", &Tiles::get_quantities)
         .def_property_readonly_static("ZERO", [](py::object) { return Tiles::ZERO; })
+        .def_readonly_static("MAX_QUANTITY", &Tiles::MAX_QUANTITY)
 
         .def("__str__", &Tiles::str)
         .def("letter_str", &Tiles::letter_str)
@@ -230,6 +254,12 @@ py_bind_state(py::module& root) {
 
         .def("get_total_tiles", &State::get_total_tiles)
 
+        .def("enable_legal_masks",
+            &State::enable_legal_masks,
+            "enabled"_a = true)
+        .def("has_legal_masks", &State::has_legal_masks)
+        .def("update_legal_masks", &State::update_legal_masks)
+
         .def_property("current_player", &State::get_current_player, &State::set_current_player)
         .def("next_player", &State::next_player)
 
@@ -238,6 +268,7 @@ py_bind_state(py::module& root) {
         .def("is_game_finished", &State::is_game_finished)
         .def("highest_score_players", &State::highest_score_players)
         .def("winning_player", &State::winning_player)
+        .def("hash", &State::hash)
 
         .def("__eq__", &py_eq<State>)
         .def("__ne__", &py_ne<State>)
@@ -246,6 +277,42 @@ py_bind_state(py::module& root) {
         .def("__repr__", &State::repr);
 
 
+    py::class_<StateEncoder>(m, "StateEncoder")
+        .def(py::init<const std::shared_ptr<const Rules>>(),
+            "rules"_a)
+
+        .def_property_readonly("rules", &StateEncoder::get_rules)
+        .def_property_readonly("plane_count", &StateEncoder::plane_count)
+        .def_property_readonly("plane_size", &StateEncoder::plane_size)
+        .def_property_readonly("size", &StateEncoder::size)
+        .def_property_readonly("shape", [](const StateEncoder& self) {
+            ushort n = self.get_rules()->tile_types;
+            return py::make_tuple(self.plane_count(), n, n);
+        })
+
+        .def("encode",
+            [](const StateEncoder& self, const State& state, py::object out) {
+                ushort n = self.get_rules()->tile_types;
+                return py_encode(self, { &state }, { self.plane_count(), n, n }, out);
+            },
+            "Writes the planes of the state into 'out', a C-contiguous float32 or uint8 buffer of 'size' values, "
+            "or into a new float32 array of shape 'shape' if 'out' is None, and returns it",
+            "state"_a,
+            "out"_a = py::none())
+        .def("encode_batch",
+            [](const StateEncoder& self, py::sequence states, py::object out) {
+                std::vector<const State*> pointers;
+                for (py::handle state : states) {
+                    pointers.push_back(&state.cast<const State&>());
+                }
+                ushort n = self.get_rules()->tile_types;
+                return py_encode(self, pointers, { py::ssize_t(pointers.size()), self.plane_count(), n, n }, out);
+            },
+            "Same as encode for each state, into consecutive blocks of 'out'",
+            "states"_a,
+            "out"_a = py::none());
+
+
     py::class_<Wall>(m, "Wall")
         .def(py::init<const std::shared_ptr<const Rules>>(),
             "rules"_a)
@@ -8,6 +8,8 @@
 #include "tiles.hpp"
 
 class Pyramid {
+    friend struct CompactState;
+
 private:
     const ushort size;
     std::vector<Tile> tile_types;
@@ -35,6 +37,11 @@ public:
     ushort amount_remaining(ushort line) const;
     Tile color(ushort line) const;
     bool accept_color(ushort line, Tile color) const;
+
+    // Unchecked versions, for lines known to be in [1, size]
+    ushort amount_unchecked(ushort line) const noexcept;
+    Tile color_unchecked(ushort line) const noexcept;
+    void set_line_unchecked(ushort line, ushort amount, Tile color) noexcept;
     std::vector<bool> filled() const;
 
     // Reading
@@ -44,4 +51,20 @@ public:
     std::string repr() const;
 };
 
+inline ushort
+Pyramid::amount_unchecked(ushort line) const noexcept {
+    return tile_filled[line - 1];
+}
+
+inline Tile
+Pyramid::color_unchecked(ushort line) const noexcept {
+    return tile_types[line - 1];
+}
+
+inline void
+Pyramid::set_line_unchecked(ushort line, ushort amount, Tile color) noexcept {
+    tile_types[line - 1] = color;
+    tile_filled[line - 1] = amount;
+}
+
 #endif //PYRAMID_HPP
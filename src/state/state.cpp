@@ -2,6 +2,8 @@
 
 #include <sstream>
 
+#include "zobrist.hpp"
+
 State::State(std::shared_ptr<const Rules> rules)
   : rules(rules)
   , center()
@@ -23,7 +25,8 @@ State::State(const State& state)
   , panels()
   , bag(state.bag)
   , bin(state.bin)
-  , player(state.player) {
+  , player(state.player)
+  , legal_masks(state.legal_masks) {
     for (auto& factory : state.factories) {
         factories.push_back(Factory(factory));
     }
@@ -48,6 +51,14 @@ State::operator=(const State& other) {
     bag = other.bag;
     bin = other.bin;
     player = other.player;
+    // Keep own choice of tracking legal masks
+    if (legal_masks.enabled) {
+        if (other.legal_masks.enabled) {
+            legal_masks = other.legal_masks;
+        } else {
+            update_legal_masks();
+        }
+    }
     return *this;
 }
 
@@ -88,12 +99,18 @@ State::assert_factory_id(ushort id) const {
 void
 State::reset() {
     bag = Tiles(std::vector<ushort>(rules->tile_types, rules->tile_count));
+    bin = Tiles::ZERO;
+    center.tiles = Tiles::ZERO;
+    center.first_token = false;
     for (Factory& factory : factories) {
         factory.tiles = Tiles::ZERO;
     }
     for (Panel& panel : panels) {
         panel.clear();
     }
+    if (legal_masks.enabled) {
+        update_legal_masks();
+    }
 }
 
 const std::shared_ptr<const Rules>&
@@ -186,6 +203,62 @@ State::get_total_tiles() const {
     return result;
 }
 
+void
+State::update_source_mask(ushort pick) {
+    const Tiles& tiles = (pick == 0) ? center.tiles : factories[pick - 1].tiles;
+    legal_masks.source_colors[pick] = tiles.color_mask();
+}
+
+void
+State::update_line_mask(ushort id, ushort line) {
+    const Panel& panel = panels[id];
+    std::array<uint8_t, TILE_TYPES>& accepted_lines = legal_masks.accepted_lines[id];
+    uint8_t bit = 1 << (line - 1);
+    for (ushort color = 0; color < rules->tile_types; color++) {
+        if (panel.legal_line_unchecked(line, Tile(color))) {
+            accepted_lines[color] |= bit;
+        } else {
+            accepted_lines[color] &= ~bit;
+        }
+    }
+}
+
+void
+State::enable_legal_masks(bool enabled) {
+    legal_masks.enabled = enabled;
+    if (enabled) {
+        update_legal_masks();
+    } else {
+        legal_masks.source_colors.clear();
+        legal_masks.accepted_lines.clear();
+    }
+}
+
+bool
+State::has_legal_masks() const {
+    return legal_masks.enabled;
+}
+
+const LegalMasks&
+State::get_legal_masks() const {
+    return legal_masks;
+}
+
+void
+State::update_legal_masks() {
+    legal_masks.source_colors.resize(1 + rules->factory_count());
+    legal_masks.accepted_lines.resize(rules->player_count);
+    for (ushort pick = 0; pick <= rules->factory_count(); pick++) {
+        update_source_mask(pick);
+    }
+    for (ushort id = 0; id < rules->player_count; id++) {
+        for (ushort line = 1; line <= rules->tile_types; line++) {
+            update_line_mask(id, line);
+        }
+    }
+}
+
+
 void
 State::set_current_player(ushort id) {
     assert_player_id(id);
@@ -277,6 +350,33 @@ State::winning_player() const {
     return winner;
 }
 
+uint64_t
+State::hash() const {
+    const ushort n = rules->tile_types;
+    uint64_t result = Zobrist::key(Zobrist::PLAYER, player) ^
+                      Zobrist::key(Zobrist::CENTER_TOKEN, center.first_token) ^
+                      Zobrist::key(Zobrist::BAG, Zobrist::tiles(bag.get_quantities())) ^
+                      Zobrist::key(Zobrist::BIN, Zobrist::tiles(bin.get_quantities())) ^
+                      Zobrist::key(Zobrist::source(0), Zobrist::tiles(center.tiles.get_quantities()));
+    for (ushort f = 0; f < factories.size(); f++) {
+        result ^= Zobrist::key(Zobrist::source(f + 1), Zobrist::tiles(factories[f].tiles.get_quantities()));
+    }
+    for (ushort p = 0; p < panels.size(); p++) {
+        const Panel& panel = panels[p];
+        const Pyramid& pyramid = panel.get_pyramid();
+        uint32_t placed = panel.get_wall().get_placed_mask();
+        result ^= Zobrist::key(Zobrist::panel(p, Zobrist::SCORE), panel.get_score()) ^
+                  Zobrist::key(Zobrist::panel(p, Zobrist::FLOOR), panel.get_floor()) ^
+                  Zobrist::key(Zobrist::panel(p, Zobrist::TOKEN), panel.get_first_token());
+        for (ushort line = 1; line <= n; line++) {
+            uint64_t line_value = Zobrist::line(ushort(pyramid.color_unchecked(line)), pyramid.amount_unchecked(line));
+            result ^= Zobrist::key(Zobrist::panel(p, Zobrist::LINE + line - 1), line_value) ^
+                      Zobrist::key(Zobrist::panel(p, Zobrist::WALL + line - 1), (placed >> ((line - 1) * n)) & ((1u << n) - 1));
+        }
+    }
+    return result;
+}
+
 // Reading
 
 std::ostream&
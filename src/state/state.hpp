@@ -7,12 +7,14 @@
 
 #include "center.hpp"
 #include "factory.hpp"
+#include "legal_masks.hpp"
 #include "panel.hpp"
 #include "rules/rules.hpp"
 #include "tiles.hpp"
 
 class State {
     friend class Game;
+    friend struct CompactState;
 
 private:
     const std::shared_ptr<const Rules> rules;
@@ -22,10 +24,14 @@ private:
     Tiles bag;
     Tiles bin;
     ushort player;
+    LegalMasks legal_masks;
 
     void assert_player_id(ushort id) const;
     void assert_factory_id(ushort id) const;
 
+    void update_source_mask(ushort pick);
+    void update_line_mask(ushort player, ushort line);
+
 public:
     State(std::shared_ptr<const Rules> rules);
     State(const State& state);
@@ -46,6 +52,12 @@ public:
     const Panel& get_panel(ushort id) const;
     Panel& get_panel_mut(ushort id);
 
+    // Unchecked versions, for ids known to be valid
+    const Factory& get_factory_unchecked(ushort id) const noexcept;
+    Factory& get_factory_mut_unchecked(ushort id) noexcept;
+    const Panel& get_panel_unchecked(ushort id) const noexcept;
+    Panel& get_panel_mut_unchecked(ushort id) noexcept;
+
     Tiles get_bag() const;
     Tiles& get_bag_mut();
     Tiles get_bin() const;
@@ -53,6 +65,14 @@ public:
 
     Tiles get_total_tiles() const;
 
+    // When enabled, Game keeps the legal masks up to date and uses them
+    // to list legal actions. Call update_legal_masks after editing the
+    // state by hand.
+    void enable_legal_masks(bool enabled = true);
+    bool has_legal_masks() const;
+    const LegalMasks& get_legal_masks() const;
+    void update_legal_masks();
+
     void set_current_player(ushort id);
     void next_player();
 
@@ -62,10 +82,33 @@ public:
     std::vector<ushort> highest_score_players() const;
     ushort winning_player() const;
 
+    // Zobrist hash, the same as the one of the CompactState of this state
+    uint64_t hash() const;
+
     // Reading
     friend std::ostream& operator<<(std::ostream& os, const State& state);
     std::string str() const;
     std::string repr() const;
 };
 
+inline const Factory&
+State::get_factory_unchecked(ushort id) const noexcept {
+    return factories[id - 1];
+}
+
+inline Factory&
+State::get_factory_mut_unchecked(ushort id) noexcept {
+    return factories[id - 1];
+}
+
+inline const Panel&
+State::get_panel_unchecked(ushort id) const noexcept {
+    return panels[id];
+}
+
+inline Panel&
+State::get_panel_mut_unchecked(ushort id) noexcept {
+    return panels[id];
+}
+
 #endif //STATE_HPP
@@ -0,0 +1,123 @@
+#include "state_encoder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+template<class T>
+T
+feature(int value) {
+    return T(std::min<double>(value, std::numeric_limits<T>::max()));
+}
+
+} // namespace
+
+constexpr ushort StateEncoder::PLAYER_PLANES;
+
+StateEncoder::StateEncoder(std::shared_ptr<const Rules> rules)
+  : rules(rules)
+  , cell_colors() {
+    if (rules->player_count > MAX_PLAYER_COUNT || rules->tile_types > TILE_TYPES) {
+        throw std::invalid_argument("Rules are too large for the StateEncoder");
+    }
+    ushort n = rules->tile_types;
+    // Same layout as Wall::color_at
+    for (ushort y = 0; y < n; y++) {
+        for (ushort x = 0; x < n; x++) {
+            cell_colors.push_back((n + x - y) % n);
+        }
+    }
+}
+
+const std::shared_ptr<const Rules>&
+StateEncoder::get_rules() const {
+    return rules;
+}
+
+ushort
+StateEncoder::plane_count() const {
+    return PLAYER_PLANES * rules->player_count + 1 + rules->factory_count() + 3;
+}
+
+ushort
+StateEncoder::plane_size() const {
+    return rules->tile_types * rules->tile_types;
+}
+
+std::size_t
+StateEncoder::size() const {
+    return std::size_t(plane_count()) * plane_size();
+}
+
+template<class T>
+void
+StateEncoder::encode_tiles(Tiles tiles, T* plane) const {
+    std::array<ushort, TILE_TYPES> quantities = tiles.get_quantities();
+    for (std::size_t cell = 0; cell < cell_colors.size(); cell++) {
+        plane[cell] = feature<T>(quantities[cell_colors[cell]]);
+    }
+}
+
+template<class T>
+void
+StateEncoder::encode(const State& state, T* out) const {
+    if (state.get_rules() != rules && *state.get_rules() != *rules) {
+        throw std::invalid_argument("State does not have the rules of the StateEncoder");
+    }
+    ushort n = rules->tile_types;
+    ushort p = rules->player_count;
+    ushort cells = plane_size();
+    std::fill(out, out + size(), T(0));
+    T* plane = out;
+    for (ushort k = 0; k < p; k++) {
+        const Panel& panel = state.get_panel_unchecked((state.get_current_player() + k) % p);
+        // Wall cells and mask bits share their index
+        uint32_t placed = panel.get_wall().get_placed_mask();
+        for (ushort cell = 0; cell < cells; cell++) {
+            plane[cell] = T((placed >> cell) & 1);
+        }
+        plane += cells;
+        const Pyramid& pyramid = panel.get_pyramid();
+        for (ushort line = 1; line <= n; line++) {
+            Tile color = pyramid.color_unchecked(line);
+            if (color) {
+                plane[(line - 1) * n + (line - 1 + ushort(color)) % n] = feature<T>(pyramid.amount_unchecked(line));
+            }
+        }
+        plane += cells;
+        std::fill(plane, plane + cells, feature<T>(panel.get_floor()));
+        plane += cells;
+        std::fill(plane, plane + cells, T(panel.get_first_token()));
+        plane += cells;
+        std::fill(plane, plane + cells, feature<T>(panel.get_score()));
+        plane += cells;
+    }
+    encode_tiles(state.get_center().tiles, plane);
+    plane += cells;
+    for (ushort factory = 1; factory <= rules->factory_count(); factory++) {
+        encode_tiles(state.get_factory_unchecked(factory).tiles, plane);
+        plane += cells;
+    }
+    std::fill(plane, plane + cells, T(state.get_center().first_token));
+    plane += cells;
+    encode_tiles(state.get_bag(), plane);
+    plane += cells;
+    encode_tiles(state.get_bin(), plane);
+}
+
+template<class T>
+void
+StateEncoder::encode(const std::vector<const State*>& states, T* out) const {
+    for (const State* state : states) {
+        encode(*state, out);
+        out += size();
+    }
+}
+
+template void StateEncoder::encode<float>(const State& state, float* out) const;
+template void StateEncoder::encode<uint8_t>(const State& state, uint8_t* out) const;
+template void StateEncoder::encode<float>(const std::vector<const State*>& states, float* out) const;
+template void StateEncoder::encode<uint8_t>(const std::vector<const State*>& states, uint8_t* out) const;
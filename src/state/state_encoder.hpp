@@ -0,0 +1,48 @@
+#ifndef STATE_ENCODER_HPP
+#define STATE_ENCODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "global.hpp"
+#include "rules/rules.hpp"
+#include "state.hpp"
+
+// Writes a State as a stack of tile_types x tile_types planes, laid out like
+// the wall: the value of a color is written on the cells of that color.
+// Players are ordered from the perspective of the current player, and each has
+//   wall (1 if placed), pyramid (amount on the cell of the line color),
+//   floor, first token and score (whole planes)
+// followed by the center, each factory, the first token in the center, the bag
+// and the bin. Values are counts, clamped to the range of the output type
+class StateEncoder {
+private:
+    std::shared_ptr<const Rules> rules;
+    // Color of each cell of a plane
+    std::vector<ushort> cell_colors;
+
+    template<class T>
+    void encode_tiles(Tiles tiles, T* plane) const;
+
+public:
+    constexpr static ushort PLAYER_PLANES = 5;
+
+    StateEncoder(std::shared_ptr<const Rules> rules);
+
+    const std::shared_ptr<const Rules>& get_rules() const;
+    ushort plane_count() const;
+    ushort plane_size() const;
+    // Values written for one state
+    std::size_t size() const;
+
+    // "out" holds size() values. Implemented for float and uint8_t
+    template<class T>
+    void encode(const State& state, T* out) const;
+    // "out" holds states.size() * size() values
+    template<class T>
+    void encode(const std::vector<const State*>& states, T* out) const;
+};
+
+#endif //STATE_ENCODER_HPP
@@ -2,46 +2,13 @@
 
 #include <sstream>
 
-Tile::Tile()
-  : value(TILE_TYPES) {}
-
-Tile::Tile(ushort value, bool check)
-  : value(value) {
-    if (check && value >= TILE_TYPES) {
-        throw std::invalid_argument("Tile color was too big (" + std::to_string(value) + ")");
-    }
+void
+Tile::throw_too_big(ushort value) {
+    throw std::invalid_argument("Tile color was too big (" + std::to_string(value) + ")");
 }
 
-Tile::Tile(ushort value)
-  : Tile(value, true) {}
-
-Tile::Tile(const Tile& tile)
-  : value(tile.value) {}
-
 const Tile Tile::NONE = Tile();
 
-bool
-operator==(Tile left, Tile right) {
-    return left.value == right.value;
-}
-
-bool
-operator!=(Tile left, Tile right) {
-    return !(left == right);
-}
-
-Tile::operator int() const {
-    return value;
-}
-
-Tile::operator bool() const {
-    return value != TILE_TYPES;
-}
-
-Tile::operator ushort() const {
-    return value;
-}
-
 constexpr const int INT_OF_CHAR_A = 'A';
 constexpr const int INT_OF_CHAR_a = 'a';
 
@@ -9,11 +9,13 @@ struct Tile {
 private:
     ushort value;
     Tile(ushort value, bool check);
+    [[noreturn]] static void throw_too_big(ushort value);
 
 public:
     Tile();
     Tile(ushort value);
     Tile(const Tile& tile);
+    Tile& operator=(const Tile& tile) = default;
 
     static const Tile NONE;
 
@@ -36,4 +38,44 @@ public:
     std::string repr() const;
 };
 
+// Tiles are built and compared in all legal action loops, so these are inlined
+
+inline Tile::Tile()
+  : value(TILE_TYPES) {}
+
+inline Tile::Tile(ushort value, bool check)
+  : value(value) {
+    if (check && value >= TILE_TYPES) {
+        throw_too_big(value);
+    }
+}
+
+inline Tile::Tile(ushort value)
+  : Tile(value, true) {}
+
+inline Tile::Tile(const Tile& tile)
+  : value(tile.value) {}
+
+inline bool
+operator==(Tile left, Tile right) {
+    return left.value == right.value;
+}
+
+inline bool
+operator!=(Tile left, Tile right) {
+    return !(left == right);
+}
+
+inline Tile::operator int() const {
+    return value;
+}
+
+inline Tile::operator bool() const {
+    return value != TILE_TYPES;
+}
+
+inline Tile::operator ushort() const {
+    return value;
+}
+
 #endif //TILE_HPP
\ No newline at end of file
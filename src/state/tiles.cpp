@@ -2,60 +2,70 @@
 
 #include <algorithm>
 #include <iterator>
-#include <numeric>
 #include <sstream>
 
-// Constructors
+constexpr ushort Tiles::LANE_BITS;
+constexpr ushort Tiles::MAX_QUANTITY;
+constexpr uint64_t Tiles::LANE;
+constexpr uint64_t Tiles::ONES;
+constexpr uint64_t Tiles::GUARDS;
+
+void
+Tiles::throw_too_many(int quantity) {
+    throw std::range_error("Can't hold " + std::to_string(quantity) + " tiles of a color, the maximum is " + std::to_string(MAX_QUANTITY));
+}
 
-Tiles::Tiles()
-  : quantities() {}
+// Constructors
 
 Tiles::Tiles(Tile tile)
   : Tiles(tile, 1) {}
 
 Tiles::Tiles(Tile tile, int count)
-  : quantities() {
+  : packed(0) {
     if (bool(tile)) {
-        quantities[(int)(tile)] = count;
+        set(tile, count);
     }
 }
 
 Tiles::Tiles(const std::vector<ushort>& tiles)
-  : quantities() {
-    uint index = 0;
+  : packed(0) {
+    ushort color = 0;
     for (ushort q : tiles) {
-        if (index > TILE_TYPES) {
+        if (color >= TILE_TYPES) {
             break;
         }
-        quantities[index] = q;
-        index++;
+        set(Tile(color), q);
+        color++;
     }
 }
 
-Tiles::Tiles(const Tiles& tiles)
-  : quantities(tiles.quantities) {}
-
 // Utils
 
-ushort&
-Tiles::operator[](Tile tile) {
+ushort
+Tiles::operator[](Tile tile) const {
     if (!tile) {
         throw std::range_error("Can't get amount of null tiles");
     }
-    return quantities[int(tile)];
+    return get_unchecked(tile);
 }
 
-ushort
-Tiles::total() const {
-    return std::accumulate(
-        quantities.begin(),
-        quantities.end(),
-        0);
+void
+Tiles::set(Tile tile, ushort quantity) {
+    if (!tile) {
+        throw std::range_error("Can't set amount of null tiles");
+    }
+    if (quantity > MAX_QUANTITY) {
+        throw_too_many(quantity);
+    }
+    set_unchecked(tile, quantity);
 }
 
-bool
-Tiles::is_empty() const {
-    return total() == 0;
+// Sums pairs of lanes into 24-bit lanes, then adds these together
+ushort
+Tiles::total() const {
+    const uint64_t even_lanes = LANE | (LANE << 2 * LANE_BITS) | (LANE << 4 * LANE_BITS);
+    uint64_t pairs = (packed & even_lanes) + ((packed >> LANE_BITS) & even_lanes);
+    return (pairs + (pairs >> 2 * LANE_BITS) + (pairs >> 4 * LANE_BITS)) & ((uint64_t(1) << 2 * LANE_BITS) - 1);
 }
 
 bool
@@ -63,25 +73,15 @@ Tiles::has_color(Tile color) const {
     if (!color) {
         throw std::range_error("Can't call with null tile color");
     }
-    return quantities[int(color)] > 0;
-}
-
-Tiles&
-Tiles::operator+=(Tiles other) {
-    for (int i = 0; i < TILE_TYPES; i++) {
-        this->quantities[i] += other.quantities[i];
-    }
-    return *this;
+    return get_unchecked(color) > 0;
 }
 
 Tiles&
 Tiles::operator-=(Tiles other) {
-    if (*this >= other) {
+    if (!(*this >= other)) {
         throw std::invalid_argument("Not enough Tiles to substract");
     }
-    for (int i = 0; i < TILE_TYPES; i++) {
-        this->quantities[i] -= other.quantities[i];
-    }
+    packed -= other.packed;
     return *this;
 }
 
@@ -99,40 +99,14 @@ Tiles::operator-(Tiles other) const {
     return t;
 }
 
-bool
-operator==(Tiles left, Tiles right) {
-    return left.quantities == right.quantities;
-}
-
-bool
-operator!=(Tiles left, Tiles right) {
-    return !(left == right);
-}
-
-bool
-operator<=(Tiles left, Tiles right) {
-    for (int i = 0; i < TILE_TYPES; i++) {
-        if (left.quantities[i] > right.quantities[i]) {
-            return false;
-        }
-    }
-    return true;
-}
-
-bool
-operator>=(Tiles left, Tiles right) {
-    for (int i = 0; i < TILE_TYPES; i++) {
-        if (left.quantities[i] < right.quantities[i]) {
-            return false;
-        }
-    }
-    return true;
-}
-
 Tiles&
 Tiles::operator+=(Tile tile) {
     if (bool(tile)) {
-        this->quantities[int(tile)]++;
+        ushort quantity = get_unchecked(tile);
+        if (quantity == MAX_QUANTITY) {
+            throw_too_many(quantity + 1);
+        }
+        set_unchecked(tile, quantity + 1);
     }
     return *this;
 }
@@ -140,10 +114,11 @@ Tiles::operator+=(Tile tile) {
 Tiles&
 Tiles::operator-=(Tile tile) {
     if (bool(tile)) {
-        if (this->quantities[int(tile)] == 0) {
+        ushort quantity = get_unchecked(tile);
+        if (quantity == 0) {
             throw std::invalid_argument("Not enough Tiles to substract");
         }
-        this->quantities[int(tile)]--;
+        set_unchecked(tile, quantity - 1);
     }
     return *this;
 }
@@ -167,7 +142,7 @@ Tiles::operator-(Tile tile) const {
 std::ostream&
 operator<<(std::ostream& os, Tiles tiles) {
     bool first = true;
-    for (uint v : tiles.quantities) {
+    for (uint v : tiles.get_quantities()) {
         if (first) {
             first = false;
             os << '[';
@@ -195,7 +170,7 @@ Tiles::letter_str() const {
     std::ostringstream os;
     for (ushort tile_value = 0; tile_value < TILE_TYPES; tile_value++) {
         Tile tile = Tile(tile_value);
-        for (int i = 0; i < quantities[int(tile)]; i++) {
+        for (int i = 0; i < get_unchecked(tile); i++) {
             os << tile.letter();
         }
     }
@@ -209,14 +184,25 @@ Tiles::repr() const {
     return os.str();
 }
 
-const std::array<ushort, TILE_TYPES>&
+std::array<ushort, TILE_TYPES>
 Tiles::get_quantities() const {
+    std::array<ushort, TILE_TYPES> quantities;
+    for (ushort color = 0; color < TILE_TYPES; color++) {
+        quantities[color] = get_unchecked(Tile(color));
+    }
     return quantities;
 }
 
 void
-Tiles::set_quantities(std::array<ushort, TILE_TYPES> _quantities) {
-    quantities = _quantities;
+Tiles::set_quantities(std::array<ushort, TILE_TYPES> quantities) {
+    uint64_t result = 0;
+    for (ushort color = 0; color < TILE_TYPES; color++) {
+        if (quantities[color] > MAX_QUANTITY) {
+            throw_too_many(quantities[color]);
+        }
+        result |= uint64_t(quantities[color]) << (color * LANE_BITS);
+    }
+    packed = result;
 }
 
 const Tiles Tiles::ZERO = Tiles();
\ No newline at end of file
@@ -2,15 +2,32 @@
 #define TILES_HPP
 
 #include <array>
+#include <cstdint>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "global.hpp"
 #include "tile.hpp"
 
+// Quantity of each tile color, packed in a single word with one lane of
+// LANE_BITS bits per color. The highest bit of each lane is kept clear,
+// so that all lanes are added, subtracted and compared at once
 class Tiles {
-protected:
-    std::array<ushort, TILE_TYPES> quantities;
+public:
+    constexpr static ushort LANE_BITS = 12;
+    constexpr static ushort MAX_QUANTITY = (1 << (LANE_BITS - 1)) - 1;
+
+private:
+    constexpr static uint64_t LANE = (uint64_t(1) << LANE_BITS) - 1;
+    // Lowest and highest bit of each lane
+    constexpr static uint64_t ONES = ((uint64_t(1) << (TILE_TYPES * LANE_BITS)) - 1) / LANE;
+    constexpr static uint64_t GUARDS = ONES << (LANE_BITS - 1);
+
+    uint64_t packed;
+
+    static ushort shift(Tile tile);
+    [[noreturn]] static void throw_too_many(int quantity);
 
 public:
     // Constructors
@@ -18,15 +35,19 @@ public:
     Tiles(Tile tile);
     Tiles(Tile tile, int count);
     Tiles(const std::vector<ushort>& tiles);
-    Tiles(const Tiles& tiles);
-    virtual ~Tiles() = default;
 
     // Utils
-    ushort& operator[](Tile tile);
+    ushort operator[](Tile tile) const;
+    void set(Tile tile, ushort quantity);
+    // Unchecked access, for tiles known not to be Tile::NONE
+    ushort get_unchecked(Tile tile) const noexcept;
+    void set_unchecked(Tile tile, ushort quantity) noexcept;
     ushort total() const;
     constexpr ushort size() const { return TILE_TYPES; }
     bool is_empty() const;
     bool has_color(const Tile color) const;
+    // Bit "color" is set if there is at least one tile of this color
+    uint32_t color_mask() const;
 
     friend bool operator==(Tiles left, Tiles right);
     friend bool operator!=(Tiles left, Tiles right);
@@ -43,19 +64,86 @@ public:
     Tiles& operator+=(Tile tile);
     Tiles& operator-=(Tile tile);
 
-    friend bool operator<=(Tiles left, ushort right);
-    friend bool operator>=(Tiles left, ushort right);
-
     // Reading
     friend std::ostream& operator<<(std::ostream& os, Tiles tiles);
-    std::string virtual str() const;
-    std::string virtual letter_str() const;
-    std::string virtual repr() const;
+    std::string str() const;
+    std::string letter_str() const;
+    std::string repr() const;
 
-    const std::array<ushort, TILE_TYPES>& get_quantities() const;
+    std::array<ushort, TILE_TYPES> get_quantities() const;
     void set_quantities(std::array<ushort, TILE_TYPES> quantities);
 
     static const Tiles ZERO;
 };
 
+static_assert(TILE_TYPES * Tiles::LANE_BITS < 64, "Tiles lanes should fit in 64 bits");
+static_assert(std::is_trivially_copyable<Tiles>::value, "Tiles should be trivially copyable");
+
+// Tiles are read and updated by every action, so these are inlined
+
+inline ushort
+Tiles::shift(Tile tile) {
+    return ushort(tile) * LANE_BITS;
+}
+
+inline Tiles::Tiles()
+  : packed(0) {}
+
+inline ushort
+Tiles::get_unchecked(Tile tile) const noexcept {
+    return (packed >> shift(tile)) & LANE;
+}
+
+inline void
+Tiles::set_unchecked(Tile tile, ushort quantity) noexcept {
+    packed = (packed & ~(LANE << shift(tile))) | (uint64_t(quantity) << shift(tile));
+}
+
+inline bool
+Tiles::is_empty() const {
+    return packed == 0;
+}
+
+inline uint32_t
+Tiles::color_mask() const {
+    // The guard bit of a lane survives the subtraction if the lane is not zero
+    uint64_t guards = ((packed | GUARDS) - ONES) & GUARDS;
+    uint32_t mask = 0;
+    for (ushort color = 0; color < TILE_TYPES; color++) {
+        mask |= ((guards >> (color * LANE_BITS + LANE_BITS - 1)) & 1) << color;
+    }
+    return mask;
+}
+
+inline bool
+operator==(Tiles left, Tiles right) {
+    return left.packed == right.packed;
+}
+
+inline bool
+operator!=(Tiles left, Tiles right) {
+    return !(left == right);
+}
+
+inline bool
+operator>=(Tiles left, Tiles right) {
+    // A lane borrows its own guard bit only if it is lower on the left
+    return (((left.packed | Tiles::GUARDS) - right.packed) & Tiles::GUARDS) == Tiles::GUARDS;
+}
+
+inline bool
+operator<=(Tiles left, Tiles right) {
+    return right >= left;
+}
+
+inline Tiles&
+Tiles::operator+=(Tiles other) {
+    uint64_t sum = packed + other.packed;
+    if (sum & GUARDS) {
+        throw_too_many(MAX_QUANTITY + 1);
+    }
+    packed = sum;
+    return *this;
+}
+
 #endif //TILES_HPP
@@ -1,16 +1,55 @@
 #include "wall.hpp"
 
+#include "utils/bits.hpp"
+
 #include <algorithm>
+#include <array>
 #include <numeric>
 #include <sstream>
 
+std::array<WallMasks, TILE_TYPES + 1>
+build_wall_masks() {
+    std::array<WallMasks, TILE_TYPES + 1> result{};
+    for (ushort n = 1; n <= TILE_TYPES; n++) {
+        WallMasks& masks = result[n];
+        for (ushort y = 0; y < n; y++) {
+            for (ushort x = 0; x < n; x++) {
+                uint32_t bit = 1u << (x + y * n);
+                masks.lines[y] |= bit;
+                masks.columns[x] |= bit;
+            }
+        }
+        // Same layout as Wall::line_color_x
+        for (ushort color = 0; color < TILE_TYPES; color++) {
+            for (ushort y = 0; y < n; y++) {
+                masks.colors[color] |= 1u << ((y + color) % n + y * n);
+            }
+        }
+    }
+    return result;
+}
+
+const WallMasks&
+WallMasks::of(ushort tile_types) {
+    static const std::array<WallMasks, TILE_TYPES + 1> all_masks = build_wall_masks();
+    if (tile_types == 0 || tile_types > TILE_TYPES) {
+        throw std::invalid_argument("Tile types should be between 1 and " + std::to_string(TILE_TYPES));
+    }
+    return all_masks[tile_types];
+}
+
+
 Wall::Wall(const std::shared_ptr<const Rules>& rules)
   : rules(rules)
-  , placed(rules->tile_types_2(), Tile::NONE) {}
+  , placed(rules->tile_types_2(), Tile::NONE)
+  , mask(0)
+  , masks(&WallMasks::of(rules->tile_types)) {}
 
 Wall::Wall(const Wall& wall)
   : rules(wall.rules)
-  , placed(wall.placed) {}
+  , placed(wall.placed)
+  , mask(wall.mask)
+  , masks(wall.masks) {}
 
 
 Wall&
@@ -19,6 +58,7 @@ Wall::operator=(const Wall& other) {
         throw std::logic_error("Cannot assign wall with different rules");
     }
     placed = other.placed;
+    mask = other.mask;
     return *this;
 }
 
@@ -51,14 +91,19 @@ Wall::assert_column(ushort column) const {
     }
 }
 
-inline Tile
-Wall::get_tile_at_unsafe(ushort x, ushort y) const {
-    return placed[x - 1 + (y - 1) * rules->tile_types];
-}
-
-inline void
+void
 Wall::set_tile_at_unsafe(ushort x, ushort y, Tile tile) {
     placed[x - 1 + (y - 1) * rules->tile_types] = tile;
+    if (tile) {
+        mask |= bit_at(x, y);
+    } else {
+        mask &= ~bit_at(x, y);
+    }
+}
+
+inline uint32_t
+Wall::bit_at(ushort x, ushort y) const {
+    return 1u << (x - 1 + (y - 1) * rules->tile_types);
 }
 
 // Methods
@@ -66,18 +111,21 @@ Wall::set_tile_at_unsafe(ushort x, ushort y, Tile tile) {
 void
 Wall::clear() {
     placed.assign(rules->tile_types_2(), Tile::NONE);
+    mask = 0;
 }
 
 bool
 Wall::get_placed_at(ushort x, ushort y) const {
-    return bool(get_tile_at(x, y));
+    assert_line(y);
+    assert_column(x);
+    return mask & bit_at(x, y);
 }
 
 Tile
 Wall::get_tile_at(ushort x, ushort y) const {
     assert_line(y);
     assert_column(x);
-    return get_tile_at_unsafe(x, y);
+    return get_tile_at_unchecked(x, y);
 }
 
 Tile
@@ -97,6 +145,11 @@ vec_tile_to_bool(std::vector<Tile>::const_iterator begin, std::vector<Tile>::con
     return result;
 }
 
+uint32_t
+Wall::get_placed_mask() const {
+    return mask;
+}
+
 std::vector<bool>
 Wall::get_placed() const {
     return vec_tile_to_bool(placed.begin(), placed.end());
@@ -140,7 +193,7 @@ Wall::line_has_color(ushort line, Tile color) const {
     // std::vector<Tile>::const_iterator slice_start = placed.begin() + (line - 1) * rules->tile_types;
     // std::vector<Tile>::const_iterator slice_end = slice_start + rules->tile_types;
     // return std::find(slice_start, slice_end, color) != slice_end;
-    return get_tile_at(line_color_x(line, color), line) != Tile::NONE;
+    return mask & bit_at(line_color_x(line, color), line);
 }
 
 ushort
@@ -152,16 +205,9 @@ Wall::line_color_x(ushort line, Tile color) const {
 ushort
 Wall::completed_column_count() const {
     int count = 0;
-    for (int column = 1; column <= rules->tile_types; column++) {
-        int y;
-        for (y = 1; y <= rules->tile_types; y++) {
-            if (!get_tile_at_unsafe(column, y)) {
-                break;
-            }
-        }
-        if (y > rules->tile_types) {
-            count++;
-        }
+    for (int column = 0; column < rules->tile_types; column++) {
+        uint32_t column_mask = masks->columns[column];
+        count += (mask & column_mask) == column_mask;
     }
     return count;
 }
@@ -169,28 +215,15 @@ Wall::completed_column_count() const {
 ushort
 Wall::column_tile_count(ushort column) const {
     assert_column(column);
-    int count = 0;
-    for (int y = 1; y <= rules->tile_types; y++) {
-        if (get_tile_at_unsafe(column, y)) {
-            count++;
-        }
-    }
-    return count;
+    return popcount(mask & masks->columns[column - 1]);
 }
 
 ushort
 Wall::completed_line_count() const {
     int count = 0;
-    for (int line = 1; line <= rules->tile_types; line++) {
-        int x;
-        for (x = 1; x <= rules->tile_types; x++) {
-            if (!get_tile_at_unsafe(x, line)) {
-                break;
-            }
-        }
-        if (x > rules->tile_types) {
-            count++;
-        }
+    for (int line = 0; line < rules->tile_types; line++) {
+        uint32_t line_mask = masks->lines[line];
+        count += (mask & line_mask) == line_mask;
     }
     return count;
 }
@@ -198,43 +231,23 @@ Wall::completed_line_count() const {
 ushort
 Wall::line_tile_count(ushort line) const {
     assert_line(line);
-    int count = 0;
-    for (int x = 1; x <= rules->tile_types; x++) {
-        if (get_tile_at_unsafe(x, line)) {
-            count++;
-        }
-    }
-    return count;
+    return popcount(mask & masks->lines[line - 1]);
 }
 
 ushort
 Wall::completed_type_count() const {
     int count = 0;
     for (int type = 0; type < rules->tile_types; type++) {
-        Tile tile = Tile(type);
-        int line;
-        for (line = 1; line <= rules->tile_types; line++) {
-            if (!line_has_color(line, tile)) {
-                break;
-            }
-        }
-        if (line > rules->tile_types) {
-            count++;
-        }
+        uint32_t color_mask = masks->colors[type];
+        count += (mask & color_mask) == color_mask;
     }
     return count;
 }
 
 ushort
 Wall::type_tile_count(ushort type) const {
-    int count = 0;
     Tile tile = Tile(type);
-    for (int line = 1; line <= rules->tile_types; line++) {
-        if (line_has_color(line, tile)) {
-            count++;
-        }
-    }
-    return count;
+    return popcount(mask & masks->colors[int(tile)]);
 }
 
 ushort
@@ -247,34 +260,15 @@ Wall::final_score_bonus() const {
 
 // Scoring
 
+// Counts every tile on the line and column of (x, y),
+// including the one at (x, y) even if it isn't placed yet
 ushort
 Wall::score_for_placing(ushort x, ushort y) {
-    ushort width = 1;
-    ushort height = 1;
-    // left
-    for (int left = x - 1; left > 0; left--) {
-        if (get_tile_at_unsafe(left, y)) {
-            width++;
-        }
-    }
-    // right
-    for (int right = x + 1; right <= rules->tile_types; right++) {
-        if (get_tile_at_unsafe(right, y)) {
-            width++;
-        }
-    }
-    // up
-    for (int up = y - 1; up > 0; up--) {
-        if (get_tile_at_unsafe(x, up)) {
-            height++;
-        }
-    }
-    // down
-    for (int down = y + 1; down <= rules->tile_types; down++) {
-        if (get_tile_at_unsafe(x, down)) {
-            height++;
-        }
-    }
+    assert_line(y);
+    assert_column(x);
+    uint32_t with_tile = mask | bit_at(x, y);
+    ushort width = popcount(with_tile & masks->lines[y - 1]);
+    ushort height = popcount(with_tile & masks->columns[x - 1]);
     if (width != 1 && height != 1) {
         return width + height;
     }
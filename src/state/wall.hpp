@@ -1,21 +1,37 @@
 #ifndef WALL_HPP
 #define WALL_HPP
 
+#include <cstdint>
 #include <vector>
 
 #include "global.hpp"
 #include "rules/rules.hpp"
 #include "tiles.hpp"
 
+// Bit masks of the cells of each line, column and color of a wall,
+// where the cell (x, y) is the bit (x - 1) + (y - 1) * tile_types
+struct WallMasks {
+    uint32_t lines[TILE_TYPES];
+    uint32_t columns[TILE_TYPES];
+    uint32_t colors[TILE_TYPES];
+
+    static const WallMasks& of(ushort tile_types);
+};
+
 class Wall {
+    friend struct CompactState;
+
 private:
     const std::shared_ptr<const Rules> rules;
     std::vector<Tile> placed;
+    // Bitboard of placed tiles, see WallMasks
+    uint32_t mask;
+    const WallMasks* masks;
 
     void assert_line(ushort line) const;
     void assert_column(ushort column) const;
-    Tile get_tile_at_unsafe(ushort x, ushort y) const;
     void set_tile_at_unsafe(ushort x, ushort y, Tile tile);
+    uint32_t bit_at(ushort x, ushort y) const;
 
 public:
     Wall(const std::shared_ptr<const Rules>& rule);
@@ -29,8 +45,11 @@ public:
 
     bool get_placed_at(ushort x, ushort y) const;
     Tile get_tile_at(ushort x, ushort y) const;
+    // Unchecked version, for cells known to be on the wall
+    Tile get_tile_at_unchecked(ushort x, ushort y) const noexcept;
     Tile color_at(ushort x, ushort y) const;
 
+    uint32_t get_placed_mask() const;
     std::vector<bool> get_placed() const;
     const std::vector<Tile>& get_tiles() const;
     std::vector<std::vector<bool>> get_placed_array() const;
@@ -38,6 +57,7 @@ public:
 
     bool line_has_color(ushort line, Tile color) const;
     ushort line_color_x(ushort line, Tile color) const;
+    bool line_has_color_unchecked(ushort line, Tile color) const noexcept;
 
     ushort completed_column_count() const;
     ushort column_tile_count(ushort column) const;
@@ -60,4 +80,15 @@ public:
     std::string repr() const;
 };
 
+inline Tile
+Wall::get_tile_at_unchecked(ushort x, ushort y) const noexcept {
+    return placed[x - 1 + (y - 1) * rules->tile_types];
+}
+
+inline bool
+Wall::line_has_color_unchecked(ushort line, Tile color) const noexcept {
+    ushort n = rules->tile_types;
+    return mask & (1u << ((line - 1 + ushort(color)) % n + (line - 1) * n));
+}
+
 #endif //WALL_HPP
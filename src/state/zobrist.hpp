@@ -0,0 +1,69 @@
+#ifndef ZOBRIST_HPP
+#define ZOBRIST_HPP
+
+#include <array>
+#include <cstdint>
+
+#include "global.hpp"
+#include "tiles.hpp"
+#include "utils/bits.hpp"
+
+// Zobrist hashing of states: the hash is the xor of the keys of each feature
+// at its current value, so that changing a feature only xors its old and new keys.
+// Keys are derived from the feature and the value by mixing, so that values are
+// not bounded by a table, and features at 0 contribute nothing
+struct Zobrist {
+    enum Feature : ushort {
+        PLAYER,
+        CENTER_TOKEN,
+        BAG,
+        BIN,
+        // Followed by each factory
+        SOURCE,
+        PANEL = SOURCE + 1 + MAX_FACTORY_COUNT,
+    };
+
+    // Features of each panel, after PANEL + player * PANEL_FEATURES
+    enum PanelFeature : ushort {
+        SCORE,
+        FLOOR,
+        TOKEN,
+        // Followed by each line
+        LINE,
+        WALL = LINE + TILE_TYPES,
+        PANEL_FEATURES = WALL + TILE_TYPES,
+    };
+
+    static uint64_t key(ushort feature, uint64_t value) {
+        return value == 0 ? 0 : mix64(mix64(feature + 1) ^ value);
+    }
+
+    // Xor of the keys of the old and new values of a feature
+    static uint64_t change(ushort feature, uint64_t old_value, uint64_t new_value) {
+        return key(feature, old_value) ^ key(feature, new_value);
+    }
+
+    static ushort source(ushort pick) {
+        return SOURCE + pick;
+    }
+
+    static ushort panel(ushort player, ushort feature) {
+        return PANEL + player * PANEL_FEATURES + feature;
+    }
+
+    // Values
+
+    static uint64_t tiles(const std::array<ushort, TILE_TYPES>& quantities) {
+        uint64_t value = 0;
+        for (ushort color = 0; color < TILE_TYPES; color++) {
+            value |= uint64_t(quantities[color]) << (color * Tiles::LANE_BITS);
+        }
+        return value;
+    }
+
+    static uint64_t line(ushort color, ushort amount) {
+        return amount == 0 ? 0 : (uint64_t(color + 1) << 8) | amount;
+    }
+};
+
+#endif //ZOBRIST_HPP
@@ -1,10 +1,12 @@
 #include <iostream>
 
 #include <memory>
+#include <sstream>
 #include <unistd.h>
 
 #include "analysis/all_arena.hpp"
 #include "analysis/arena.hpp"
+#include "analysis/arena_network.hpp"
 #include "analysis/pairs_arena.hpp"
 #include "players/first_legal_player.hpp"
 #include "players/monte_carlo_player.hpp"
@@ -14,7 +16,7 @@
 
 void
 print_help() {
-    std::cout << "./ceramic-arena [-h] <players> [-a <arena_type>] [-g <game_per_group>] [-t <thread_limit>] [-z]\n";
+    std::cout << "./ceramic-arena [-h] <players> [-a <arena_type>] [-g <game_per_group>] [-t <thread_limit>] [-b <batch_size>] [-k <games_per_task>] [-d] [-e <stopping_rule>] [-s <seed>] [-o <checkpoint> [-i <seconds>] [-r]] [-f <records>] [-c <address> [-l <local_workers>] | -w <address>] [-z]\n";
     std::cout << '\n';
     std::cout << "    -h : Help, shows this]\n";
     std::cout << '\n';
@@ -27,13 +29,41 @@ print_help() {
               << '\n';
     std::cout << "    -g <game_per_group> : int (default is 1000)\n"
               << "    -t <thread_limit> : int (default is 8)\n"
-              << "    -z : deactivate detailed player analysis\n";
+              << "    -b <batch_size> : int, games played at once by random and first legal players, not with -d or -f (default is 0, one at a time)\n"
+              << "    -k <games_per_task> : int, games of a group played by a thread before taking another task (default is 0, automatic)\n"
+              << "    -d : duplicate deals, each deal is played with the same tiles in all groups, once per rotation of the seats\n"
+              << "    -e <test>[,<margin>[,<error>]] : stop groups of two players once one is better (default margin and error are 0.05, error being the one of each group)\n"
+              << "        s : sequential probability ratio test on the win rate, between fair share -/+ margin\n"
+              << "        c : confidence intervals of the win rate and score difference, checked after each task\n"
+              << "    -s <seed> : int, games are seeded from it and their index, so runs with the same seed have the same results (default is random)\n"
+              << "    -o <checkpoint> : file where the finished games are saved during the run\n"
+              << "    -i <seconds> : int, time between checkpoints (default is 60)\n"
+              << "    -r : resume the run saved in <checkpoint>, with the same players and arena type\n"
+              << "    -f <records> : file where games are written as binary game records, one at a time as -f disables -b\n"
+              << "    -z : deactivate detailed player analysis\n"
+              << '\n'
+              << "    -c <address> : coordinate workers connecting to 'unix:<path>' or '<host>:<port>', which play shards of <games_per_task> games\n"
+              << "    -l <local_workers> : with -c, number of workers forked on this machine (default is 0)\n"
+              << "    -w <address> : play as a worker of the coordinator at <address>, which rejects it unless it has the same players, rules and options\n";
     std::cout << std::endl;
 }
 
 struct ArenaOptions {
     int count;
     int thread_limit;
+    int batch_size;
+    int chunk_size;
+    bool duplicate;
+    StoppingRule stopping;
+    int seed;
+    bool seeded;
+    std::string checkpoint_path;
+    int checkpoint_interval;
+    bool resume;
+    std::string record_path;
+    std::string coordinator;
+    std::string worker;
+    int local_workers;
     bool detailed_player_analysis;
 };
 
@@ -46,7 +76,7 @@ enum ArenaMode {
 bool
 options(int argc, char* argv[], std::vector<std::shared_ptr<Player>>& players, std::shared_ptr<Rules>& rules, ArenaMode& arena_mode, ArenaOptions& arena_options) {
     int option;
-    while ((option = getopt(argc, argv, ":hc:n:a:g:t:z")) != -1) { //get option from the getopt() method
+    while ((option = getopt(argc, argv, ":hc:n:a:g:t:b:k:de:s:o:i:rf:c:l:w:z")) != -1) { //get option from the getopt() method
         switch (option) {
             // Help
             case 'h':
@@ -76,6 +106,66 @@ options(int argc, char* argv[], std::vector<std::shared_ptr<Player>>& players, s
             case 't':
                 arena_options.thread_limit = std::stoi(optarg);
                 break;
+            case 'b':
+                arena_options.batch_size = std::stoi(optarg);
+                break;
+            case 'k':
+                arena_options.chunk_size = std::stoi(optarg);
+                break;
+            case 'd':
+                arena_options.duplicate = true;
+                break;
+            case 'e': {
+                std::istringstream in(optarg);
+                std::string test;
+                std::getline(in, test, ',');
+                if (test == "s") {
+                    arena_options.stopping.test = StoppingRule::SPRT;
+                } else if (test == "c") {
+                    arena_options.stopping.test = StoppingRule::CONFIDENCE;
+                } else {
+                    std::cout << "Unrecognised stopping rule: " << optarg << '\n';
+                    std::cout << "Use 's' for SPRT, 'c' for confidence intervals" << std::endl;
+                    return false;
+                }
+                std::string margin, error;
+                std::getline(in, margin, ',');
+                std::getline(in, error);
+                try {
+                    StoppingRule& stopping = arena_options.stopping;
+                    stopping = StoppingRule(stopping.test, margin.empty() ? stopping.margin : std::stod(margin), error.empty() ? stopping.error : std::stod(error));
+                } catch (const std::exception& e) {
+                    std::cout << "Unrecognised margin or error of the stopping rule: " << optarg << '\n';
+                    std::cout << "Use numbers between 0 and 1 (excluded)" << std::endl;
+                    return false;
+                }
+                break;
+            }
+            case 's':
+                arena_options.seed = std::stoi(optarg);
+                arena_options.seeded = true;
+                break;
+            case 'o':
+                arena_options.checkpoint_path = optarg;
+                break;
+            case 'i':
+                arena_options.checkpoint_interval = std::stoi(optarg);
+                break;
+            case 'r':
+                arena_options.resume = true;
+                break;
+            case 'f':
+                arena_options.record_path = optarg;
+                break;
+            case 'c':
+                arena_options.coordinator = optarg;
+                break;
+            case 'l':
+                arena_options.local_workers = std::stoi(optarg);
+                break;
+            case 'w':
+                arena_options.worker = optarg;
+                break;
             case 'z':
                 arena_options.detailed_player_analysis = false;
                 break;
@@ -104,6 +194,9 @@ options(int argc, char* argv[], std::vector<std::shared_ptr<Player>>& players, s
                 return false;
         }
     }
+    if (arena_options.batch_size > 0 && !arena_options.record_path.empty()) {
+        std::cout << "Games are recorded one at a time, -b is ignored with -f" << std::endl;
+    }
     for (; optind < argc; optind++) {
         std::string arg = argv[optind];
         try {
@@ -130,7 +223,7 @@ main(int argc, char* argv[]) {
     std::vector<std::shared_ptr<Player>> players;
     std::shared_ptr<Rules> rules = std::make_shared<Rules>(*Rules::BASE);
     ArenaMode arena_mode = ArenaMode::ALL;
-    ArenaOptions arena_options{ .count = 1000, .thread_limit = 8, .detailed_player_analysis = true };
+    ArenaOptions arena_options{ .count = 1000, .thread_limit = 8, .batch_size = 0, .chunk_size = 0, .duplicate = false, .stopping = StoppingRule(), .seed = random_seed(), .seeded = false, .checkpoint_path = "", .checkpoint_interval = 60, .resume = false, .record_path = "", .coordinator = "", .worker = "", .local_workers = 0, .detailed_player_analysis = true };
     if (!options(argc, argv, players, rules, arena_mode, arena_options)) {
         return 1;
     }
@@ -150,6 +243,26 @@ main(int argc, char* argv[]) {
     }
     arena->count = arena_options.count;
     arena->thread_limit = arena_options.thread_limit;
+    arena->batch_size = arena_options.batch_size;
+    arena->chunk_size = arena_options.chunk_size;
+    arena->duplicate = arena_options.duplicate;
+    arena->stopping = arena_options.stopping;
+    arena->seed = arena_options.seed;
+    arena->checkpoint_path = arena_options.checkpoint_path;
+    arena->checkpoint_interval = arena_options.checkpoint_interval;
+    arena->record_path = arena_options.record_path;
     arena->detailed_player_analysis = arena_options.detailed_player_analysis;
-    arena->run_print();
+    if (!arena_options.worker.empty()) {
+        ArenaWorker worker(*arena, arena_options.worker);
+        worker.seeded = arena_options.seeded;
+        worker.run();
+    } else if (!arena_options.coordinator.empty()) {
+        ArenaCoordinator(*arena, arena_options.coordinator).run(arena_options.local_workers, arena_options.resume);
+        arena->print();
+    } else if (arena_options.resume) {
+        arena->resume();
+        arena->print();
+    } else {
+        arena->run_print();
+    }
 }
@@ -6,6 +6,7 @@
 
 #include "game/player.hpp"
 #include "players/first_legal_player.hpp"
+#include "players/mcts_player.hpp"
 #include "players/monte_carlo_player.hpp"
 #include "players/random_player.hpp"
 
@@ -142,6 +143,42 @@ public:
             set(player->heuristic.bonus_factor, "hb", "h-bonus");
             set(player->heuristic.leading_factor, "hl", "h-leading");
             set(player->heuristic.penalty_factor, "hp", "h-penalty");
+            set(player->time_budget, "ms", "time", "time_budget");
+            set(player->early_stop, "es", "early_stop");
+            set(player->threads, "t", "threads");
+            std::string parallelism = get(std::string("root"), "p", "parallelism");
+            if (parallelism == "root") {
+                player->parallelism = MonteCarloPlayer::ROOT;
+            } else if (parallelism == "shared") {
+                player->parallelism = MonteCarloPlayer::SHARED;
+            } else {
+                throw std::invalid_argument("Unkown parallelism " + parallelism);
+            }
+            std::string seed = get(std::string(""), "seed");
+            if (seed != "") {
+                player->reseed(_int(seed));
+            }
+            return player;
+        } else if (key == "mcts" || key == "monte-carlo-tree-search") {
+            std::shared_ptr<MctsPlayer> player = std::make_shared<MctsPlayer>();
+            set(player->rollouts, "", "r", "rollouts");
+            set(player->smart, "s", "smart");
+            set(player->c, "c", "C");
+            set(player->until_round, "u", "round", "until_round");
+            set(player->heuristic.bonus_factor, "hb", "h-bonus");
+            set(player->heuristic.leading_factor, "hl", "h-leading");
+            set(player->heuristic.penalty_factor, "hp", "h-penalty");
+            set(player->widening, "w", "widening");
+            int max_nodes = get(int(player->max_nodes), "n", "nodes");
+            if (max_nodes < 1) {
+                throw std::invalid_argument("Maximum number of nodes should be positive");
+            }
+            player->max_nodes = max_nodes;
+            set(player->transpositions, "tt", "transpositions");
+            std::string seed = get(std::string(""), "seed");
+            if (seed != "") {
+                player->reseed(_int(seed));
+            }
             return player;
         } else {
             throw std::invalid_argument("Unkown player type " + key);
@@ -158,14 +195,30 @@ public:
                   << padding << "        <s>, s:<s>, smart:<s> : should the random ai used for generating rollouts be smart\n"
                   << padding << "    rn : Naive Random Player (equivalent to 'r{false}')\n"
                   << padding << "    mc : Monte-Carlo Player\n"
-                  << padding << "      {options} (default is mc = 'mc{1000,s:true,c:1.41,u:true,hb:0.2,hl:0.2,hp:0}')\n"
+                  << padding << "      {options} (default is mc = 'mc{1000,s:true,c:1.41,u:true,hb:0.2,hl:0.2,hp:0,ms:0,es:false,t:1,p:root}')\n"
                   << padding << "        <r>, r:<r>, rollouts:<r> : number of rollouts\n"
                   << padding << "        s:<s>, smart:<s> : should the random ai used for generating rollouts be smart\n"
                   << padding << "        c:<c>, C:<c> : constant 'c' in UBT formula\n"
                   << padding << "        u:<u>, round:<u>, until_round:<u> : should rollouts be stopped at the end of rounds\n"
                   << padding << "        hb:<hb>, h-bonus:<hb> : if <u>, 0 <= <hb> <= 1 is bonus factor of round heuristic\n"
                   << padding << "        hl:<hl>, h-leading:<hl> : if <u>, 0 <= <hl> <= 1 is leading factor of round heuristic\n"
-                  << padding << "        hp:<hp>, h-penalty:<hp> : if <u>, 0 <= <hp> <= 1 is penalty factor of round heuristic\n";
+                  << padding << "        hp:<hp>, h-penalty:<hp> : if <u>, 0 <= <hp> <= 1 is penalty factor of round heuristic\n"
+                  << padding << "        ms:<ms>, time:<ms>, time_budget:<ms> : if > 0, rollouts are run for <ms> milliseconds instead of <r> times\n"
+                  << padding << "        es:<es>, early_stop:<es> : stop once the lower Hoeffding bound of the best action is above the upper bounds of all others\n"
+                  << padding << "        t:<t>, threads:<t> : number of threads running rollouts, 0 uses all cores\n"
+                  << padding << "        p:<p>, parallelism:<p> : if <t> != 1, 'root' (merged statistics per thread) or 'shared' (shared statistics)\n"
+                  << padding << "        seed:<seed> : seed of the player, making its choices reproducible if <p> is 'root' and <ms> is 0\n"
+                  << padding << "    mcts : Monte-Carlo Tree Search Player, keeping its tree between moves\n"
+                  << padding << "      {options} (default is mcts = 'mcts{1000,s:true,c:1.41,u:true,hb:0.2,hl:0.2,hp:0,w:0.5,n:100000,tt:true}')\n"
+                  << padding << "        <r>, r:<r>, rollouts:<r> : number of rollouts\n"
+                  << padding << "        s:<s>, smart:<s> : should the tree and the random ai used for generating rollouts be smart\n"
+                  << padding << "        c:<c>, C:<c> : constant 'c' in UCT formula\n"
+                  << padding << "        u:<u>, round:<u>, until_round:<u> : should rollouts be stopped at the end of rounds\n"
+                  << padding << "        hb:<hb>, hl:<hl>, hp:<hp> : if <u>, factors of round heuristic (see mc)\n"
+                  << padding << "        w:<w>, widening:<w> : a tile draw visited n times is sampled into at most 1 + n^<w> outcomes\n"
+                  << padding << "        n:<n>, nodes:<n> : maximum number of nodes in the tree\n"
+                  << padding << "        tt:<tt>, transpositions:<tt> : should nodes of the same state share their statistics\n"
+                  << padding << "        seed:<seed> : seed of the player, making its choices reproducible\n";
         std::cout << std::flush;
     }
 };
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef BITS_HPP
+#define BITS_HPP
+
+#include <cstdint>
+
+inline int
+popcount(uint32_t bits) {
+    return __builtin_popcount(bits);
+}
+
+inline int
+popcount(uint64_t bits) {
+    return __builtin_popcountll(bits);
+}
+
+// Index of the lowest set bit, bits should not be 0
+inline int
+lowest_bit(uint32_t bits) {
+    return __builtin_ctz(bits);
+}
+
+// Finalizer of splitmix64, a bijection whose outputs look random
+inline uint64_t
+mix64(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+#endif //BITS_HPP
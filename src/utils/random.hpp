@@ -1,12 +1,69 @@
 #ifndef RANDOM_HPP
 #define RANDOM_HPP
 
+#include <cstdint>
 #include <iostream>
 #include <limits>
 #include <random>
 #include <time.h>
 
+// xoshiro128++ by David Blackman and Sebastiano Vigna, a much smaller
+// and faster generator than std::mt19937, with 32 bits outputs
+class Xoshiro128 {
+private:
+    uint32_t s[4];
+
+    static uint32_t rotl(uint32_t x, int k) {
+        return (x << k) | (x >> (32 - k));
+    }
+
+public:
+    typedef uint32_t result_type;
+
+    explicit Xoshiro128(uint64_t seed = 0) {
+        this->seed(seed);
+    }
+
+    // State is filled with splitmix64, so that close seeds give unrelated sequences
+    void seed(uint64_t seed) {
+        for (int i = 0; i < 4; i += 2) {
+            uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            z = z ^ (z >> 31);
+            s[i] = uint32_t(z);
+            s[i + 1] = uint32_t(z >> 32);
+        }
+    }
+
+    static constexpr result_type min() {
+        return 0;
+    }
+
+    static constexpr result_type max() {
+        return std::numeric_limits<uint32_t>::max();
+    }
+
+    result_type operator()() {
+        const uint32_t result = rotl(s[0] + s[3], 7) + s[0];
+        const uint32_t t = s[1] << 9;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 11);
+        return result;
+    }
+};
+
+// Generator used by games and players, chosen at compile time
+#ifdef CERAMIC_XOSHIRO
+typedef Xoshiro128 rng;
+#else
 typedef std::mt19937 rng;
+#endif
+
 static std::random_device global_random_device{};
 // Adds time because std::random_device can be deterministic for some compilers
 static int global_random_offset = time(NULL);
@@ -24,4 +81,21 @@ random_range(rng& randomness, ushort_range& range, ushort min = 0, ushort max =
     return range(randomness, ushort_range_params(min, max - 1));
 }
 
-#endif //RANDOM_HPP
\ No newline at end of file
+// Uniform integer in [0, n), with Lemire's multiply-and-shift method,
+// which only needs a division in rare cases to stay unbiased
+inline uint32_t
+random_below(rng& randomness, uint32_t n) {
+    static_assert(rng::min() == 0 && rng::max() == std::numeric_limits<uint32_t>::max(), "Generator should give 32 random bits");
+    uint64_t m = uint64_t(uint32_t(randomness())) * n;
+    uint32_t low = uint32_t(m);
+    if (low < n) {
+        uint32_t threshold = -n % n;
+        while (low < threshold) {
+            m = uint64_t(uint32_t(randomness())) * n;
+            low = uint32_t(m);
+        }
+    }
+    return m >> 32;
+}
+
+#endif //RANDOM_HPP
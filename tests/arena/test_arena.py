@@ -1,6 +1,11 @@
+import socket
+import threading
+import time
+
+import numpy as np
 import pytest
-from ceramic.players import RandomPlayer
-from ceramic.arena import Arena, AllArena, PairsArena
+from ceramic.players import FirstLegalPlayer, RandomPlayer
+from ceramic.arena import Arena, AllArena, ArenaCoordinator, ArenaWorker, PairsArena, StoppingRule, run_games
 from ceramic.rules import Rules
 
 
@@ -21,3 +26,221 @@ def test_pair_arenas(rules):
     arena.count = 1
     arena.run()
     arena.print()
+
+
+@pytest.mark.parametrize("rules", [Rules.MINI, Rules.BASE])
+def test_batch_arena(rules):
+    players = [FirstLegalPlayer()] + [RandomPlayer(smart=p % 2 == 0) for p in range(0, rules.player_count)]
+    arena = AllArena(rules, players)
+    arena.count = 10
+    arena.batch_size = 4
+    arena.run()
+    arena.print()
+    # Each game has one winner
+    groups = sum(line[0] for line in arena.results) // rules.player_count
+    assert sum(line[1] for line in arena.results) == groups * arena.count
+
+
+@pytest.mark.parametrize("chunk_size", [0, 3])
+def test_pair_arena_tasks(chunk_size):
+    rules = Rules.BASE
+    players = [RandomPlayer(), RandomPlayer(), FirstLegalPlayer()]
+    arena = PairsArena(rules, players)
+    arena.count = 10
+    arena.thread_limit = 3
+    arena.chunk_size = chunk_size
+    arena.run()
+    # Groups split in tasks still have one winner per game
+    wins = sum(line[3 * column] for line in arena.results for column in range(len(line) // 3))
+    groups = 3 * (rules.player_count - 1)
+    assert wins == groups * arena.count
+
+
+def test_arena_checkpoint(tmp_path):
+    rules = Rules.BASE
+    players = [RandomPlayer(), RandomPlayer(smart=False), FirstLegalPlayer()]
+    arena = PairsArena(rules, players)
+    arena.count = 12
+    arena.chunk_size = 5
+    arena.seed = 42
+    arena.run()
+    results = arena.results
+    # Games are seeded from the arena seed, whatever the threads
+    arena.thread_limit = 1
+    arena.run()
+    assert arena.results == results
+    # A finished checkpoint has nothing left to play
+    arena.checkpoint_path = str(tmp_path / "arena.ckpt")
+    arena.run()
+    arena.seed = 7
+    arena.resume()
+    assert arena.seed == 42
+    assert arena.results == results
+    # Runs with other settings cannot resume it
+    arena.duplicate = True
+    with pytest.raises(RuntimeError):
+        arena.resume()
+    arena.duplicate = False
+    arena.stopping = StoppingRule(StoppingRule.Test.SPRT)
+    with pytest.raises(RuntimeError):
+        arena.resume()
+
+
+@pytest.mark.parametrize("test", [StoppingRule.Test.SPRT, StoppingRule.Test.CONFIDENCE])
+def test_arena_stopping_rule(test):
+    rules = Rules.BASE
+    players = [RandomPlayer(), RandomPlayer(smart=False)]
+    arena = PairsArena(rules, players)
+    arena.count = 400
+    arena.chunk_size = 20
+    arena.stopping = StoppingRule(test, error=0.01)
+    arena.run()
+    arena.print()
+    # The smart player wins so often that groups stop early, still with one winner per game
+    groups = rules.player_count - 1
+    wins = sum(line[3 * column] for line in arena.results for column in range(len(line) // 3))
+    assert arena.games_saved() > 0
+    assert wins + arena.games_saved() == groups * arena.count
+
+
+def test_arena_stopping_rule_error():
+    rules = Rules.BASE
+    players = [RandomPlayer(), RandomPlayer()]
+    arena = PairsArena(rules, players)
+    arena.count = 200
+    arena.chunk_size = 2
+    arena.thread_limit = 1
+    arena.seed = 0
+    # Equal players are not told apart, though the rule is checked after each of the 100 tasks of a group
+    arena.stopping = StoppingRule(StoppingRule.Test.CONFIDENCE)
+    arena.run()
+    assert arena.games_saved() == 0
+    for margin, error in [(0, 0.05), (0.05, 1), (-0.1, 0.05), (0.05, 0)]:
+        with pytest.raises(ValueError):
+            StoppingRule(StoppingRule.Test.CONFIDENCE, margin, error)
+
+
+def test_duplicate_arena():
+    rules = Rules.BASE
+    players = [RandomPlayer(), FirstLegalPlayer()]
+    arena = PairsArena(rules, players)
+    arena.count = 4 * rules.player_count
+    arena.duplicate = True
+    arena.seed = 3
+    arena.run()
+    arena.print()
+    results = arena.results
+    # Deals do not depend on how groups are split in tasks
+    arena.chunk_size = 3
+    arena.run()
+    assert arena.results == results
+    arena.count += 1
+    with pytest.raises(RuntimeError):
+        arena.run()
+
+
+def arena_workers(count, seed=42, players=None):
+    players = players or [RandomPlayer(), RandomPlayer(smart=False), FirstLegalPlayer()]
+    arena = PairsArena(Rules.BASE, players)
+    arena.count = count
+    arena.chunk_size = 5
+    arena.seed = seed
+    return arena
+
+
+def run_worker(arena, address, errors, seeded=False):
+    worker = ArenaWorker(arena, address)
+    worker.seeded = seeded
+    try:
+        worker.run()
+    except RuntimeError as error:
+        errors.append(error)
+
+
+def test_arena_workers(tmp_path):
+    arena = arena_workers(12)
+    arena.run()
+    results = arena.results
+    # Shards played by forked workers give the results of a local run
+    address = "unix:" + str(tmp_path / "forked.sock")
+    coordinated = arena_workers(12)
+    ArenaCoordinator(coordinated, address).run(local_workers=2)
+    assert coordinated.results == results
+    # Workers with other players, options or seeds are rejected, and the remaining one plays every shard
+    address = "unix:" + str(tmp_path / "threads.sock")
+    coordinated = arena_workers(12)
+    coordinator = threading.Thread(target=ArenaCoordinator(coordinated, address).run)
+    coordinator.start()
+    errors = []
+    rejected = [
+        (arena_workers(12, seed=1), True),
+        (arena_workers(13), False),
+        (arena_workers(12, players=[RandomPlayer(), RandomPlayer(), RandomPlayer()]), False),
+    ]
+    for arena, seeded in rejected:
+        run_worker(arena, address, errors, seeded)
+    assert len(errors) == len(rejected)
+    assert all("Rejected" in str(error) for error in errors)
+    # Unless chosen, the seed of workers is the one of the coordinator
+    run_worker(arena_workers(12, seed=1), address, errors)
+    coordinator.join()
+    assert len(errors) == len(rejected)
+    assert coordinated.results == results
+
+
+def test_arena_worker_timeout(tmp_path):
+    path = str(tmp_path / "arena.sock")
+    arena = arena_workers(12)
+    arena.run()
+    results = arena.results
+    coordinated = arena_workers(12)
+    coordinator = ArenaCoordinator(coordinated, "unix:" + path)
+    coordinator.timeout = 1000
+    thread = threading.Thread(target=coordinator.run)
+    thread.start()
+    # A worker that hangs once given a shard is dropped, and its shard played by another one
+    hung = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    for attempt in range(100):
+        try:
+            hung.connect(path)
+            break
+        except OSError:
+            time.sleep(0.1)
+    hung.sendall(("hello - " + ArenaCoordinator.settings(arena) + "\n").encode())
+    received = b""
+    while b"shard" not in received:
+        received += hung.recv(4096)
+    errors = []
+    worker = threading.Thread(target=run_worker, args=(arena_workers(12), "unix:" + path, errors))
+    worker.start()
+    thread.join()
+    worker.join()
+    hung.close()
+    assert not errors
+    assert coordinated.results == results
+
+
+def test_run_games():
+    rules = Rules.BASE
+    players = [RandomPlayer(), FirstLegalPlayer(), RandomPlayer(), RandomPlayer(smart=False)]
+    seeds = np.arange(50, dtype=np.int32)
+    results = run_games(rules, players, seeds, threads=3, actions=True)
+    assert results["scores"].shape == (50, rules.player_count)
+    assert np.all(np.sort(results["orders"], axis=1) == np.arange(rules.player_count))
+    winners = results["winners"]
+    assert np.all(results["scores"][np.arange(50), winners] == results["scores"].max(axis=1))
+    offsets = results["action_offsets"]
+    assert offsets[-1] == results["actions"].shape[0] == results["moves"].sum()
+    # Games only depend on their seed
+    again = run_games(rules, players, seeds[::-1].copy(), threads=1)
+    assert np.array_equal(again["scores"][::-1], results["scores"])
+    assert "actions" not in again
+
+
+def test_run_games_python_player():
+    class PythonPlayer(RandomPlayer):
+        pass
+
+    players = [PythonPlayer()] + [RandomPlayer() for p in range(Rules.BASE.player_count - 1)]
+    with pytest.raises(ValueError):
+        run_games(Rules.BASE, players, [1, 2])
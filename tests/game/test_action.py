@@ -1,5 +1,6 @@
+import numpy as np
 import pytest
-from ceramic.game import Action
+from ceramic.game import Action, Game, GameHelper, action_index, action_index_count, index_action
 from ceramic.state import Tile
 from ceramic.rules import Rules
 
@@ -14,3 +15,40 @@ def test_action_fields(pick, color, place):
     assert action1.pick == pick
     assert action1.color == color
     assert action1.place == place
+
+
+@pytest.mark.parametrize("rules", [Rules.MINI, Rules.BASE])
+def test_action_index(rules):
+    count = action_index_count(rules)
+    assert count == (rules.factory_count + 1) * rules.tile_types * (rules.tile_types + 1)
+    for index in range(count):
+        assert action_index(index_action(index, rules), rules) == index
+    with pytest.raises(ValueError):
+        index_action(count, rules)
+
+
+@pytest.mark.parametrize("rules", [Rules.MINI, Rules.BASE])
+def test_legal_mask(rules):
+    game = Game(rules, 1)
+    game.reset()
+    game.start_round()
+    state = game.state
+    mask = GameHelper.legal_mask(state)
+    assert mask.dtype == np.uint8
+    assert sorted(action_index(action, rules) for action in GameHelper.all_legal(state)) == list(np.flatnonzero(mask))
+    out = np.full(action_index_count(rules), 7, dtype=np.uint8)
+    assert GameHelper.legal_mask(state, out) is out
+    assert np.array_equal(out, mask)
+    assert GameHelper.legal_indices(state) == list(np.flatnonzero(mask))
+
+
+def test_legal_indices_more_players_than_supported():
+    rules = Rules(player_count=8)
+    game = Game(rules, 1)
+    game.reset()
+    game.start_round()
+    # Uint8 masks fit any rules, but bitsets only hold 300 action indices
+    assert action_index_count(rules) > 300
+    assert list(np.flatnonzero(GameHelper.legal_mask(game.state))) == sorted(action_index(action, rules) for action in GameHelper.all_legal(game.state))
+    with pytest.raises(ValueError):
+        GameHelper.legal_indices(game.state)
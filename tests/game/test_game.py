@@ -1,8 +1,10 @@
 import random
+import numpy as np
 import pytest
-from ceramic.game import Game, Action, Player, GameHelper
-from ceramic.players import FirstLegalPlayer, RandomPlayer, MonteCarloPlayer
-from ceramic.state import State, Tile, Tiles
+from ceramic.game import Game, Action, Player, GameHelper, action_index, action_index_count
+from ceramic.players import FirstLegalPlayer, RandomPlayer, MonteCarloPlayer, MctsPlayer, \
+    Evaluator, EvaluationQueue, MlpEvaluator, PolicyValuePlayer
+from ceramic.state import State, StateEncoder, Tile, Tiles
 from ceramic.rules import Rules
 
 
@@ -23,6 +25,8 @@ def test_game_methods(rules):
     game.apply_first_token()
     # Action has to be invalid because center is empty
     assert not game.legal(Action(0, Tile(0), 0))
+    # Actions out of the rules are not legal either
+    assert not game.legal(Action(1, Tile(0), rules.tile_types + 1))
     with pytest.raises(ValueError):
         game.apply(Action(0, Tile(0), 0))
     game.add_players([RandomPlayer() for _ in range(0, rules.player_count)])
@@ -38,7 +42,9 @@ def test_game_methods(rules):
     FirstLegalPlayer(),
     RandomPlayer(smart=False),
     RandomPlayer(),
-    MonteCarloPlayer(rollouts=30)
+    MonteCarloPlayer(rollouts=30),
+    MonteCarloPlayer(rollouts=30, threads=2),
+    MctsPlayer(rollouts=30)
 ])
 def test_game_manual_roll(rules, player):
     game = Game(rules, 0)
@@ -54,6 +60,110 @@ def test_game_manual_roll(rules, player):
     assert is_state_finished(game.state)
 
 
+@pytest.mark.parametrize("rules", [Rules.MINI, Rules.BASE])
+@pytest.mark.parametrize("threads", [1, 3])
+def test_policy_value_player(rules, threads):
+    evaluator = MlpEvaluator(rules, [32], seed=1)
+    queue = EvaluationQueue(evaluator, batch_size=threads)
+    players = [PolicyValuePlayer(queue, rollouts=30, threads=threads) for _ in range(rules.player_count)]
+    game = Game(rules, players)
+    game.roll_game()
+    assert is_state_finished(game.state)
+    assert queue.evaluation_count > 0
+
+
+class RiggedEvaluator(Evaluator):
+    # Uniform priors and values, except for a high prior of the action index "target",
+    # a win for the player who reached the observation "child", and errors after "failing_after" evaluations
+    def __init__(self, rules, target=None, child=None, failing_after=None):
+        Evaluator.__init__(self, rules)
+        self.target = target
+        self.child = child
+        self.failing_after = failing_after
+        self.calls = 0
+
+    def evaluate(self, observations):
+        self.calls += 1
+        if self.failing_after is not None and self.calls > self.failing_after:
+            raise RuntimeError("broken evaluator")
+        rules = self.rules
+        policies = np.zeros((len(observations), action_index_count(rules)), dtype=np.float32)
+        values = np.full((len(observations), rules.player_count), 1 / rules.player_count, dtype=np.float32)
+        if self.target is not None:
+            policies[:, self.target] = 100
+        for row, observation in enumerate(observations):
+            if self.child is not None and np.array_equal(observation, self.child):
+                # Values are ordered from the player to play, so the one who played is the last
+                values[row] = 0
+                values[row, -1] = 1
+        return policies, values
+
+
+@pytest.mark.parametrize("rules", [Rules.MINI, Rules.BASE])
+@pytest.mark.parametrize("threads", [1, 3])
+def test_policy_value_player_search(rules, threads):
+    game = Game(rules, 3)
+    game.start_round()
+    state = game.state
+    legal = GameHelper.all_smart_legal(state)
+    wanted = legal[-1]
+    # The search follows the prior of the evaluator
+    evaluator = RiggedEvaluator(rules, target=action_index(wanted, rules))
+    player = PolicyValuePlayer(evaluator, rollouts=20, threads=threads)
+    assert player.play(state) == wanted
+    # The root is evaluated before the rollouts
+    assert player.get_root_visits() == 20 + 1
+    # And its values, once every action was tried
+    child = State(state)
+    GameHelper.apply(wanted, child)
+    child.next_player()
+    evaluator = RiggedEvaluator(rules, child=StateEncoder(rules).encode(child).ravel())
+    player = PolicyValuePlayer(evaluator, rollouts=2 * len(legal), threads=threads)
+    assert player.play(state) == wanted
+    assert player.get_root_visits() == 2 * len(legal) + 1
+
+
+@pytest.mark.parametrize("threads", [1, 3])
+@pytest.mark.parametrize("failing_after", [0, 3])
+def test_policy_value_player_evaluator_error(threads, failing_after):
+    rules = Rules.BASE
+    game = Game(rules, 3)
+    game.start_round()
+    evaluator = RiggedEvaluator(rules, failing_after=failing_after)
+    player = PolicyValuePlayer(evaluator, rollouts=50, threads=threads)
+    # Errors reach the caller, instead of leaving threads waiting for the evaluation
+    with pytest.raises(RuntimeError, match="broken evaluator"):
+        player.play(game.state)
+
+
+def test_policy_value_player_python_evaluator_in_game():
+    rules = Rules.MINI
+    evaluator = RiggedEvaluator(rules)
+    players = [PolicyValuePlayer(evaluator, rollouts=10, threads=3) for _ in range(rules.player_count)]
+    game = Game(rules, players)
+    # Game.roll_game holds the GIL, so the searches stay on its thread instead of waiting for it
+    game.roll_game()
+    assert is_state_finished(game.state)
+    assert evaluator.calls > 0
+
+
+def test_mlp_evaluator(tmp_path):
+    rules = Rules.BASE
+    evaluator = MlpEvaluator(rules, [16, 8], seed=2)
+    observations = np.zeros((5, evaluator.weights(0).shape[0]), dtype=np.float32)
+    policies, values = evaluator.evaluate(observations)
+    assert policies.shape == (5, action_index_count(rules))
+    assert np.allclose(values.sum(axis=1), 1)
+    # Weights are views, and survive a save
+    evaluator.biases(evaluator.layer_count - 1)[0] = 50
+    path = str(tmp_path / "mlp.bin")
+    evaluator.save(path)
+    loaded = MlpEvaluator(rules, path)
+    assert np.allclose(loaded.evaluate(observations)[1][:, 0], 1)
+    with pytest.raises(ValueError):
+        MlpEvaluator(Rules.MINI, path)
+
+
 @pytest.mark.parametrize("rules", [Rules.MINI, Rules.BASE])
 def test_game_roll_with_python_player(rules):
     class PythonRandomPlayer(Player):
@@ -70,3 +180,133 @@ def test_game_roll_with_python_player(rules):
         [python_random_player for _ in range(0, rules.player_count)])
     game.roll_game()
     assert is_state_finished(game.state)
+
+
+@pytest.mark.parametrize("rules", [Rules.MINI, Rules.BASE])
+def test_game_legal_masks(rules):
+    game = Game(rules, 0)
+    game.enable_legal_masks()
+    player = RandomPlayer(0)
+    while not game.state.is_game_finished():
+        game.start_round()
+        while not game.state.is_round_finished():
+            state = State(game.state)
+            assert state.has_legal_masks()
+            state.enable_legal_masks(False)
+            assert GameHelper.all_legal(game.state) == GameHelper.all_legal(state)
+            assert GameHelper.all_smart_legal(game.state) == GameHelper.all_smart_legal(state)
+            game.apply(player.play(game.state))
+            game.next_player()
+        game.end_round()
+
+
+def test_game_more_players_than_supported():
+    # 17 factories give more legal actions than the capacity of an ActionList
+    rules = Rules(player_count=8)
+    game = Game(rules, 0)
+    player = RandomPlayer(0, smart=False)
+    most_legal = 0
+    while not game.state.is_game_finished():
+        game.start_round()
+        while not game.state.is_round_finished():
+            legal_actions = GameHelper.all_legal(game.state)
+            most_legal = max(most_legal, len(legal_actions))
+            action = player.play(game.state)
+            assert action in legal_actions
+            game.apply(action)
+            game.next_player()
+        game.end_round()
+    assert most_legal > 300
+
+
+def test_monte_carlo_more_players_than_supported():
+    # States that do not fit in a CompactState are rolled out from copies
+    rules = Rules(player_count=8)
+    game = Game(rules, [MonteCarloPlayer(rollouts=10) for _ in range(0, rules.player_count)])
+    game.roll_game()
+    assert is_state_finished(game.state)
+
+
+@pytest.mark.parametrize("threads", [1, 3])
+def test_monte_carlo_seed(threads):
+    game = Game(Rules.BASE, 0)
+    game.start_round()
+    actions = []
+    for _ in range(0, 2):
+        player = MonteCarloPlayer(rollouts=50, threads=threads)
+        player.reseed(0)
+        actions.append([player.play(game.state) for _ in range(0, 3)])
+    assert actions[0] == actions[1]
+
+
+def test_monte_carlo_shared_parallelism():
+    game = Game(Rules.BASE, 0)
+    player = MonteCarloPlayer(rollouts=30, threads=2)
+    player.parallelism = MonteCarloPlayer.Parallelism.SHARED
+    game.add_players([player for _ in range(0, Rules.BASE.player_count)])
+    game.roll_game()
+    assert is_state_finished(game.state)
+
+
+def test_state_hash_transpositions():
+    rules = Rules()
+    rules.player_count = 2
+    game = Game(rules, 0)
+    game.start_round()
+    state = game.state
+    actions = []
+    for pick, place in [(1, 5), (2, 3), (3, 4)]:
+        tiles = state.factory(pick).tiles
+        color = next(Tile(c) for c in range(0, rules.tile_types) if tiles[Tile(c)] > 0)
+        actions.append(Action(pick, color, place))
+
+    def play(actions):
+        result = State(state)
+        for action in actions:
+            GameHelper.apply(action, result)
+            result.next_player()
+        return result
+
+    # The first player picks in factories 1 and 3 in both orders
+    first = play(actions)
+    second = play(reversed(actions))
+    assert State(state).hash() == state.hash()
+    assert first == second
+    assert first.hash() == second.hash()
+    assert first.hash() != state.hash()
+
+
+@pytest.mark.parametrize("transpositions", [True, False])
+def test_mcts_tree_reuse(transpositions):
+    game = Game(Rules.BASE, 0)
+    players = [MctsPlayer(rollouts=100)
+               for _ in range(0, Rules.BASE.player_count)]
+    for player in players:
+        player.transpositions = transpositions
+    game.add_players(players)
+    game.reset()
+    game.start_round()
+    game.roll_round()
+    # Trees are kept after the actions played by the other players
+    assert all(player.get_tree_size() > 1 for player in players)
+    game.roll_end_game()
+    assert is_state_finished(game.state)
+
+
+@pytest.mark.parametrize("rollouts,max_nodes", [(0, 100000), (100, 1)])
+def test_mcts_without_visits(rollouts, max_nodes):
+    game = Game(Rules.BASE, 0)
+    game.start_round()
+    player = MctsPlayer(rollouts=rollouts)
+    player.max_nodes = max_nodes
+    assert game.legal(player.play(game.state))
+
+
+@pytest.mark.parametrize("threads", [1, 2])
+def test_monte_carlo_time_budget(threads):
+    game = Game(Rules.BASE, 0)
+    game.start_round()
+    player = MonteCarloPlayer(threads=threads, time_budget=20, early_stop=True)
+    assert player.rollouts_done == 0
+    assert game.legal(player.play(game.state))
+    assert player.rollouts_done > 0
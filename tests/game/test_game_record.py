@@ -0,0 +1,48 @@
+import pytest
+from ceramic.game import Game, GameRecorder, GameRecords, GameRecordWriter, Observer
+from ceramic.players import FirstLegalPlayer, RandomPlayer
+from ceramic.rules import Rules
+
+
+class ActionCounter(Observer):
+    def __init__(self):
+        Observer.__init__(self)
+        self.actions = 0
+
+    def action_played(self, action):
+        self.actions += 1
+
+
+@pytest.mark.parametrize("rules", [Rules.MINI, Rules.BASE])
+def test_game_records(rules, tmp_path):
+    path = str(tmp_path / "games.rec")
+    writer = GameRecordWriter(path, rules)
+    game = Game(rules, 0)
+    game.add_players([RandomPlayer(), FirstLegalPlayer()] + [RandomPlayer() for _ in range(2, rules.player_count)])
+    game.add_observer(GameRecorder(writer))
+    scores = []
+    for seed in range(5):
+        game.reseed(seed)
+        game.roll_game()
+        scores.append([game.state.panel(p).score for p in range(rules.player_count)])
+    writer.flush()
+
+    records = GameRecords(path)
+    assert records.rules == rules
+    assert len(records) == 5
+    for index in range(5):
+        record = records[index]
+        assert record.seed == index
+        assert record.scores == scores[index]
+        counter = ActionCounter()
+        state = records.replay(index, counter)
+        assert counter.actions == sum(len(round.actions) for round in record.rounds)
+        assert [state.panel(p).score for p in range(rules.player_count)] == scores[index]
+
+
+def test_game_record_writer_rules(tmp_path):
+    # Files written with rules they cannot decode are never created
+    path = tmp_path / "games.rec"
+    with pytest.raises(ValueError):
+        GameRecordWriter(str(path), Rules(player_count=8))
+    assert not path.exists()
@@ -0,0 +1,58 @@
+import numpy as np
+import pytest
+from ceramic.game import Action, GameHelper, VecEnv, action_index
+from ceramic.rules import Rules
+from ceramic.state import StateEncoder, Tile
+
+
+def random_actions(masks, generator):
+    return np.array([generator.choice(np.flatnonzero(mask)) for mask in masks], dtype=np.int32)
+
+
+@pytest.mark.parametrize("rules", [Rules.MINI, Rules.BASE])
+def test_vec_env_step(rules):
+    env = VecEnv(rules, 8, seed=3)
+    observations = env.reset()
+    assert observations.shape == (8,) + StateEncoder(rules).shape
+    assert env.masks.shape == (8, env.action_count)
+    for index in range(8):
+        legal = GameHelper.all_legal(env.state(index))
+        assert sorted(action_index(action, rules) for action in legal) == list(np.flatnonzero(env.masks[index]))
+    generator = np.random.default_rng(0)
+    totals = np.zeros((8, rules.player_count))
+    games = 0
+    while games < 8:
+        observations, rewards, dones, masks = env.step(random_actions(env.masks, generator))
+        totals += rewards
+        for index in np.flatnonzero(dones):
+            # Rewards of a game add up to the final scores
+            assert totals[index].max() == totals[index][env.winners[index]]
+            totals[index] = 0
+            games += 1
+    assert np.all(env.winners[dones == 0] == -1)
+
+
+def test_vec_env_determinism():
+    rules = Rules.BASE
+    results = []
+    for threads in [1, 3]:
+        env = VecEnv(rules, 10, seed=5)
+        env.thread_limit = threads
+        generator = np.random.default_rng(1)
+        for step in range(100):
+            # Workers are kept between steps, and restarted when the limit changes
+            if step == 50:
+                env.thread_limit = max(1, threads - 1)
+            env.step(random_actions(env.masks, generator))
+        results.append(np.array(env.observations))
+    assert np.array_equal(results[0], results[1])
+
+
+def test_vec_env_illegal_action():
+    env = VecEnv(Rules.BASE, 2)
+    action = action_index(Action(0, Tile(0), 1), Rules.BASE)
+    # The center is empty at the start of a round
+    with pytest.raises(ValueError):
+        env.step([action, action])
+    with pytest.raises(ValueError):
+        env.step([0])
@@ -0,0 +1,65 @@
+import numpy as np
+import pytest
+from ceramic.game import Game, GameHelper
+from ceramic.rules import Rules
+from ceramic.state import State, StateEncoder
+
+RULES = [Rules.MINI, Rules.BASE]
+
+
+def played_state(rules, seed, moves):
+    game = Game(rules, seed)
+    game.reset()
+    game.start_round()
+    state = game.state
+    for _ in range(moves):
+        GameHelper.apply(GameHelper.all_legal(state)[0], state)
+        state.next_player()
+    return state
+
+
+@pytest.mark.parametrize("rules", RULES)
+def test_state_encoder_shape(rules):
+    encoder = StateEncoder(rules)
+    planes = encoder.encode(State(rules))
+    assert planes.shape == encoder.shape
+    assert planes.dtype == np.float32
+    assert planes.size == encoder.size
+
+
+@pytest.mark.parametrize("rules", RULES)
+def test_state_encoder_values(rules):
+    encoder = StateEncoder(rules)
+    state = played_state(rules, 3, 2 * rules.player_count + 1)
+    planes = encoder.encode(state)
+    n = rules.tile_types
+    for k in range(rules.player_count):
+        panel = state.panel((state.current_player + k) % rules.player_count)
+        block = planes[5 * k:5 * (k + 1)]
+        for y in range(1, n + 1):
+            color = panel.pyramid.color(y)
+            for x in range(1, n + 1):
+                assert block[0, y - 1, x - 1] == panel.wall.get_placed_at(x, y)
+                amount = panel.pyramid.amount(y) if color and panel.wall.color_at(x, y) == color else 0
+                assert block[1, y - 1, x - 1] == amount
+        assert np.all(block[2] == panel.floor)
+        assert np.all(block[4] == panel.score)
+    # Each color has one cell per line, so a source plane sums to n times its tiles
+    sources = planes[5 * rules.player_count:]
+    assert sources[0].sum() == n * state.center.tiles.total()
+    for factory in range(1, rules.factory_count + 1):
+        assert sources[factory].sum() == n * state.factory(factory).tiles.total()
+    assert sources[-2].sum() == n * state.bag.total()
+
+
+def test_state_encoder_batch():
+    rules = Rules.BASE
+    encoder = StateEncoder(rules)
+    states = [played_state(rules, seed, seed) for seed in range(3)]
+    out = np.zeros((3,) + encoder.shape, dtype=np.uint8)
+    assert encoder.encode_batch(states, out) is out
+    assert np.array_equal(out[1], encoder.encode(states[1]))
+    with pytest.raises(ValueError):
+        encoder.encode_batch(states, np.zeros(10, dtype=np.float32))
+    with pytest.raises(ValueError):
+        encoder.encode(states[0], np.zeros(encoder.size, dtype=np.float64))
@@ -59,7 +59,19 @@ def test_tiles_operation(left, right):
     right_tiles = Tiles(right)
     total_tiles = Tiles(total)
     assert left_tiles + right_tiles == total_tiles
+    assert total_tiles - right_tiles == left_tiles
     assert total_tiles.total() == sum(total)
+    with pytest.raises(ValueError):
+        _ = right_tiles - total_tiles
+
+
+def test_tiles_max_quantity():
+    tiles = Tiles(Tile(0), Tiles.MAX_QUANTITY)
+    assert tiles[Tile(0)] == Tiles.MAX_QUANTITY
+    with pytest.raises(ValueError):
+        tiles += Tile(0)
+    with pytest.raises(ValueError):
+        tiles[Tile(1)] = Tiles.MAX_QUANTITY + 1
 
 
 @pytest.mark.parametrize("tiles", [